@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+# End-to-end latency: `mux bench` starts and stops every fixture on a private
+# tmux server (tmux -L mux-bench-PID, attach off), times how long until all of
+# its panes exist and how long the stop takes, then kills the server.
+#
+# Usage: benchmark_e2e.sh MUX [mux bench options...]
+# Exits 77, which meson reports as skipped, when tmux is not installed.
+set -uo pipefail
+
+mux=${1:?usage: benchmark_e2e.sh MUX [mux bench options...]}
+shift
+
+if ! command -v tmux >/dev/null 2>&1; then
+    echo "tmux is not installed; skipping the end-to-end benchmark"
+    exit 77
+fi
+
+# Panes must not land in a session this runs from
+unset TMUX TMUX_PANE
+
+# Fixture paths are relative to the source root
+case $mux in /*) ;; *) mux=$PWD/$mux ;; esac
+cd "$(dirname "$0")/.." || exit 1
+
+status=0
+for fixture in tests/fixtures/*.yml; do
+    tmux_command=$(sed -n 's/^tmux_command:[[:space:]]*//p' "$fixture")
+    if [ -n "$tmux_command" ] && ! command -v "$tmux_command" >/dev/null 2>&1; then
+        echo "$fixture: $tmux_command is not installed; skipped"
+        echo
+        continue
+    fi
+    echo "$fixture"
+    if ! "$mux" bench -p "$fixture" --stub "$@"; then
+        echo "$fixture: mux bench failed"
+        status=1
+    fi
+    echo
+done
+exit $status
@@ -3,10 +3,17 @@
 #include "path.h"
 #include "project.h"
 #include "script.h"
+#include "stats.h"
 #include "str.h"
+#include "template.h"
 #include "tmux.h"
 
 #include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +21,12 @@
 #include <time.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 static const char *BENCH_CONFIG = "name: bench\n"
                                   "root: ~/projects/bench\n"
                                   "pre_window: nvm use 22\n"
@@ -32,8 +45,167 @@ static const char *TEMPLATE_CONFIG = "name: <%= @settings[\"name\"] %>\n"
                                      "windows:\n"
                                      "  - server: echo <%= @settings[\"message\"] %>\n";
 
+#define LIST_PROJECT_COUNT 1000
+#define ACTIVE_PROJECT_COUNT 1000
+#define ACTIVE_SESSION_COUNT 500
+
+/* Samples further than this many scaled MADs from the median are outliers */
+#define OUTLIER_MADS 3.0
+/* MAD times this estimates the standard deviation of normal samples */
+#define MAD_SCALE 1.4826
+/* z for a two-sided 95% confidence interval */
+#define Z_95 1.96
+
+/* The scaling suite's largest size, and the smallest it fits growth from:
+ * below that, fixed costs such as setting up the YAML parser dominate */
+#define SCALING_DEFAULT_MAX 10000
+#define SCALING_FIT_FROM 100
+/* A fitted exponent above this is clearly worse than linear; n log n over
+ * the fitted sizes comes out near 1.15 */
+#define SCALING_LIMIT 1.3
+
 static volatile size_t bench_sink;
 
+/* Counters read with perf_event_open around each case's samples. Those the
+ * kernel will not give, because perf_event_paranoid forbids them or there is
+ * no PMU (as in many VMs), are left out. */
+typedef enum {
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CYCLES,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_PAGE_FAULTS,
+    COUNTER_COUNT,
+} Counter;
+
+static const char *counter_labels[COUNTER_COUNT] = {
+    "instructions", "cycles", "cache misses", "branch misses", "page faults",
+};
+static const char *counter_keys[COUNTER_COUNT] = {
+    "instructions_per_op", "cycles_per_op",     "cache_misses_per_op",
+    "branch_misses_per_op", "page_faults_per_op",
+};
+
+static int counter_fds[COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+
+#ifdef __linux__
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_events[COUNTER_COUNT] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+};
+#endif
+
+/* Open what counters this process may have, counting user space only so
+ * that perf_event_paranoid 2 still allows them, and say which are missing.
+ * Returns how many opened. */
+static int counters_open(void) {
+    int opened = 0;
+#ifdef __linux__
+    int error = 0;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counter_events[c].type;
+        attr.config = counter_events[c].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd < 0) {
+            if (!error) error = errno;
+            continue;
+        }
+        counter_fds[c] = (int)fd;
+        opened++;
+    }
+    if (opened < COUNTER_COUNT) {
+        fprintf(stderr, "benchmark: perf_event_open: %s; not counting", strerror(error));
+        for (int c = 0, listed = 0; c < COUNTER_COUNT; c++) {
+            if (counter_fds[c] >= 0) continue;
+            fprintf(stderr, "%s %s", listed++ ? "," : "", counter_labels[c]);
+        }
+        fputc('\n', stderr);
+    }
+#else
+    fprintf(stderr, "benchmark: counters need Linux's perf_event_open; timing only\n");
+#endif
+    return opened;
+}
+
+static void counters_start(void) {
+#ifdef __linux__
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (counter_fds[c] < 0) continue;
+        ioctl(counter_fds[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter_fds[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+/* Stop counting and set per_op to each count over ops, or NAN for counters
+ * that are not open. Counts are scaled up for the time the kernel had to
+ * share the PMU with other events. */
+static void counters_stop(double *per_op, double ops) {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        per_op[c] = NAN;
+#ifdef __linux__
+        if (counter_fds[c] < 0) continue;
+        ioctl(counter_fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t v[3]; /* value, time enabled, time running */
+        if (read(counter_fds[c], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) continue;
+        per_op[c] = (double)v[0] * ((double)v[1] / (double)v[2]) / ops;
+#endif
+    }
+}
+
+static void counters_close(void) {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (counter_fds[c] >= 0) close(counter_fds[c]);
+        counter_fds[c] = -1;
+    }
+}
+
+typedef struct {
+    const char *name;
+    void (*setup)(void);
+    void (*run)(void); /* one operation */
+    void (*teardown)(void);
+} BenchCase;
+
+typedef struct {
+    int samples;          /* timed batches per case */
+    double sample_ms;     /* a batch runs at least this long */
+    double warmup_ms;     /* untimed runs before calibrating */
+    double threshold;     /* smallest change in the median worth flagging */
+    const char *filter;   /* only cases whose names contain this */
+    const char *json;     /* file to write results to, or "-" */
+    const char *baseline; /* results to compare against */
+    bool counters;        /* read perf_event_open counters too */
+    bool alloc_stats;     /* report each operation's allocations */
+} BenchOptions;
+
+typedef struct {
+    const char *name;
+    double median; /* nanoseconds per operation */
+    double mad;
+    double ci_low; /* 95% confidence interval of the median */
+    double ci_high;
+    double mean;
+    int samples; /* kept after outlier rejection */
+    int outliers;
+    long iterations; /* operations per sample */
+    double counters[COUNTER_COUNT]; /* per operation, NAN when not counted */
+    StatsCounts alloc;              /* what one operation allocates */
+} BenchStats;
+
 static long long now_ns(void) {
     struct timespec ts;
     if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
@@ -43,69 +215,50 @@ static long long now_ns(void) {
     return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
-static void print_result(const char *name, int iterations, long long elapsed_ns) {
-    double total_ms = (double)elapsed_ns / 1000000.0;
-    double each_us = (double)elapsed_ns / (double)iterations / 1000.0;
-    printf("%-28s %7d iterations %10.3f ms total %8.3f us/op\n", name, iterations, total_ms,
-           each_us);
-}
-
-static void benchmark_parse_config(void) {
-    const int iterations = 5000;
-    long long start = now_ns();
-    for (int i = 0; i < iterations; i++) {
-        Arena a = arena_new();
-        Project p;
-        if (config_parse_string(&a, BENCH_CONFIG, strlen(BENCH_CONFIG), &p, NULL, 0) != 0) {
-            fprintf(stderr, "benchmark: config_parse_string failed\n");
-            exit(1);
-        }
-        bench_sink += (size_t)p.window_count;
-        arena_free(&a);
+static void run_parse_config(void) {
+    Arena a = arena_new();
+    Project p;
+    if (config_parse_string(&a, BENCH_CONFIG, strlen(BENCH_CONFIG), &p, NULL, 0) != 0) {
+        fprintf(stderr, "benchmark: config_parse_string failed\n");
+        exit(1);
     }
-    print_result("parse config", iterations, now_ns() - start);
+    bench_sink += (size_t)p.window_count;
+    arena_free(&a);
 }
 
-static void benchmark_template_config(void) {
-    const int iterations = 5000;
+static void run_template_config(void) {
     const char *settings[] = {"name", "templated", "root", "/tmp/templated", "message", "hello"};
-    long long start = now_ns();
-    for (int i = 0; i < iterations; i++) {
-        Arena a = arena_new();
-        Project p;
-        if (config_parse_string(&a, TEMPLATE_CONFIG, strlen(TEMPLATE_CONFIG), &p, settings, 6) !=
-            0) {
-            fprintf(stderr, "benchmark: templated config_parse_string failed\n");
-            exit(1);
-        }
-        bench_sink += strlen(p.name);
-        arena_free(&a);
+    Arena a = arena_new();
+    Project p;
+    if (config_parse_string(&a, TEMPLATE_CONFIG, strlen(TEMPLATE_CONFIG), &p, settings, 6) != 0) {
+        fprintf(stderr, "benchmark: templated config_parse_string failed\n");
+        exit(1);
     }
-    print_result("parse template config", iterations, now_ns() - start);
+    bench_sink += strlen(p.name);
+    arena_free(&a);
 }
 
-static void benchmark_script_generation(void) {
-    const int iterations = 5000;
-    long long start = now_ns();
-    for (int i = 0; i < iterations; i++) {
-        Arena a = arena_new();
-        Project p;
-        if (config_parse_string(&a, BENCH_CONFIG, strlen(BENCH_CONFIG), &p, NULL, 0) != 0) {
-            fprintf(stderr, "benchmark: config_parse_string failed\n");
-            exit(1);
-        }
-        char *script = script_generate_start(&p);
-        if (!script) {
-            fprintf(stderr, "benchmark: script_generate_start failed\n");
-            exit(1);
-        }
-        bench_sink += strlen(script);
-        free(script);
-        arena_free(&a);
+static void run_script_generation(void) {
+    Arena a = arena_new();
+    Project p;
+    if (config_parse_string(&a, BENCH_CONFIG, strlen(BENCH_CONFIG), &p, NULL, 0) != 0) {
+        fprintf(stderr, "benchmark: config_parse_string failed\n");
+        exit(1);
     }
-    print_result("parse and generate script", iterations, now_ns() - start);
+    char *script = script_generate_start(&p);
+    if (!script) {
+        fprintf(stderr, "benchmark: script_generate_start failed\n");
+        exit(1);
+    }
+    bench_sink += strlen(script);
+    free(script);
+    arena_free(&a);
 }
 
+static char list_dir[32];
+static char *list_previous_config;
+static int list_project_count = LIST_PROJECT_COUNT;
+
 static void write_project_file(const char *dir, int index) {
     char path[512];
     snprintf(path, sizeof(path), "%s/project_%04d.yml", dir, index);
@@ -118,102 +271,826 @@ static void write_project_file(const char *dir, int index) {
     fclose(f);
 }
 
-static void cleanup_project_dir(const char *dir, int count) {
-    for (int i = 0; i < count; i++) {
-        char path[512];
-        snprintf(path, sizeof(path), "%s/project_%04d.yml", dir, i);
-        unlink(path);
-    }
-    rmdir(dir);
-}
-
-static void benchmark_project_listing(void) {
-    const int project_count = 1000;
-    const int iterations = 100;
-    char dir_template[] = "/tmp/mux-bench-XXXXXX";
-    char *dir = mkdtemp(dir_template);
-    if (!dir) {
+static void setup_project_listing(void) {
+    snprintf(list_dir, sizeof(list_dir), "/tmp/mux-bench-XXXXXX");
+    if (!mkdtemp(list_dir)) {
         perror("mkdtemp");
         exit(1);
     }
-    for (int i = 0; i < project_count; i++) {
-        write_project_file(dir, i);
+    for (int i = 0; i < list_project_count; i++) {
+        write_project_file(list_dir, i);
     }
-
     const char *previous = getenv("TMUXINATOR_CONFIG");
-    char *previous_copy = previous ? strdup(previous) : NULL;
-    setenv("TMUXINATOR_CONFIG", dir, 1);
+    list_previous_config = previous ? strdup(previous) : NULL;
+    setenv("TMUXINATOR_CONFIG", list_dir, 1);
+}
 
-    long long start = now_ns();
-    for (int i = 0; i < iterations; i++) {
-        Arena a = arena_new();
-        int count = 0;
-        char **projects = path_list_projects(&a, &count);
-        if (!projects || count != project_count) {
-            fprintf(stderr, "benchmark: expected %d projects, got %d\n", project_count, count);
-            exit(1);
-        }
-        bench_sink += (size_t)count;
-        arena_free(&a);
-    }
-    print_result("list 1000 projects", iterations, now_ns() - start);
-
-    if (previous_copy) {
-        setenv("TMUXINATOR_CONFIG", previous_copy, 1);
-        free(previous_copy);
+static void run_project_listing(void) {
+    Arena a = arena_new();
+    int count = 0;
+    char **projects = path_list_projects(&a, &count);
+    if (!projects || count != list_project_count) {
+        fprintf(stderr, "benchmark: expected %d projects, got %d\n", list_project_count, count);
+        exit(1);
+    }
+    bench_sink += (size_t)count;
+    arena_free(&a);
+}
+
+static void teardown_project_listing(void) {
+    if (list_previous_config) {
+        setenv("TMUXINATOR_CONFIG", list_previous_config, 1);
+        free(list_previous_config);
     } else {
         unsetenv("TMUXINATOR_CONFIG");
     }
-    cleanup_project_dir(dir, project_count);
+    for (int i = 0; i < list_project_count; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/project_%04d.yml", list_dir, i);
+        unlink(path);
+    }
+    rmdir(list_dir);
 }
 
-static void benchmark_active_session_filter(void) {
-    const int project_count = 1000;
-    const int active_count = 500;
-    const int iterations = 100;
-    Arena setup = arena_new();
-    char **projects = arena_alloc(&setup, sizeof(char *) * (size_t)(project_count + 1));
-    Str session_output = str_new();
+static Arena active_arena;
+static char **active_projects;
+static char **active_sessions;
+static int active_session_count;
 
-    for (int i = 0; i < project_count; i++) {
+static void setup_active_session_filter(void) {
+    active_arena = arena_new();
+    active_projects = arena_alloc(&active_arena, sizeof(char *) * (ACTIVE_PROJECT_COUNT + 1));
+    Str session_output = str_new();
+    for (int i = 0; i < ACTIVE_PROJECT_COUNT; i++) {
         char name[32];
         snprintf(name, sizeof(name), "project_%04d", i);
-        projects[i] = arena_strdup(&setup, name);
-        if (i < active_count) {
+        active_projects[i] = arena_strdup(&active_arena, name);
+        if (i < ACTIVE_SESSION_COUNT) {
             str_appendf(&session_output, "%s\n", name);
         }
     }
-    projects[project_count] = NULL;
+    active_projects[ACTIVE_PROJECT_COUNT] = NULL;
+    active_sessions = tmux_parse_session_names(&active_arena, str_cstr(&session_output),
+                                               &active_session_count);
+    str_free(&session_output);
+}
+
+static void run_active_session_filter(void) {
+    int matches = 0;
+    for (int j = 0; j < ACTIVE_PROJECT_COUNT; j++) {
+        if (tmux_session_names_contain(active_sessions, active_session_count,
+                                       active_projects[j])) {
+            matches++;
+        }
+    }
+    if (matches != ACTIVE_SESSION_COUNT) {
+        fprintf(stderr, "benchmark: expected %d active matches, got %d\n", ACTIVE_SESSION_COUNT,
+                matches);
+        exit(1);
+    }
+    bench_sink += (size_t)matches;
+}
+
+static void teardown_active_session_filter(void) {
+    arena_free(&active_arena);
+}
+
+static const BenchCase cases[] = {
+    {"parse config", NULL, run_parse_config, NULL},
+    {"parse template config", NULL, run_template_config, NULL},
+    {"parse and generate script", NULL, run_script_generation, NULL},
+    {"list 1000 projects", setup_project_listing, run_project_listing, teardown_project_listing},
+    {"filter active sessions", setup_active_session_filter, run_active_session_filter,
+     teardown_active_session_filter},
+};
+#define CASE_COUNT ((int)(sizeof(cases) / sizeof(cases[0])))
+
+enum {
+    ALLOC_REQUESTED,
+    ALLOC_USED,
+    ALLOC_BLOCKS,
+    ALLOC_BLOCK_BYTES,
+    ALLOC_WASTED,
+    ALLOC_STR_GROWS,
+    ALLOC_STR_COPIED,
+};
 
-    int session_count = 0;
-    char **sessions = tmux_parse_session_names(&setup, str_cstr(&session_output), &session_count);
+static const struct {
+    const char *label;
+    const char *key;
+    size_t offset;
+} alloc_fields[] = {
+    {"arena bytes requested", "arena_requested", offsetof(StatsCounts, arena_requested)},
+    {"arena bytes used", "arena_used", offsetof(StatsCounts, arena_used)},
+    {"arena blocks", "arena_blocks", offsetof(StatsCounts, arena_blocks)},
+    {"arena block bytes", "arena_block_bytes", offsetof(StatsCounts, arena_block_bytes)},
+    {"arena bytes wasted", "arena_wasted", offsetof(StatsCounts, arena_wasted)},
+    {"Str grows", "str_grows", offsetof(StatsCounts, str_grows)},
+    {"Str bytes copied", "str_copied", offsetof(StatsCounts, str_copied)},
+};
+#define ALLOC_FIELD_COUNT ((int)(sizeof(alloc_fields) / sizeof(alloc_fields[0])))
+
+static size_t alloc_field(const StatsCounts *c, int f) {
+    return *(const size_t *)((const char *)c + alloc_fields[f].offset);
+}
+
+/* The most one operation of a case may allocate, a little above what it
+ * takes now, so that growth in the parse and generate path fails the
+ * benchmark */
+static const struct {
+    const char *name;
+    int field; /* index into alloc_fields */
+    size_t max;
+} alloc_bounds[] = {
+    {"parse config", ALLOC_REQUESTED, 2048},
+    {"parse config", ALLOC_BLOCKS, 1},
+    {"parse config", ALLOC_WASTED, 0},
+    {"parse config", ALLOC_STR_GROWS, 4},
+    {"parse and generate script", ALLOC_REQUESTED, 3072},
+    {"parse and generate script", ALLOC_BLOCKS, 16},
+    {"parse and generate script", ALLOC_WASTED, 0},
+    {"parse and generate script", ALLOC_STR_GROWS, 32},
+    {"parse and generate script", ALLOC_STR_COPIED, 1024},
+};
+
+/* Report the counts of st above its case's bounds. Returns how many are. */
+static int check_alloc_bounds(const BenchStats *st) {
+    int over = 0;
+    for (int i = 0; i < (int)(sizeof(alloc_bounds) / sizeof(alloc_bounds[0])); i++) {
+        if (strcmp(alloc_bounds[i].name, st->name) != 0) continue;
+        int f = alloc_bounds[i].field;
+        size_t got = alloc_field(&st->alloc, f);
+        if (got <= alloc_bounds[i].max) continue;
+        fprintf(stderr, "benchmark: %s: %zu %s per operation, above the bound of %zu\n",
+                st->name, got, alloc_fields[f].label, alloc_bounds[i].max);
+        over++;
+    }
+    return over;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Median of n sorted values */
+static double median_of(const double *sorted, int n) {
+    return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+}
+
+static double mad_of(const double *values, int n, double median) {
+    double *deviations = malloc(sizeof(double) * (size_t)n);
+    for (int i = 0; i < n; i++) deviations[i] = fabs(values[i] - median);
+    qsort(deviations, (size_t)n, sizeof(double), compare_double);
+    double mad = median_of(deviations, n);
+    free(deviations);
+    return mad;
+}
+
+/* Drop outliers from the sorted samples, then take the median, its MAD and
+ * the distribution-free confidence interval of the median, whose bounds are
+ * the order statistics n/2 -+ z*sqrt(n)/2. */
+static void summarise(double *sorted, int n, BenchStats *st) {
+    double median = median_of(sorted, n);
+    double limit = OUTLIER_MADS * MAD_SCALE * mad_of(sorted, n, median);
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (limit == 0.0 || fabs(sorted[i] - median) <= limit) sorted[kept++] = sorted[i];
+    }
+    st->outliers = n - kept;
+    st->samples = kept;
+    st->median = median_of(sorted, kept);
+    st->mad = mad_of(sorted, kept, st->median);
+
+    double sum = 0.0;
+    for (int i = 0; i < kept; i++) sum += sorted[i];
+    st->mean = sum / kept;
+
+    double half = Z_95 * sqrt((double)kept) / 2.0;
+    int lo = (int)floor(kept / 2.0 - half);
+    int hi = (int)ceil(kept / 2.0 + half) - 1;
+    st->ci_low = sorted[lo < 0 ? 0 : lo];
+    st->ci_high = sorted[hi > kept - 1 ? kept - 1 : hi];
+}
+
+static double batch_ns(const BenchCase *c, long iterations) {
     long long start = now_ns();
-    for (int i = 0; i < iterations; i++) {
-        int matches = 0;
-        for (int j = 0; j < project_count; j++) {
-            if (tmux_session_names_contain(sessions, session_count, projects[j])) {
-                matches++;
+    for (long i = 0; i < iterations; i++) c->run();
+    return (double)(now_ns() - start);
+}
+
+/* Warm up, pick how many operations make a sample at least sample_ms long,
+ * then time the samples. */
+static void measure(const BenchCase *c, const BenchOptions *opt, BenchStats *st) {
+    if (c->setup) c->setup();
+
+    long long warm_until = now_ns() + (long long)(opt->warmup_ms * 1e6);
+    do {
+        c->run();
+    } while (now_ns() < warm_until);
+
+    long iterations = 1;
+    double target = opt->sample_ms * 1e6;
+    for (;;) {
+        double elapsed = batch_ns(c, iterations);
+        if (elapsed >= target) break;
+        /* Aim just past the target, growing at most tenfold per step */
+        double scale = elapsed > 0 ? target * 1.2 / elapsed : 10.0;
+        if (scale > 10.0) scale = 10.0;
+        if (scale < 2.0) scale = 2.0;
+        iterations = (long)(iterations * scale);
+    }
+
+    double *per_op = malloc(sizeof(double) * (size_t)opt->samples);
+    if (opt->counters) counters_start();
+    for (int i = 0; i < opt->samples; i++) {
+        per_op[i] = batch_ns(c, iterations) / (double)iterations;
+    }
+    counters_stop(st->counters, (double)iterations * opt->samples);
+    StatsCounts before = stats_counts;
+    c->run();
+    st->alloc = stats_since(&before);
+    if (c->teardown) c->teardown();
+
+    qsort(per_op, (size_t)opt->samples, sizeof(double), compare_double);
+    st->name = c->name;
+    st->iterations = iterations;
+    summarise(per_op, opt->samples, st);
+    free(per_op);
+}
+
+static void format_count(char *buf, size_t size, double n) {
+    if (n >= 1e6) {
+        snprintf(buf, size, "%.2fM", n / 1e6);
+    } else if (n >= 1e3) {
+        snprintf(buf, size, "%.1fk", n / 1e3);
+    } else if (n >= 10) {
+        snprintf(buf, size, "%.1f", n);
+    } else {
+        snprintf(buf, size, "%.3f", n);
+    }
+}
+
+static void format_time(char *buf, size_t size, double ns) {
+    if (ns >= 1e6) {
+        snprintf(buf, size, "%.2f ms", ns / 1e6);
+    } else if (ns >= 1e3) {
+        snprintf(buf, size, "%.2f us", ns / 1e3);
+    } else {
+        snprintf(buf, size, "%.1f ns", ns);
+    }
+}
+
+/* Read the cases of a results file this program wrote: one case per line,
+ * each with the fields write_json() gives it. Returns the number read, or
+ * -1 when the file cannot be opened. */
+static int read_baseline(const char *path, BenchStats *stats, int max) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int n = 0;
+    char line[2048];
+    while (n < max && fgets(line, sizeof(line), f)) {
+        char *name = strstr(line, "{\"name\": \"");
+        char *median = strstr(line, "\"median_ns\": ");
+        char *low = strstr(line, "\"ci_low_ns\": ");
+        char *high = strstr(line, "\"ci_high_ns\": ");
+        if (!name || !median || !low || !high) continue;
+        name += strlen("{\"name\": \"");
+        char *end = strchr(name, '"');
+        if (!end) continue;
+        *end = '\0';
+        stats[n] = (BenchStats){.name = strdup(name)};
+        stats[n].median = strtod(median + strlen("\"median_ns\": "), NULL);
+        stats[n].ci_low = strtod(low + strlen("\"ci_low_ns\": "), NULL);
+        stats[n].ci_high = strtod(high + strlen("\"ci_high_ns\": "), NULL);
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            char key[64];
+            snprintf(key, sizeof(key), "\"%s\": ", counter_keys[c]);
+            char *value = strstr(line, key);
+            stats[n].counters[c] = value ? strtod(value + strlen(key), NULL) : NAN;
+        }
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/* When both runs counted instructions, a change in them by more than the
+ * threshold is significant: they barely move between runs, unlike time on a
+ * shared machine. Otherwise a change is significant when the confidence
+ * intervals do not overlap and the medians differ by more than the
+ * threshold. Sets *change for the time and *instructions for the
+ * instructions (NAN when not compared). Returns 1 for a regression, -1 for
+ * an improvement, else 0. */
+static int compare(const BenchStats *now, const BenchStats *base, double threshold,
+                   double *change, double *instructions) {
+    *change = base->median > 0 ? now->median / base->median - 1.0 : 0.0;
+    double was = base->counters[COUNTER_INSTRUCTIONS], is = now->counters[COUNTER_INSTRUCTIONS];
+    *instructions = NAN;
+    if (!isnan(was) && !isnan(is) && was > 0) {
+        *instructions = is / was - 1.0;
+        if (*instructions > threshold) return 1;
+        if (-*instructions > threshold) return -1;
+        return 0;
+    }
+    if (now->ci_low > base->ci_high && *change > threshold) return 1;
+    if (now->ci_high < base->ci_low && -*change > threshold) return -1;
+    return 0;
+}
+
+static void write_json(FILE *out, const BenchStats *stats, int count, bool alloc) {
+    fprintf(out, "{\"benchmarks\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BenchStats *st = &stats[i];
+        fprintf(out,
+                "{\"name\": \"%s\", \"median_ns\": %.2f, \"mad_ns\": %.2f, \"ci_low_ns\": %.2f, "
+                "\"ci_high_ns\": %.2f, \"mean_ns\": %.2f, \"samples\": %d, \"outliers\": %d, "
+                "\"iterations\": %ld",
+                st->name, st->median, st->mad, st->ci_low, st->ci_high, st->mean, st->samples,
+                st->outliers, st->iterations);
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (isnan(st->counters[c])) continue;
+            fprintf(out, ", \"%s\": %.2f", counter_keys[c], st->counters[c]);
+        }
+        if (alloc) {
+            fprintf(out, ", \"alloc_per_op\": {");
+            for (int f = 0; f < ALLOC_FIELD_COUNT; f++) {
+                fprintf(out, "%s\"%s\": %zu", f ? ", " : "", alloc_fields[f].key,
+                        alloc_field(&st->alloc, f));
             }
+            fprintf(out, "}");
         }
-        if (matches != active_count) {
-            fprintf(stderr, "benchmark: expected %d active matches, got %d\n", active_count,
-                    matches);
-            exit(1);
+        fprintf(out, "}%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+/* The shape of a synthetic config. Every window has the same panes, every
+ * named pane the same commands, and each command placeholders references to
+ * settings, taken from the end of the settings so that looking one up passes
+ * over the rest. */
+typedef struct {
+    int windows;
+    int panes;
+    int commands;
+    int placeholders;
+    int settings;
+    int projects; /* config files for listing */
+} ScaleShape;
+
+static ScaleShape scale_shape;
+static Str scale_yaml;
+static const char **scale_settings;
+static Arena scale_arena;
+static Project scale_project;
+
+static void generate_config(Str *out, const ScaleShape *shape) {
+    str_clear(out);
+    str_append(out, "name: scaled\nroot: /tmp\nwindows:\n");
+    int setting = 0;
+    for (int wi = 0; wi < shape->windows; wi++) {
+        str_appendf(out, "  - w%d:\n      layout: tiled\n", wi);
+        /* Focus by title, so the pane titles are searched */
+        if (shape->panes > 1) str_appendf(out, "      focused_pane: p%d\n", shape->panes - 1);
+        str_append(out, "      panes:\n");
+        for (int pi = 0; pi < shape->panes; pi++) {
+            str_appendf(out, "        - p%d:\n", pi);
+            for (int ci = 0; ci < shape->commands; ci++) {
+                str_appendf(out, "            - echo %d.%d.%d", wi, pi, ci);
+                for (int k = 0; k < shape->placeholders; k++) {
+                    str_appendf(out, " <%%= @settings[\"key%d\"] %%>",
+                                shape->settings - 1 - setting);
+                    setting = shape->settings > 0 ? (setting + 1) % shape->settings : 0;
+                }
+                str_append_char(out, '\n');
+            }
         }
-        bench_sink += (size_t)matches;
     }
-    print_result("filter active sessions", iterations, now_ns() - start);
+}
 
-    str_free(&session_output);
-    arena_free(&setup);
+static void setup_scale_config(void) {
+    scale_arena = arena_new();
+    scale_yaml = str_new();
+    generate_config(&scale_yaml, &scale_shape);
+    scale_settings = arena_alloc(&scale_arena, sizeof(char *) * (size_t)(scale_shape.settings * 2));
+    for (int i = 0; i < scale_shape.settings; i++) {
+        char key[32], value[32];
+        snprintf(key, sizeof(key), "key%d", i);
+        snprintf(value, sizeof(value), "value%d", i);
+        scale_settings[i * 2] = arena_strdup(&scale_arena, key);
+        scale_settings[i * 2 + 1] = arena_strdup(&scale_arena, value);
+    }
 }
 
-int main(void) {
-    benchmark_parse_config();
-    benchmark_template_config();
-    benchmark_script_generation();
-    benchmark_project_listing();
-    benchmark_active_session_filter();
-    printf("benchmark sink: %zu\n", bench_sink);
+static void teardown_scale_config(void) {
+    str_free(&scale_yaml);
+    arena_free(&scale_arena);
+}
+
+static void run_scale_parse(void) {
+    Arena a = arena_new();
+    Project p;
+    if (config_parse_string(&a, scale_yaml.data, scale_yaml.len, &p, NULL, 0) != 0) {
+        fprintf(stderr, "benchmark: synthetic config_parse_string failed\n");
+        exit(1);
+    }
+    bench_sink += (size_t)p.window_count;
+    arena_free(&a);
+}
+
+static void run_scale_template(void) {
+    Arena a = arena_new();
+    char *out =
+        template_substitute(&a, str_cstr(&scale_yaml), scale_settings, scale_shape.settings * 2);
+    bench_sink += strlen(out);
+    arena_free(&a);
+}
+
+static void setup_scale_generate(void) {
+    setup_scale_config();
+    if (config_parse_string(&scale_arena, scale_yaml.data, scale_yaml.len, &scale_project, NULL,
+                            0) != 0) {
+        fprintf(stderr, "benchmark: synthetic config_parse_string failed\n");
+        exit(1);
+    }
+}
+
+static void run_scale_generate(void) {
+    char *script = script_generate_start(&scale_project);
+    if (!script) {
+        fprintf(stderr, "benchmark: script_generate_start failed\n");
+        exit(1);
+    }
+    bench_sink += strlen(script);
+    free(script);
+}
+
+static void setup_scale_listing(void) {
+    list_project_count = scale_shape.projects;
+    setup_project_listing();
+}
+
+static void teardown_scale_listing(void) {
+    teardown_project_listing();
+    list_project_count = LIST_PROJECT_COUNT;
+}
+
+/* One operation measured over sizes of one field of its shape */
+typedef struct {
+    BenchCase op;
+    const char *over;
+    size_t field; /* offset of the int in ScaleShape that the size sets */
+    ScaleShape shape;
+} ScaleSeries;
+
+#define SHAPE_FIELD(f) offsetof(ScaleShape, f)
+
+static const ScaleSeries scale_series[] = {
+    {{"parse", setup_scale_config, run_scale_parse, teardown_scale_config},
+     "windows",
+     SHAPE_FIELD(windows),
+     {.panes = 2, .commands = 2}},
+    {{"template", setup_scale_config, run_scale_template, teardown_scale_config},
+     "windows",
+     SHAPE_FIELD(windows),
+     {.panes = 2, .commands = 2, .placeholders = 1, .settings = 32}},
+    {{"template", setup_scale_config, run_scale_template, teardown_scale_config},
+     "placeholders",
+     SHAPE_FIELD(placeholders),
+     {.windows = 10, .panes = 2, .commands = 1, .settings = 32}},
+    {{"template", setup_scale_config, run_scale_template, teardown_scale_config},
+     "settings",
+     SHAPE_FIELD(settings),
+     {.windows = 100, .panes = 2, .commands = 1, .placeholders = 1}},
+    {{"generate", setup_scale_generate, run_scale_generate, teardown_scale_config},
+     "windows",
+     SHAPE_FIELD(windows),
+     {.panes = 2, .commands = 2}},
+    {{"generate", setup_scale_generate, run_scale_generate, teardown_scale_config},
+     "panes",
+     SHAPE_FIELD(panes),
+     {.windows = 1, .commands = 1}},
+    {{"generate", setup_scale_generate, run_scale_generate, teardown_scale_config},
+     "commands",
+     SHAPE_FIELD(commands),
+     {.windows = 1, .panes = 1}},
+    {{"list projects", setup_scale_listing, run_project_listing, teardown_scale_listing},
+     "projects",
+     SHAPE_FIELD(projects),
+     {0}},
+};
+#define SERIES_COUNT ((int)(sizeof(scale_series) / sizeof(scale_series[0])))
+
+#define SCALE_MAX_POINTS 16
+
+typedef struct {
+    int count;
+    int size[SCALE_MAX_POINTS];
+    double median[SCALE_MAX_POINTS]; /* nanoseconds per operation */
+    double exponent;                 /* NAN when too few points were fitted */
+} ScaleResult;
+
+/* Least-squares slope of log(time) against log(size) over the sizes from
+ * SCALING_FIT_FROM up, or over the two largest when fewer reach it: time
+ * grows as size to this power. */
+static double fit_exponent(const ScaleResult *r) {
+    int from = 0;
+    while (from < r->count && r->size[from] < SCALING_FIT_FROM) from++;
+    if (r->count - from < 2) from = r->count - 2;
+    if (from < 0) return NAN;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = r->count - from;
+    for (int i = from; i < r->count; i++) {
+        double x = log((double)r->size[i]), y = log(r->median[i]);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+static void write_scaling_json(FILE *out, const ScaleResult *results) {
+    fprintf(out, "{\"scaling\": [");
+    int written = 0;
+    for (int s = 0; s < SERIES_COUNT; s++) {
+        const ScaleResult *r = &results[s];
+        if (r->count == 0) continue; /* filtered out */
+        fprintf(out, "%s\n{\"name\": \"%s\", \"over\": \"%s\", \"exponent\": ",
+                written++ ? "," : "", scale_series[s].op.name, scale_series[s].over);
+        if (isnan(r->exponent)) {
+            fprintf(out, "null");
+        } else {
+            fprintf(out, "%.3f", r->exponent);
+        }
+        fprintf(out, ", \"points\": [");
+        for (int i = 0; i < r->count; i++) {
+            fprintf(out, "%s{\"size\": %d, \"median_ns\": %.2f}", i ? ", " : "", r->size[i],
+                    r->median[i]);
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "\n]}\n");
+}
+
+/* Time each series at sizes 1, 10, 100, ... up to max_size and fit how its
+ * time grows. Returns 1 when any grows clearly faster than linearly. */
+static int run_scaling(const BenchOptions *opt, int max_size, FILE *table) {
+    ScaleResult results[SERIES_COUNT];
+    int superlinear = 0;
+    fprintf(table, "%-14s %-13s %s\n", "case", "over", "median per operation at each size");
+    for (int s = 0; s < SERIES_COUNT; s++) {
+        const ScaleSeries *series = &scale_series[s];
+        ScaleResult *r = &results[s];
+        r->count = 0;
+        if (opt->filter && !strstr(series->op.name, opt->filter)) {
+            r->exponent = NAN;
+            continue;
+        }
+        fprintf(table, "%-14s %-13s", series->op.name, series->over);
+        for (int size = 1; size <= max_size && r->count < SCALE_MAX_POINTS; size *= 10) {
+            scale_shape = series->shape;
+            *(int *)((char *)&scale_shape + series->field) = size;
+            BenchStats st;
+            measure(&series->op, opt, &st);
+            r->size[r->count] = size;
+            r->median[r->count++] = st.median;
+            char time[32];
+            format_time(time, sizeof(time), st.median);
+            fprintf(table, " %d: %s", size, time);
+            fflush(table);
+        }
+        r->exponent = fit_exponent(r);
+        if (isnan(r->exponent)) {
+            fprintf(table, "\n%28s too few sizes to fit\n", "");
+            continue;
+        }
+        bool bad = r->exponent > SCALING_LIMIT;
+        superlinear += bad;
+        fprintf(table, "\n%28s grows as n^%.2f%s\n", "", r->exponent,
+                bad ? ", super-linear" : "");
+    }
+
+    if (opt->json) {
+        FILE *out = strcmp(opt->json, "-") == 0 ? stdout : fopen(opt->json, "w");
+        if (!out) {
+            fprintf(stderr, "benchmark: cannot write %s: %s\n", opt->json, strerror(errno));
+            return 2;
+        }
+        write_scaling_json(out, results);
+        if (out != stdout) fclose(out);
+    }
+    fprintf(table, "benchmark sink: %zu\n", bench_sink);
+    fflush(table);
+    if (superlinear > 0) {
+        fprintf(stderr, "benchmark: %d case%s grow faster than n^%.2f\n", superlinear,
+                superlinear == 1 ? "" : "s", SCALING_LIMIT);
+        return 1;
+    }
+    return 0;
+}
+
+static void usage(void) {
+    printf("Usage: benchmark_mux [options]\n\n");
+    printf("  --samples N       Timed samples per case (default 20)\n");
+    printf("  --sample-ms MS    Run each sample at least this long (default 10)\n");
+    printf("  --warmup-ms MS    Untimed runs before each case (default 50)\n");
+    printf("  --filter TEXT     Only run cases whose names contain TEXT\n");
+    printf("  --json FILE       Write the results as JSON to FILE, or - for stdout\n");
+    printf("  --compare FILE    Compare against results --json wrote, failing on\n");
+    printf("                    significant regressions\n");
+    printf("  --threshold PCT   Smallest change in the median, or in instructions when\n");
+    printf("                    both runs counted them, to flag (default 5)\n");
+    printf("  --alloc-stats     Report what one operation of each case allocates\n");
+    printf("  --counters        Count instructions, cycles, cache misses, branch misses\n");
+    printf("                    and page faults per operation with perf_event_open\n");
+    printf("  --scaling         Time parsing, templating, generation and listing over\n");
+    printf("                    synthetic configs of growing size, failing on\n");
+    printf("                    super-linear growth\n");
+    printf("  --max-size N      Largest size for --scaling (default %d)\n", SCALING_DEFAULT_MAX);
+}
+
+static double parse_number(const char *flag, const char *arg, double min) {
+    char *end = NULL;
+    errno = 0;
+    double value = strtod(arg, &end);
+    if (end == arg || *end != '\0' || errno != 0 || value < min) {
+        fprintf(stderr, "benchmark: %s needs a number of at least %g\n", flag, min);
+        exit(2);
+    }
+    return value;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt = {
+        .samples = 20,
+        .sample_ms = 10.0,
+        .warmup_ms = 50.0,
+        .threshold = 0.05,
+    };
+    static struct option long_opts[] = {
+        {"samples", required_argument, 0, 'n'},   {"sample-ms", required_argument, 0, 's'},
+        {"warmup-ms", required_argument, 0, 'w'}, {"filter", required_argument, 0, 'f'},
+        {"json", required_argument, 0, 'j'},      {"compare", required_argument, 0, 'c'},
+        {"threshold", required_argument, 0, 't'}, {"scaling", no_argument, 0, 'S'},
+        {"max-size", required_argument, 0, 'm'},  {"counters", no_argument, 0, 'C'},
+        {"alloc-stats", no_argument, 0, 'A'},     {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+    };
+    bool scaling = false;
+    int max_size = SCALING_DEFAULT_MAX;
+    int o;
+    while ((o = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (o) {
+        case 'n':
+            opt.samples = (int)parse_number("--samples", optarg, 5);
+            break;
+        case 's':
+            opt.sample_ms = parse_number("--sample-ms", optarg, 0.1);
+            break;
+        case 'w':
+            opt.warmup_ms = parse_number("--warmup-ms", optarg, 0);
+            break;
+        case 'f':
+            opt.filter = optarg;
+            break;
+        case 'j':
+            opt.json = optarg;
+            break;
+        case 'c':
+            opt.baseline = optarg;
+            break;
+        case 't':
+            opt.threshold = parse_number("--threshold", optarg, 0) / 100.0;
+            break;
+        case 'S':
+            scaling = true;
+            break;
+        case 'C':
+            opt.counters = true;
+            break;
+        case 'A':
+            opt.alloc_stats = true;
+            break;
+        case 'm':
+            max_size = (int)parse_number("--max-size", optarg, 1);
+            break;
+        case 'h':
+            usage();
+            return 0;
+        default:
+            usage();
+            return 2;
+        }
+    }
+
+    if (opt.counters && counters_open() == 0) opt.counters = false;
+
+    /* With JSON on stdout, the table goes to stderr */
+    FILE *table = opt.json && strcmp(opt.json, "-") == 0 ? stderr : stdout;
+    if (scaling) {
+        if (opt.baseline) {
+            fprintf(stderr, "benchmark: --compare does not apply to --scaling\n");
+            return 2;
+        }
+        return run_scaling(&opt, max_size, table);
+    }
+
+    BenchStats base[64];
+    int base_count = 0;
+    if (opt.baseline) {
+        base_count = read_baseline(opt.baseline, base, 64);
+        if (base_count < 0) {
+            fprintf(stderr, "benchmark: cannot read %s: %s\n", opt.baseline, strerror(errno));
+            return 2;
+        }
+    }
+
+    fprintf(table, "%-28s %11s %10s %23s %7s %9s %8s\n", "case", "median", "MAD", "95% CI",
+            "samples", "iters", "outliers");
+
+    BenchStats stats[CASE_COUNT];
+    int count = 0;
+    int regressions = 0;
+    int over_bounds = 0;
+    for (int i = 0; i < CASE_COUNT; i++) {
+        if (opt.filter && !strstr(cases[i].name, opt.filter)) continue;
+        BenchStats *st = &stats[count++];
+        measure(&cases[i], &opt, st);
+
+        char median[32], mad[32], low[32], high[32], ci[80];
+        format_time(median, sizeof(median), st->median);
+        format_time(mad, sizeof(mad), st->mad);
+        format_time(low, sizeof(low), st->ci_low);
+        format_time(high, sizeof(high), st->ci_high);
+        snprintf(ci, sizeof(ci), "%s - %s", low, high);
+        fprintf(table, "%-28s %11s %10s %23s %7d %9ld %8d", st->name, median, mad, ci,
+                st->samples, st->iterations, st->outliers);
+
+        const BenchStats *b = NULL;
+        for (int k = 0; k < base_count && !b; k++) {
+            if (strcmp(base[k].name, st->name) == 0) b = &base[k];
+        }
+        if (b) {
+            double change, instructions;
+            int verdict = compare(st, b, opt.threshold, &change, &instructions);
+            regressions += verdict > 0;
+            fprintf(table, "  %+6.1f%%", change * 100.0);
+            if (!isnan(instructions)) {
+                fprintf(table, ", instructions %+.1f%%", instructions * 100.0);
+            }
+            fprintf(table, "%s",
+                    verdict > 0   ? " regression"
+                    : verdict < 0 ? " improvement"
+                                  : "");
+        } else if (opt.baseline) {
+            fprintf(table, "  (not in baseline)");
+        }
+        fputc('\n', table);
+
+        if (opt.counters) {
+            fprintf(table, "%28s per op:", "");
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (isnan(st->counters[c])) continue;
+                char n[32];
+                format_count(n, sizeof(n), st->counters[c]);
+                fprintf(table, " %s %s", n, counter_labels[c]);
+            }
+            fputc('\n', table);
+        }
+        if (opt.alloc_stats) {
+            const StatsCounts *al = &st->alloc;
+            fprintf(table,
+                    "%28s allocs: arena %zu requested, %zu used, %zu blocks of %zu, %zu wasted;"
+                    " Str %zu grows, %zu copied\n",
+                    "", al->arena_requested, al->arena_used, al->arena_blocks,
+                    al->arena_block_bytes, al->arena_wasted, al->str_grows, al->str_copied);
+        }
+        over_bounds += check_alloc_bounds(st);
+    }
+    counters_close();
+
+    if (opt.json) {
+        FILE *out = strcmp(opt.json, "-") == 0 ? stdout : fopen(opt.json, "w");
+        if (!out) {
+            fprintf(stderr, "benchmark: cannot write %s: %s\n", opt.json, strerror(errno));
+            return 2;
+        }
+        write_json(out, stats, count, opt.alloc_stats);
+        if (out != stdout) fclose(out);
+    }
+    fprintf(table, "benchmark sink: %zu\n", bench_sink);
+
+    for (int k = 0; k < base_count; k++) free((char *)base[k].name);
+    if (over_bounds > 0) {
+        fprintf(stderr, "benchmark: %d allocation count%s over bounds\n", over_bounds,
+                over_bounds == 1 ? "" : "s");
+        return 1;
+    }
+    if (regressions > 0) {
+        fprintf(stderr, "benchmark: %d significant regression%s against %s\n", regressions,
+                regressions == 1 ? "" : "s", opt.baseline);
+        return 1;
+    }
     return 0;
 }
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "stats.h"
+
 static ArenaBlock *arena_block_new(size_t min_size) {
     size_t size = min_size > ARENA_BLOCK_SIZE ? min_size : ARENA_BLOCK_SIZE;
     ArenaBlock *b = malloc(sizeof(ArenaBlock) + size);
@@ -14,6 +16,10 @@ static ArenaBlock *arena_block_new(size_t min_size) {
     b->next = NULL;
     b->size = size;
     b->used = 0;
+    stats_counts.arena_blocks++;
+    stats_counts.arena_block_bytes += size;
+    stats_arena_live += size;
+    if (stats_arena_live > stats_arena_peak) stats_arena_peak = stats_arena_live;
     return b;
 }
 
@@ -25,10 +31,13 @@ Arena arena_new(void) {
 }
 
 void *arena_alloc(Arena *a, size_t size) {
+    stats_counts.arena_requested += size;
     /* Align to 8 bytes */
     size = (size + 7) & ~(size_t)7;
+    stats_counts.arena_used += size;
 
     if (a->current->used + size > a->current->size) {
+        stats_counts.arena_wasted += a->current->size - a->current->used;
         ArenaBlock *b = arena_block_new(size);
         a->current->next = b;
         a->current = b;
@@ -67,6 +76,7 @@ void arena_free(Arena *a) {
     ArenaBlock *b = a->head;
     while (b) {
         ArenaBlock *next = b->next;
+        stats_arena_live -= b->size;
         free(b);
         b = next;
     }
@@ -0,0 +1,288 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "script.h"
+#include "shell.h"
+#include "trace.h"
+
+/* How long panes the start script leaves to the background may take */
+#define BENCH_PANE_TIMEOUT_MS 30000
+
+static const char *metric_labels[BENCH_METRIC_COUNT] = {
+    "time to session (ms)",
+    "time to all panes (ms)",
+    "stop (ms)",
+};
+static const char *metric_keys[BENCH_METRIC_COUNT] = {
+    "time_to_session_ms",
+    "time_to_all_panes_ms",
+    "stop_ms",
+};
+
+typedef struct {
+    const char *name;
+    double q;
+} BenchQuantile;
+
+static const BenchQuantile quantiles[] = {
+    {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"min", 0.0}, {"max", 1.0},
+};
+#define QUANTILE_COUNT ((int)(sizeof(quantiles) / sizeof(quantiles[0])))
+
+void bench_prepare(Project *p, char *socket, bool stub) {
+    p->socket_name = socket;
+    p->socket_path = NULL;
+    p->attach = false;
+    p->prewarm = 0;
+    if (!stub) return;
+
+    p->pre_window = NULL;
+    p->on_project_start = NULL;
+    p->on_project_first_start = NULL;
+    p->on_project_restart = NULL;
+    p->on_project_exit = NULL;
+    p->on_project_stop = NULL;
+    for (int wi = 0; wi < p->window_count; wi++) {
+        Window *w = &p->windows[wi];
+        w->pre = NULL;
+        w->exec = false;
+        w->wait_count = 0;
+        w->ready_count = 0;
+        w->depends_on_count = 0;
+        for (int pi = 0; pi < w->pane_count; pi++) {
+            Pane *pn = &w->panes[pi];
+            pn->command_count = 0;
+            pn->exec = false;
+            pn->wait_count = 0;
+            pn->ready_count = 0;
+            pn->depends_on_count = 0;
+            pn->after_count = 0;
+            pn->turn_after = -1;
+            pn->signal_count = 0;
+        }
+    }
+}
+
+static long long clock_us(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* 2 for a command that makes the session, 1 for one that makes a window or
+ * splits a pane, or 0 */
+static int creates_pane(Str *name, const char *command) {
+    static const char *creators[] = {"new-session", "new", "new-window",
+                                     "neww",        "splitw", "split-window"};
+    str_clear(name);
+    trace_command_name(name, command);
+    const char *sub = strchr(str_cstr(name), ' ');
+    if (!sub) return 0;
+    for (int i = 0; i < (int)(sizeof(creators) / sizeof(creators[0])); i++) {
+        if (strcmp(sub + 1, creators[i]) == 0) return i < 2 ? 2 : 1;
+    }
+    return 0;
+}
+
+/* One start and stop. The start is timed from the commands the script
+ * reports, waiting for panes it leaves to the background. */
+static int bench_once(const char *start, const char *stop, const char *events, int expected,
+                      BenchResult *r, int run) {
+    long long t0 = clock_us(CLOCK_REALTIME);
+    int status = shell_exec_bash(start);
+    if (status != 0) {
+        fprintf(stderr, "mux: bench run %d: the start script exited with status %d\n", run + 1,
+                status);
+        return -1;
+    }
+
+    Arena a = arena_new();
+    Str name = str_new();
+    long long deadline = clock_us(CLOCK_MONOTONIC) + BENCH_PANE_TIMEOUT_MS * 1000LL;
+    long long session = -1;
+    long long *created = NULL;
+    int created_count = 0;
+    int ret = 0;
+    for (;;) {
+        arena_reset(&a);
+        TraceCommand *commands;
+        int skipped;
+        int n = trace_read_commands(&a, events, &commands, &skipped);
+        if (skipped > 0) {
+            fprintf(stderr, "mux: bench needs bash 5, which has EPOCHREALTIME\n");
+            ret = -1;
+            break;
+        }
+        created = arena_alloc(&a, sizeof(long long) * (size_t)(n + 1));
+        created_count = 0;
+        session = -1;
+        for (int i = 0; i < n; i++) {
+            const TraceCommand *c = &commands[i];
+            int creates = c->command && c->status == 0 ? creates_pane(&name, c->command) : 0;
+            if (creates == 0) continue;
+            created[created_count++] = c->end;
+            if (creates == 2 && session < 0) session = c->end;
+        }
+        if (created_count >= expected || clock_us(CLOCK_MONOTONIC) > deadline) break;
+        usleep(5000);
+    }
+
+    if (ret == 0 && session < 0) {
+        fprintf(stderr, "mux: bench run %d: the start script made no session\n", run + 1);
+        ret = -1;
+    } else if (ret == 0 && created_count < expected) {
+        fprintf(stderr, "mux: bench run %d: %d of %d panes were made within %d s\n", run + 1,
+                created_count, expected, BENCH_PANE_TIMEOUT_MS / 1000);
+        ret = -1;
+    }
+    if (ret == 0) {
+        qsort(created, (size_t)created_count, sizeof(long long), compare_long_long);
+        r->ms[BENCH_SESSION][run] = (double)(session - t0) / 1000.0;
+        r->ms[BENCH_PANES][run] = (double)(created[expected - 1] - t0) / 1000.0;
+    }
+    str_free(&name);
+    arena_free(&a);
+    if (ret != 0) return ret;
+
+    long long s0 = clock_us(CLOCK_MONOTONIC);
+    status = shell_exec_bash(stop);
+    r->ms[BENCH_STOP][run] = (double)(clock_us(CLOCK_MONOTONIC) - s0) / 1000.0;
+    if (status != 0) {
+        fprintf(stderr, "mux: bench run %d: the stop script exited with status %d\n", run + 1,
+                status);
+        return -1;
+    }
+    return 0;
+}
+
+/* tmux leaves a killed server's socket behind, and nothing else uses the
+ * bench server's name */
+static void remove_socket(const char *socket) {
+    const char *dir = getenv("TMUX_TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/tmux-%ld/%s", dir && dir[0] ? dir : "/tmp", (long)getuid(),
+             socket);
+    unlink(path);
+}
+
+int bench_run(Arena *a, const Project *p, int runs, BenchResult *r) {
+    r->runs = 0;
+    r->socket = p->socket_name;
+    for (int m = 0; m < BENCH_METRIC_COUNT; m++) {
+        r->ms[m] = arena_alloc(a, sizeof(double) * (size_t)runs);
+    }
+
+    /* Windows always have a pane */
+    int expected = 0;
+    for (int wi = 0; wi < p->window_count; wi++) {
+        expected += p->windows[wi].pane_count > 0 ? p->windows[wi].pane_count : 1;
+    }
+
+    const char *tmpdir = getenv("TMPDIR");
+    if (!tmpdir || !tmpdir[0]) tmpdir = "/tmp";
+    char *events = arena_alloc(a, strlen(tmpdir) + sizeof("/mux-bench-XXXXXX"));
+    sprintf(events, "%s/mux-bench-XXXXXX", tmpdir);
+    int fd = mkstemp(events);
+    if (fd < 0) {
+        fprintf(stderr, "mux: cannot create %s: ", events);
+        perror(NULL);
+        return -1;
+    }
+    close(fd);
+    setenv("MUX_TRACE_EVENTS", events, 1);
+
+    char *start = script_generate_start(p);
+    char *stop = script_generate_stop(p);
+    char *kill = script_generate_kill_server(p);
+    const char *programs[] = {p->tmux_command && p->tmux_command[0] ? p->tmux_command : "tmux"};
+    Str traced = str_new();
+    trace_append_wrappers(&traced, programs, 1);
+    str_append(&traced, start);
+
+    int ret = 0;
+    for (int run = 0; run < runs && ret == 0; run++) {
+        /* Each run starts its own server */
+        shell_exec_bash(kill);
+        FILE *f = fopen(events, "w");
+        if (f) fclose(f);
+        ret = bench_once(str_cstr(&traced), stop, events, expected, r, run);
+        if (ret == 0) r->runs++;
+    }
+
+    shell_exec_bash(kill);
+    remove_socket(p->socket_name);
+    unsetenv("MUX_TRACE_EVENTS");
+    unlink(events);
+    str_free(&traced);
+    free(start);
+    free(stop);
+    free(kill);
+    return ret;
+}
+
+double bench_percentile(const double *values, int n, double q) {
+    if (n <= 0) return 0.0;
+    double *sorted = malloc(sizeof(double) * (size_t)n);
+    memcpy(sorted, values, sizeof(double) * (size_t)n);
+    qsort(sorted, (size_t)n, sizeof(double), compare_double);
+    /* The smallest value with at least q of the values at or below it */
+    int rank = (int)(q * n);
+    if (rank < q * n) rank++;
+    rank--;
+    if (rank < 0) rank = 0;
+    if (rank > n - 1) rank = n - 1;
+    double result = sorted[rank];
+    free(sorted);
+    return result;
+}
+
+void bench_format_table(const BenchResult *r, const Project *p, Str *out) {
+    str_appendf(out, "Bench of %s: %d run%s on tmux -L %s%s\n\n", p->name, r->runs,
+                r->runs == 1 ? "" : "s", r->socket, r->stubbed ? ", pane commands stubbed" : "");
+    str_appendf(out, "%-22s", "");
+    for (int k = 0; k < QUANTILE_COUNT; k++) str_appendf(out, "%10s", quantiles[k].name);
+    str_append_char(out, '\n');
+    for (int m = 0; m < BENCH_METRIC_COUNT; m++) {
+        str_appendf(out, "%-22s", metric_labels[m]);
+        for (int k = 0; k < QUANTILE_COUNT; k++) {
+            str_appendf(out, "%10.2f", bench_percentile(r->ms[m], r->runs, quantiles[k].q));
+        }
+        str_append_char(out, '\n');
+    }
+}
+
+void bench_format_json(const BenchResult *r, const Project *p, Str *out) {
+    str_append(out, "{\"project\": ");
+    str_append_json(out, p->name);
+    str_appendf(out, ", \"runs\": %d, \"socket\": ", r->runs);
+    str_append_json(out, r->socket);
+    str_appendf(out, ", \"stubbed\": %s", r->stubbed ? "true" : "false");
+    for (int m = 0; m < BENCH_METRIC_COUNT; m++) {
+        str_appendf(out, ", \"%s\": {", metric_keys[m]);
+        for (int k = 0; k < QUANTILE_COUNT; k++) {
+            str_appendf(out, "\"%s\": %.3f, ", quantiles[k].name,
+                        bench_percentile(r->ms[m], r->runs, quantiles[k].q));
+        }
+        str_append(out, "\"samples\": [");
+        for (int i = 0; i < r->runs; i++) {
+            str_appendf(out, "%s%.3f", i ? ", " : "", r->ms[m][i]);
+        }
+        str_append(out, "]}");
+    }
+    str_append(out, "}\n");
+}
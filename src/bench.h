@@ -0,0 +1,48 @@
+#ifndef MUX_BENCH_H
+#define MUX_BENCH_H
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "project.h"
+#include "str.h"
+
+/* `mux bench`: start and stop a project over and over on a private tmux
+ * server and time each run from the commands the start script reports. */
+
+#define BENCH_DEFAULT_RUNS 10
+
+typedef enum {
+    BENCH_SESSION, /* until new-session returns */
+    BENCH_PANES,   /* until the last of the project's panes exists */
+    BENCH_STOP,    /* the stop script, from start to exit */
+    BENCH_METRIC_COUNT,
+} BenchMetric;
+
+typedef struct {
+    int runs;
+    const char *socket; /* tmux -L name of the private server */
+    bool stubbed;
+    double *ms[BENCH_METRIC_COUNT]; /* each run's times, in run order */
+} BenchResult;
+
+/* Point p at its own server named socket and keep it from attaching. No
+ * pool of warm windows survives a run, so prewarm is off. With stub, panes
+ * get no commands, pre_window, waits or readiness, and hooks are dropped,
+ * leaving what mux and tmux themselves cost. */
+void bench_prepare(Project *p, char *socket, bool stub);
+
+/* Start and stop p runs times on a fresh server each time, then kill the
+ * server. r->stubbed is left to the caller. Returns 0, or -1 after
+ * reporting the failed run. */
+int bench_run(Arena *a, const Project *p, int runs, BenchResult *r);
+
+/* The q-quantile (0 to 1) of n values by nearest rank. values need not be
+ * sorted and are left as they are. */
+double bench_percentile(const double *values, int n, double q);
+
+/* Append the result as a table of percentiles, or as JSON with every run. */
+void bench_format_table(const BenchResult *r, const Project *p, Str *out);
+void bench_format_json(const BenchResult *r, const Project *p, Str *out);
+
+#endif
@@ -1,12 +1,18 @@
 #include "cli.h"
 
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static Command parse_command(const char *cmd) {
     if (strcmp(cmd, "start") == 0 || strcmp(cmd, "s") == 0) return CMD_START;
     if (strcmp(cmd, "stop") == 0) return CMD_STOP;
+    if (strcmp(cmd, "prewarm") == 0) return CMD_PREWARM;
+    if (strcmp(cmd, "layout") == 0) return CMD_LAYOUT;
+    if (strcmp(cmd, "plan") == 0) return CMD_PLAN;
+    if (strcmp(cmd, "bench") == 0) return CMD_BENCH;
     if (strcmp(cmd, "new") == 0 || strcmp(cmd, "n") == 0) return CMD_NEW;
     if (strcmp(cmd, "edit") == 0 || strcmp(cmd, "e") == 0 || strcmp(cmd, "open") == 0 ||
         strcmp(cmd, "o") == 0)
@@ -25,6 +31,10 @@ static Command parse_command(const char *cmd) {
     if (strcmp(cmd, "version") == 0 || strcmp(cmd, "v") == 0) return CMD_VERSION;
     if (strcmp(cmd, "help") == 0 || strcmp(cmd, "h") == 0) return CMD_HELP;
     if (strcmp(cmd, "completions") == 0) return CMD_COMPLETIONS;
+    if (strcmp(cmd, "wait-for") == 0) return CMD_WAIT_FOR;
+    if (strcmp(cmd, "priority") == 0) return CMD_PRIORITY;
+    if (strcmp(cmd, "lazy-start") == 0) return CMD_LAZY_START;
+    if (strcmp(cmd, "hook-digest") == 0) return CMD_HOOK_DIGEST;
     return CMD_NONE;
 }
 
@@ -60,18 +70,35 @@ int cli_parse(int argc, char **argv, CliArgs *args) {
         return 0;
     }
 
+    /* Internal commands parse their own arguments, passed on as settings */
+    if (args->command == CMD_WAIT_FOR || args->command == CMD_PRIORITY ||
+        args->command == CMD_LAZY_START || args->command == CMD_HOOK_DIGEST) {
+        args->settings = (const char **)&argv[2];
+        args->setting_count = argc - 2;
+        return 0;
+    }
+
     /* Parse remaining arguments based on command */
     static struct option long_opts[] = {
         {"append", no_argument, 0, 'a'},     {"backend", required_argument, 0, 'b'},
         {"name", required_argument, 0, 'n'}, {"project-config", required_argument, 0, 'p'},
-        {"active", no_argument, 0, 'A'},     {0, 0, 0, 0},
+        {"active", no_argument, 0, 'A'},     {"jobs", required_argument, 0, 'j'},
+        {"plan", no_argument, 0, 'P'},       {"cost", no_argument, 0, 'C'},
+        {"json", no_argument, 0, 'J'},       {"calibrate", required_argument, 0, 'K'},
+        {"trace", required_argument, 0, 'T'}, {"runs", required_argument, 0, 'R'},
+        {"stub", no_argument, 0, 'S'},
+        {0, 0, 0, 0},
     };
 
-    /* Reset getopt */
+    /* Reset getopt, past the subcommand of layout */
     optind = 2;
+    if (args->command == CMD_LAYOUT && argc > 2 && argv[2][0] != '-') {
+        args->layout_action = argv[2];
+        optind = 3;
+    }
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "+ab:n:p:A", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "+ab:n:p:Aj:", long_opts, NULL)) != -1) {
         switch (opt) {
         case 'a':
             args->append = true;
@@ -88,6 +115,46 @@ int cli_parse(int argc, char **argv, CliArgs *args) {
         case 'A':
             args->active_only = true;
             break;
+        case 'j': {
+            char *end = NULL;
+            errno = 0;
+            long jobs = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || errno != 0 || jobs < 1 || jobs > 1024) {
+                fprintf(stderr, "mux: --jobs needs a number from 1 to 1024\n");
+                return -1;
+            }
+            args->jobs = (int)jobs;
+            break;
+        }
+        case 'P':
+            args->plan = true;
+            break;
+        case 'C':
+            args->cost = true;
+            break;
+        case 'J':
+            args->json = true;
+            break;
+        case 'K':
+            args->calibrate = optarg;
+            break;
+        case 'T':
+            args->trace = optarg;
+            break;
+        case 'R': {
+            char *end = NULL;
+            errno = 0;
+            long runs = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || errno != 0 || runs < 1 || runs > 100000) {
+                fprintf(stderr, "mux: --runs needs a number from 1 to 100000\n");
+                return -1;
+            }
+            args->runs = (int)runs;
+            break;
+        }
+        case 'S':
+            args->stub = true;
+            break;
         default:
             break;
         }
@@ -127,6 +194,10 @@ void cli_usage(void) {
     printf("Commands:\n");
     printf("  start, s <project>       Start a tmux session\n");
     printf("  stop <project>           Stop a tmux session\n");
+    printf("  prewarm <project>        Keep warm tmux windows ready for starts\n");
+    printf("  layout save <project>    Keep the session's window layouts for next starts\n");
+    printf("  plan <project>           Print the launch plan, or its cost with --cost\n");
+    printf("  bench <project>          Time starts and stops on a private tmux server\n");
     printf("  new, n [project]         Create a new project config\n");
     printf("  edit, e, open, o <proj>  Edit a project config\n");
     printf("  copy, cp, c <src> <dst>  Copy a project config\n");
@@ -146,6 +217,16 @@ void cli_usage(void) {
     printf("  -n, --name NAME          Override session name\n");
     printf("  -p, --project-config P   Specify config file path\n");
     printf("  -A, --active             Only list active sessions (for list)\n");
+    printf("  -j, --jobs N             Build up to N windows at once (for start)\n");
+    printf("      --plan               Print the launch plan (for debug)\n");
+    printf("      --cost               Print spawns, round trips and more per backend\n");
+    printf("                           (for plan)\n");
+    printf("      --json               Print the cost or timings as JSON (for plan, bench)\n");
+    printf("      --calibrate SPEC     Estimate time from ms per spawn, e.g. tmux=1.5,herdr=9\n");
+    printf("                           (for plan)\n");
+    printf("      --trace FILE         Write a Perfetto trace of the start to FILE (for start)\n");
+    printf("      --runs N             Start the project N times, 10 by default (for bench)\n");
+    printf("      --stub               Leave pane commands and hooks out (for bench)\n");
     printf("\nShortcut:\n");
     printf("  mux <project>            Same as mux start <project>\n");
 }
@@ -9,6 +9,10 @@ typedef enum {
     CMD_NONE = 0,
     CMD_START,
     CMD_STOP,
+    CMD_PREWARM,
+    CMD_LAYOUT,
+    CMD_PLAN,
+    CMD_BENCH,
     CMD_NEW,
     CMD_EDIT,
     CMD_COPY,
@@ -22,6 +26,10 @@ typedef enum {
     CMD_VERSION,
     CMD_HELP,
     CMD_COMPLETIONS,
+    CMD_WAIT_FOR,    /* internal: readiness gates for generated scripts */
+    CMD_PRIORITY,    /* internal: pane process priority for generated scripts */
+    CMD_LAZY_START,  /* internal: first selection of a lazy window */
+    CMD_HOOK_DIGEST, /* internal: memoised hook stamps for generated scripts */
 } Command;
 
 typedef struct {
@@ -32,8 +40,17 @@ typedef struct {
     const char *override_name;    /* --name override */
     const char *backend;          /* tmux or herdr */
     const char *completion_shell; /* bash, zsh, or fish */
+    const char *layout_action;    /* layout subcommand: save */
     bool append;                  /* --append flag */
     bool active_only;             /* --active flag for list */
+    int jobs;                     /* --jobs: windows built at once; 0 builds them in order */
+    bool plan;                    /* debug --plan: print the launch plan */
+    bool cost;                    /* plan --cost: print the start-cost model */
+    bool json;                    /* plan --json: print it as JSON */
+    const char *calibrate;        /* plan --calibrate: measured ms per spawn by program */
+    const char *trace;            /* start --trace: file to write a trace of the start to */
+    int runs;                     /* bench --runs: starts to time; 0 takes the default */
+    bool stub;                    /* bench --stub: leave pane commands out */
 
     /* Template settings: key=value pairs from extra args */
     const char **settings;
@@ -8,8 +8,8 @@ void completion_bash(void) {
            "    COMPREPLY=()\n"
            "    cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
            "    prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
-           "    commands=\"start stop new edit copy cp delete rm list debug local doctor implode "
-           "i stop-all version help completions\"\n"
+           "    commands=\"start stop prewarm layout plan bench new edit copy cp delete rm list "
+           "debug local doctor implode i stop-all version help completions\"\n"
            "\n"
            "    if [ $COMP_CWORD -eq 1 ]; then\n"
            "        COMPREPLY=( $(compgen -W \"$commands\" -- \"$cur\") )\n"
@@ -17,7 +17,16 @@ void completion_bash(void) {
            "    fi\n"
            "\n"
            "    case \"$prev\" in\n"
-           "        start|stop|debug|delete|rm|copy|cp|edit)\n"
+           "        start|stop|prewarm|plan|bench|debug|delete|rm|copy|cp|edit)\n"
+           "            projects=$(mux list 2>/dev/null)\n"
+           "            COMPREPLY=( $(compgen -W \"$projects\" -- \"$cur\") )\n"
+           "            return 0\n"
+           "            ;;\n"
+           "        layout)\n"
+           "            COMPREPLY=( $(compgen -W \"save\" -- \"$cur\") )\n"
+           "            return 0\n"
+           "            ;;\n"
+           "        save)\n"
            "            projects=$(mux list 2>/dev/null)\n"
            "            COMPREPLY=( $(compgen -W \"$projects\" -- \"$cur\") )\n"
            "            return 0\n"
@@ -39,6 +48,10 @@ void completion_zsh(void) {
            "    commands=(\n"
            "        'start:Start a tmux session'\n"
            "        'stop:Stop a tmux session'\n"
+           "        'prewarm:Keep warm tmux windows ready for starts'\n"
+           "        'layout:Keep window layouts for next starts'\n"
+           "        'plan:Print the launch plan or its cost'\n"
+           "        'bench:Time starts and stops on a private tmux server'\n"
            "        'new:Create a new project config'\n"
            "        'edit:Edit a project config'\n"
            "        'copy:Copy a project config'\n"
@@ -58,17 +71,26 @@ void completion_zsh(void) {
            "        _describe -t commands 'mux commands' commands\n"
            "    elif (( CURRENT == 3 )); then\n"
            "        case $words[2] in\n"
-           "            start|stop|debug|delete|rm|copy|cp|edit)\n"
+           "            start|stop|prewarm|plan|bench|debug|delete|rm|copy|cp|edit)\n"
            "                local -a projects\n"
            "                projects=(${(f)\"$(mux list 2>/dev/null)\"})\n"
            "                _describe -t projects 'projects' projects\n"
            "                ;;\n"
+           "            layout)\n"
+           "                local -a actions\n"
+           "                actions=(save)\n"
+           "                _describe -t actions 'layout actions' actions\n"
+           "                ;;\n"
            "            completions)\n"
            "                local -a shells\n"
            "                shells=(bash zsh fish)\n"
            "                _describe -t shells 'shells' shells\n"
            "                ;;\n"
            "        esac\n"
+           "    elif (( CURRENT == 4 )) && [[ $words[2] == layout ]]; then\n"
+           "        local -a projects\n"
+           "        projects=(${(f)\"$(mux list 2>/dev/null)\"})\n"
+           "        _describe -t projects 'projects' projects\n"
            "    fi\n"
            "}\n"
            "\n"
@@ -83,6 +105,10 @@ void completion_fish(void) {
         "# Commands\n"
         "complete -c mux -n '__fish_use_subcommand' -a start -d 'Start a tmux session'\n"
         "complete -c mux -n '__fish_use_subcommand' -a stop -d 'Stop a tmux session'\n"
+        "complete -c mux -n '__fish_use_subcommand' -a prewarm -d 'Keep warm windows ready'\n"
+        "complete -c mux -n '__fish_use_subcommand' -a layout -d 'Keep window layouts'\n"
+        "complete -c mux -n '__fish_use_subcommand' -a plan -d 'Print the launch plan'\n"
+        "complete -c mux -n '__fish_use_subcommand' -a bench -d 'Time starts and stops'\n"
         "complete -c mux -n '__fish_use_subcommand' -a new -d 'Create a new project config'\n"
         "complete -c mux -n '__fish_use_subcommand' -a edit -d 'Edit a project config'\n"
         "complete -c mux -n '__fish_use_subcommand' -a copy -d 'Copy a project config'\n"
@@ -103,8 +129,12 @@ void completion_fish(void) {
         "script'\n"
         "\n"
         "# Project name completions\n"
-        "complete -c mux -n '__fish_seen_subcommand_from start stop debug delete rm copy cp edit'"
-        "-a '(mux list 2>/dev/null)'\n"
+        "complete -c mux -n '__fish_seen_subcommand_from start stop prewarm plan bench debug "
+        "delete rm copy cp edit' -a '(mux list 2>/dev/null)'\n"
+        "\n"
+        "complete -c mux -n '__fish_seen_subcommand_from layout; and not "
+        "__fish_seen_subcommand_from save' -a save\n"
+        "complete -c mux -n '__fish_seen_subcommand_from save' -a '(mux list 2>/dev/null)'\n"
         "\n"
         "# Shell completions\n"
         "complete -c mux -n '__fish_seen_subcommand_from completions' -a 'bash zsh fish'\n");
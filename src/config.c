@@ -1,12 +1,18 @@
 #include "config.h"
 
+#include <ctype.h>
+#include <regex.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <yaml.h>
 
+#include "priority.h"
+#include "schedule.h"
 #include "str.h"
 #include "template.h"
+#include "trace.h"
 
 /* Map deprecated field names to canonical names */
 static const char *config_canonical_key(const char *key) {
@@ -80,6 +86,306 @@ static char **collect_commands(Arena *a, yaml_document_t *doc, yaml_node_t *node
     return *count > 0 ? cmds : NULL;
 }
 
+/* Return the HookKind for a hook config key, or -1 if key is not a hook. */
+static int hook_kind_for_key(const char *key) {
+    for (int k = 0; k < HOOK_COUNT; k++) {
+        if (strcmp(key, project_hook_name((HookKind)k)) == 0) return k;
+    }
+    return -1;
+}
+
+static char **hook_command(Project *p, HookKind kind) {
+    switch (kind) {
+    case HOOK_PROJECT_START:
+        return &p->on_project_start;
+    case HOOK_PROJECT_FIRST_START:
+        return &p->on_project_first_start;
+    case HOOK_PROJECT_RESTART:
+        return &p->on_project_restart;
+    case HOOK_PROJECT_EXIT:
+        return &p->on_project_exit;
+    case HOOK_PROJECT_STOP:
+        return &p->on_project_stop;
+    case HOOK_COUNT:
+        break;
+    }
+    return NULL;
+}
+
+/* Parse a duration such as "30", "30s", "2m" or "1h" into seconds.
+ * Returns -1 when the value is not a duration. */
+static int parse_duration(const char *value) {
+    char *end = NULL;
+    long n = strtol(value, &end, 10);
+    if (end == value || n < 0) return -1;
+    if (*end == '\0' || strcmp(end, "s") == 0) return (int)n;
+    if (strcmp(end, "m") == 0) return (int)(n * 60);
+    if (strcmp(end, "h") == 0) return (int)(n * 3600);
+    return -1;
+}
+
+/* Parse a non-negative count for key. Returns 0 on success, -1 on error. */
+static int parse_count(const char *key, const char *value, int *out) {
+    char *end = NULL;
+    long n = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || n < 0 || n > 100000) {
+        fprintf(stderr, "mux: %s must be a non-negative number, got '%s'\n", key, value);
+        return -1;
+    }
+    *out = (int)n;
+    return 0;
+}
+
+/* Parse a project hook. Hooks are a command string, a sequence of commands,
+ * or a mapping with "run" commands plus options: the "inputs" that memoise
+ * them, an execution "mode" and a "timeout". Returns 0 on success, -1 on error. */
+static int parse_hook(Arena *a, yaml_document_t *doc, yaml_node_t *node, Project *p,
+                      HookKind kind) {
+    char **run = hook_command(p, kind);
+    HookOptions *hook = &p->hooks[kind];
+    if (node->type != YAML_MAPPING_NODE) {
+        *run = join_yaml_sequence(a, doc, node);
+        return 0;
+    }
+
+    const char *name = project_hook_name(kind);
+    for (yaml_node_pair_t *pair = node->data.mapping.pairs.start;
+         pair < node->data.mapping.pairs.top; pair++) {
+        yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        yaml_node_t *val = yaml_document_get_node(doc, pair->value);
+        if (!key || !val || key->type != YAML_SCALAR_NODE) continue;
+
+        const char *hkey = (const char *)key->data.scalar.value;
+        if (strcmp(hkey, "run") == 0) {
+            *run = join_yaml_sequence(a, doc, val);
+        } else if (strcmp(hkey, "inputs") == 0) {
+            hook->inputs = collect_commands(a, doc, val, &hook->input_count);
+        } else if (strcmp(hkey, "mode") == 0 && val->type == YAML_SCALAR_NODE) {
+            const char *sv = (const char *)val->data.scalar.value;
+            if (strcmp(sv, "sync") == 0) {
+                hook->mode = HOOK_MODE_SYNC;
+            } else if (strcmp(sv, "background") == 0) {
+                hook->mode = HOOK_MODE_BACKGROUND;
+            } else if (strcmp(sv, "parallel") == 0) {
+                hook->mode = HOOK_MODE_PARALLEL;
+            } else if (strcmp(sv, "inline") != 0) {
+                fprintf(stderr, "mux: %s: unknown mode '%s' (use sync, background or parallel)\n",
+                        name, sv);
+                return -1;
+            }
+        } else if (strcmp(hkey, "timeout") == 0 && val->type == YAML_SCALAR_NODE) {
+            const char *sv = (const char *)val->data.scalar.value;
+            hook->timeout = parse_duration(sv);
+            if (hook->timeout < 0) {
+                fprintf(stderr, "mux: %s: invalid timeout '%s'\n", name, sv);
+                return -1;
+            }
+        }
+    }
+
+    /* A deadline needs a supervised hook; inline hooks are pasted verbatim */
+    if (hook->timeout > 0 && hook->mode == HOOK_MODE_INLINE) hook->mode = HOOK_MODE_SYNC;
+    return 0;
+}
+
+#define WAIT_DEFAULT_TIMEOUT 60
+
+/* Signal names become part of a tmux wait-for channel and of the command
+ * typed to signal it, so they are kept to letters, digits, '_', '-', '.'. */
+static bool is_signal_name(const char *name) {
+    if (!name[0]) return false;
+    for (const char *c = name; *c; c++) {
+        if (!isalnum((unsigned char)*c) && !strchr("_-.", *c)) return false;
+    }
+    return true;
+}
+
+/* Parse one wait_for mapping. Every condition key (tcp, file, output, signal) adds a
+ * gate; "from" and "timeout" apply to all gates in the same mapping. */
+static int parse_wait_mapping(Arena *a, yaml_document_t *doc, yaml_node_t *node, const char *what,
+                              WaitFor *waits, int *count) {
+    int first = *count;
+    const char *from = NULL;
+    int timeout = WAIT_DEFAULT_TIMEOUT;
+
+    for (yaml_node_pair_t *pair = node->data.mapping.pairs.start;
+         pair < node->data.mapping.pairs.top; pair++) {
+        yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        yaml_node_t *val = yaml_document_get_node(doc, pair->value);
+        if (!key || !val || key->type != YAML_SCALAR_NODE || val->type != YAML_SCALAR_NODE) {
+            continue;
+        }
+
+        const char *wkey = (const char *)key->data.scalar.value;
+        const char *sv = (const char *)val->data.scalar.value;
+        if (strcmp(wkey, "from") == 0) {
+            from = sv;
+        } else if (strcmp(wkey, "timeout") == 0) {
+            timeout = parse_duration(sv);
+            if (timeout <= 0) {
+                fprintf(stderr, "mux: %s: invalid timeout '%s'\n", what, sv);
+                return -1;
+            }
+        } else {
+            WaitFor *w = &waits[*count];
+            memset(w, 0, sizeof(WaitFor));
+            if (strcmp(wkey, "tcp") == 0) {
+                w->kind = WAIT_TCP;
+            } else if (strcmp(wkey, "file") == 0) {
+                w->kind = WAIT_FILE;
+            } else if (strcmp(wkey, "output") == 0) {
+                w->kind = WAIT_OUTPUT;
+            } else if (strcmp(wkey, "signal") == 0) {
+                w->kind = WAIT_SIGNAL;
+            } else {
+                fprintf(stderr,
+                        "mux: %s: unknown condition '%s' (use tcp, file, output or signal)\n",
+                        what, wkey);
+                return -1;
+            }
+
+            /* Output patterns may be written /like this/ */
+            size_t len = strlen(sv);
+            if (w->kind == WAIT_OUTPUT && len >= 2 && sv[0] == '/' && sv[len - 1] == '/') {
+                w->target = arena_strndup(a, sv + 1, len - 2);
+            } else {
+                w->target = arena_strdup(a, sv);
+            }
+            if (w->kind == WAIT_OUTPUT) {
+                regex_t re;
+                if (regcomp(&re, w->target, REG_EXTENDED | REG_NOSUB) != 0) {
+                    fprintf(stderr, "mux: %s: invalid output pattern '%s'\n", what, sv);
+                    return -1;
+                }
+                regfree(&re);
+            }
+            if (w->kind == WAIT_SIGNAL && !is_signal_name(w->target)) {
+                fprintf(stderr, "mux: %s: invalid signal name '%s'\n", what, sv);
+                return -1;
+            }
+            (*count)++;
+        }
+    }
+
+    for (int i = first; i < *count; i++) {
+        waits[i].timeout = timeout;
+        if (waits[i].kind == WAIT_OUTPUT && from) waits[i].from = arena_strdup(a, from);
+    }
+    return 0;
+}
+
+/* Parse a wait_for (or ready) value: a mapping of conditions or a sequence
+ * of them. */
+static int parse_wait_for(Arena *a, yaml_document_t *doc, yaml_node_t *node, const char *what,
+                          WaitFor **waits, int *count) {
+    int n = 0;
+    if (node->type == YAML_MAPPING_NODE) {
+        n = (int)(node->data.mapping.pairs.top - node->data.mapping.pairs.start);
+    } else if (node->type == YAML_SEQUENCE_NODE) {
+        for (yaml_node_item_t *item = node->data.sequence.items.start;
+             item < node->data.sequence.items.top; item++) {
+            yaml_node_t *m = yaml_document_get_node(doc, *item);
+            if (m && m->type == YAML_MAPPING_NODE) {
+                n += (int)(m->data.mapping.pairs.top - m->data.mapping.pairs.start);
+            }
+        }
+    } else {
+        fprintf(stderr, "mux: %s must be a mapping such as {tcp: 5432}\n", what);
+        return -1;
+    }
+
+    *count = 0;
+    *waits = n > 0 ? arena_alloc(a, sizeof(WaitFor) * (size_t)n) : NULL;
+    if (node->type == YAML_MAPPING_NODE) {
+        return parse_wait_mapping(a, doc, node, what, *waits, count);
+    }
+
+    for (yaml_node_item_t *item = node->data.sequence.items.start;
+         item < node->data.sequence.items.top; item++) {
+        yaml_node_t *m = yaml_document_get_node(doc, *item);
+        if (!m || m->type != YAML_MAPPING_NODE) continue;
+        if (parse_wait_mapping(a, doc, m, what, *waits, count) != 0) return -1;
+    }
+    return 0;
+}
+
+static bool is_priority_key(const char *key) {
+    return strcmp(key, "nice") == 0 || strcmp(key, "ionice") == 0 ||
+           strcmp(key, "cpu_affinity") == 0;
+}
+
+/* Parse a nice, ionice or cpu_affinity option into prio. Returns 0 or -1. */
+static int parse_priority(Arena *a, yaml_document_t *doc, const char *key, yaml_node_t *node,
+                          Priority *prio) {
+    const char *sv = node->type == YAML_SCALAR_NODE ? (const char *)node->data.scalar.value : "";
+    if (strcmp(key, "nice") == 0) {
+        char *end = NULL;
+        long n = strtol(sv, &end, 10);
+        if (end == sv || *end != '\0' || n < -20 || n > 19) {
+            fprintf(stderr, "mux: nice must be a number from -20 to 19, got '%s'\n", sv);
+            return -1;
+        }
+        prio->has_nice = true;
+        prio->nice = (int)n;
+        return 0;
+    }
+    if (strcmp(key, "ionice") == 0) {
+        IoniceClass cls;
+        int level;
+        if (priority_parse_ionice(sv, &cls, &level) != 0) {
+            fprintf(stderr,
+                    "mux: ionice must be idle, best-effort[:0-7] or realtime[:0-7], got '%s'\n",
+                    sv);
+            return -1;
+        }
+        prio->ionice = arena_strdup(a, sv);
+        return 0;
+    }
+
+    /* A list of CPUs or ranges, or one string such as "0-3,8" */
+    Str list = str_new();
+    if (node->type == YAML_SEQUENCE_NODE) {
+        for (yaml_node_item_t *item = node->data.sequence.items.start;
+             item < node->data.sequence.items.top; item++) {
+            yaml_node_t *val = yaml_document_get_node(doc, *item);
+            if (list.len > 0) str_append_char(&list, ',');
+            if (val && val->type == YAML_SCALAR_NODE) {
+                str_append(&list, (const char *)val->data.scalar.value);
+            }
+        }
+    } else {
+        str_append(&list, sv);
+    }
+    int *cpus = malloc(sizeof(int) * PRIORITY_CPU_MAX);
+    int rc = priority_parse_cpus(str_cstr(&list), cpus, PRIORITY_CPU_MAX) > 0 ? 0 : -1;
+    if (rc == 0) {
+        prio->cpu_affinity = arena_strdup(a, str_cstr(&list));
+    } else {
+        fprintf(stderr, "mux: cpu_affinity must list CPUs such as 0-3,8, got '%s'\n",
+                str_cstr(&list));
+    }
+    free(cpus);
+    str_free(&list);
+    return rc;
+}
+
+/* Named pane: { title: command } or { title: [commands] } */
+static void parse_pane_title(Arena *a, yaml_document_t *doc, const char *title, yaml_node_t *val,
+                             Pane *pane) {
+    pane->title = arena_strdup(a, title);
+    if (val->type == YAML_SCALAR_NODE) {
+        const char *sv = (const char *)val->data.scalar.value;
+        if (sv[0] != '\0') {
+            pane->commands = arena_alloc(a, sizeof(char *) * 2);
+            pane->commands[0] = arena_strdup(a, sv);
+            pane->commands[1] = NULL;
+            pane->command_count = 1;
+        }
+    } else if (val->type == YAML_SEQUENCE_NODE) {
+        pane->commands = collect_commands(a, doc, val, &pane->command_count);
+    }
+}
+
 static int parse_pane(Arena *a, yaml_document_t *doc, yaml_node_t *node, Pane *pane) {
     memset(pane, 0, sizeof(Pane));
 
@@ -102,7 +408,10 @@ static int parse_pane(Arena *a, yaml_document_t *doc, yaml_node_t *node, Pane *p
     }
 
     if (node->type == YAML_MAPPING_NODE) {
-        /* Named pane: { title: [commands] } */
+        /* Named pane: { title: [commands] }, optionally with pane options
+         * such as wait_for alongside the title. A lone key is always the
+         * title, so a pane titled signal or nice parses as it always has. */
+        bool options = node->data.mapping.pairs.top - node->data.mapping.pairs.start > 1;
         for (yaml_node_pair_t *pair = node->data.mapping.pairs.start;
              pair < node->data.mapping.pairs.top; pair++) {
             yaml_node_t *key = yaml_document_get_node(doc, pair->key);
@@ -110,19 +419,33 @@ static int parse_pane(Arena *a, yaml_document_t *doc, yaml_node_t *node, Pane *p
             if (!key || !val) continue;
             if (key->type != YAML_SCALAR_NODE) continue;
 
-            pane->title = arena_strdup(a, (const char *)key->data.scalar.value);
-            if (val->type == YAML_SCALAR_NODE) {
-                const char *sv = (const char *)val->data.scalar.value;
-                if (sv[0] != '\0') {
-                    pane->commands = arena_alloc(a, sizeof(char *) * 2);
-                    pane->commands[0] = arena_strdup(a, sv);
-                    pane->commands[1] = NULL;
-                    pane->command_count = 1;
+            const char *pkey = (const char *)key->data.scalar.value;
+            int rc = 0;
+            if (!options) {
+                parse_pane_title(a, doc, pkey, val, pane);
+            } else if (strcmp(pkey, "wait_for") == 0) {
+                rc = parse_wait_for(a, doc, val, pkey, &pane->waits, &pane->wait_count);
+            } else if (strcmp(pkey, "ready") == 0) {
+                rc = parse_wait_for(a, doc, val, pkey, &pane->ready, &pane->ready_count);
+            } else if (strcmp(pkey, "depends_on") == 0) {
+                pane->depends_on = collect_commands(a, doc, val, &pane->depends_on_count);
+            } else if (is_priority_key(pkey)) {
+                rc = parse_priority(a, doc, pkey, val, &pane->priority);
+            } else if (strcmp(pkey, "signal") == 0) {
+                pane->signals = collect_commands(a, doc, val, &pane->signal_count);
+                for (int i = 0; i < pane->signal_count && rc == 0; i++) {
+                    if (!is_signal_name(pane->signals[i])) {
+                        fprintf(stderr, "mux: invalid signal name '%s'\n", pane->signals[i]);
+                        rc = -1;
+                    }
                 }
-            } else if (val->type == YAML_SEQUENCE_NODE) {
-                pane->commands = collect_commands(a, doc, val, &pane->command_count);
+            } else if (strcmp(pkey, "exec") == 0 && val->type == YAML_SCALAR_NODE) {
+                const char *sv = (const char *)val->data.scalar.value;
+                pane->exec = strcmp(sv, "true") == 0 || strcmp(sv, "1") == 0;
+            } else if (!pane->title) { /* only first title key */
+                parse_pane_title(a, doc, pkey, val, pane);
             }
-            break; /* only first key */
+            if (rc != 0) return -1;
         }
         return 0;
     }
@@ -130,10 +453,101 @@ static int parse_pane(Arena *a, yaml_document_t *doc, yaml_node_t *node, Pane *p
     return 0;
 }
 
+/* True when anything in the window waits on a condition or another pane. */
+static bool window_is_gated(const Window *win) {
+    if (win->wait_count > 0 || win->ready_count > 0 || win->depends_on_count > 0) return true;
+    for (int i = 0; i < win->pane_count; i++) {
+        const Pane *pn = &win->panes[i];
+        if (pn->wait_count > 0 || pn->ready_count > 0 || pn->depends_on_count > 0) return true;
+    }
+    return false;
+}
+
+/* Exec panes start their command as the window is built, so nothing can hold
+ * it back. A window-level exec applies to every pane. */
+static int check_exec_panes(Window *win) {
+    for (int i = 0; i < win->pane_count; i++) {
+        Pane *pn = &win->panes[i];
+        pn->exec = pn->exec || win->exec;
+        if (pn->exec && (win->wait_count > 0 || win->depends_on_count > 0 ||
+                         pn->wait_count > 0 || pn->depends_on_count > 0)) {
+            fprintf(stderr, "mux: exec pane %s.%d cannot use wait_for or depends_on\n",
+                    win->name, i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Parse a layout split: a mapping with "columns" or "rows", each a list of
+ * entries given as a relative size, or as a nested split with an optional
+ * "size". Returns 0 on success, -1 on error. */
+static int parse_layout_split(Arena *a, yaml_document_t *doc, yaml_node_t *node,
+                              const Window *win, LayoutCell *cell) {
+    yaml_node_t *entries = NULL;
+    const char *size = "1";
+    for (yaml_node_pair_t *pair = node->data.mapping.pairs.start;
+         pair < node->data.mapping.pairs.top; pair++) {
+        yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        yaml_node_t *val = yaml_document_get_node(doc, pair->value);
+        if (!key || !val || key->type != YAML_SCALAR_NODE) continue;
+        const char *k = (const char *)key->data.scalar.value;
+        if (strcmp(k, "columns") == 0 || strcmp(k, "rows") == 0) {
+            cell->kind = k[0] == 'c' ? LAYOUT_COLUMNS : LAYOUT_ROWS;
+            entries = val;
+        } else if (strcmp(k, "size") == 0 && val->type == YAML_SCALAR_NODE) {
+            size = (const char *)val->data.scalar.value;
+        }
+    }
+
+    char *end = NULL;
+    long weight = strtol(size, &end, 10);
+    if (end == size || *end != '\0' || weight < 1 || weight > 1000) {
+        fprintf(stderr, "mux: window '%s': layout sizes must be from 1 to 1000, got '%s'\n",
+                win->name, size);
+        return -1;
+    }
+    cell->weight = (int)weight;
+    int n = entries && entries->type == YAML_SEQUENCE_NODE
+                ? (int)(entries->data.sequence.items.top - entries->data.sequence.items.start)
+                : 0;
+    if (n < 2) {
+        fprintf(stderr, "mux: window '%s': layout needs columns or rows of two or more entries\n",
+                win->name);
+        return -1;
+    }
+
+    cell->children = arena_alloc(a, sizeof(LayoutCell) * (size_t)n);
+    memset(cell->children, 0, sizeof(LayoutCell) * (size_t)n);
+    cell->child_count = n;
+    for (int i = 0; i < n; i++) {
+        yaml_node_t *entry = yaml_document_get_node(doc, entries->data.sequence.items.start[i]);
+        LayoutCell *child = &cell->children[i];
+        if (entry && entry->type == YAML_MAPPING_NODE) {
+            if (parse_layout_split(a, doc, entry, win, child) != 0) return -1;
+            continue;
+        }
+        const char *sv = entry && entry->type == YAML_SCALAR_NODE
+                             ? (const char *)entry->data.scalar.value
+                             : "";
+        weight = strtol(sv, &end, 10);
+        if (end == sv || *end != '\0' || weight < 1 || weight > 1000) {
+            fprintf(stderr, "mux: window '%s': layout sizes must be from 1 to 1000, got '%s'\n",
+                    win->name, sv);
+            return -1;
+        }
+        child->kind = LAYOUT_PANE;
+        child->weight = (int)weight;
+    }
+    return 0;
+}
+
+/* Parse a window entry. Returns 0 on success, 1 if the entry is not a
+ * window and should be skipped, -1 on error. */
 static int parse_window(Arena *a, yaml_document_t *doc, yaml_node_t *node, Window *win) {
     memset(win, 0, sizeof(Window));
 
-    if (node->type != YAML_MAPPING_NODE) return -1;
+    if (node->type != YAML_MAPPING_NODE) return 1;
 
     /* Each window is a mapping with a single key (window name) → mapping or scalar */
     for (yaml_node_pair_t *pair = node->data.mapping.pairs.start;
@@ -175,6 +589,10 @@ static int parse_window(Arena *a, yaml_document_t *doc, yaml_node_t *node, Windo
 
                 if (strcmp(wkey, "layout") == 0 && wv->type == YAML_SCALAR_NODE) {
                     win->layout = arena_strdup(a, (const char *)wv->data.scalar.value);
+                } else if (strcmp(wkey, "layout") == 0 && wv->type == YAML_MAPPING_NODE) {
+                    win->layout_spec = arena_alloc(a, sizeof(LayoutCell));
+                    memset(win->layout_spec, 0, sizeof(LayoutCell));
+                    if (parse_layout_split(a, doc, wv, win, win->layout_spec) != 0) return -1;
                 } else if (strcmp(wkey, "root") == 0 && wv->type == YAML_SCALAR_NODE) {
                     win->root = arena_strdup(a, (const char *)wv->data.scalar.value);
                 } else if (strcmp(wkey, "focused_pane") == 0 && wv->type == YAML_SCALAR_NODE) {
@@ -191,6 +609,24 @@ static int parse_window(Arena *a, yaml_document_t *doc, yaml_node_t *node, Windo
                     } else {
                         win->synchronize = arena_strdup(a, sv);
                     }
+                } else if (strcmp(wkey, "wait_for") == 0) {
+                    if (parse_wait_for(a, doc, wv, wkey, &win->waits, &win->wait_count) != 0) {
+                        return -1;
+                    }
+                } else if (strcmp(wkey, "ready") == 0) {
+                    if (parse_wait_for(a, doc, wv, wkey, &win->ready, &win->ready_count) != 0) {
+                        return -1;
+                    }
+                } else if (strcmp(wkey, "depends_on") == 0) {
+                    win->depends_on = collect_commands(a, doc, wv, &win->depends_on_count);
+                } else if (is_priority_key(wkey)) {
+                    if (parse_priority(a, doc, wkey, wv, &win->priority) != 0) return -1;
+                } else if (strcmp(wkey, "lazy") == 0 && wv->type == YAML_SCALAR_NODE) {
+                    const char *sv = (const char *)wv->data.scalar.value;
+                    win->lazy = strcmp(sv, "true") == 0 || strcmp(sv, "1") == 0;
+                } else if (strcmp(wkey, "exec") == 0 && wv->type == YAML_SCALAR_NODE) {
+                    const char *sv = (const char *)wv->data.scalar.value;
+                    win->exec = strcmp(sv, "true") == 0 || strcmp(sv, "1") == 0;
                 } else if (strcmp(wkey, "panes") == 0 && wv->type == YAML_SEQUENCE_NODE) {
                     int n = (int)(wv->data.sequence.items.top - wv->data.sequence.items.start);
                     if (n > 0) {
@@ -200,7 +636,9 @@ static int parse_window(Arena *a, yaml_document_t *doc, yaml_node_t *node, Windo
                              item < wv->data.sequence.items.top; item++) {
                             yaml_node_t *pnode = yaml_document_get_node(doc, *item);
                             if (!pnode) continue;
-                            parse_pane(a, doc, pnode, &win->panes[win->pane_count]);
+                            if (parse_pane(a, doc, pnode, &win->panes[win->pane_count]) != 0) {
+                                return -1;
+                            }
                             win->pane_count++;
                         }
                     }
@@ -212,6 +650,18 @@ static int parse_window(Arena *a, yaml_document_t *doc, yaml_node_t *node, Windo
                 memset(win->panes, 0, sizeof(Pane));
                 win->pane_count = 1;
             }
+            if (win->layout_spec && layout_pane_count(win->layout_spec) != win->pane_count) {
+                fprintf(stderr, "mux: window '%s': layout has %d panes but the window has %d\n",
+                        win->name, layout_pane_count(win->layout_spec), win->pane_count);
+                return -1;
+            }
+            if (win->lazy && window_is_gated(win)) {
+                fprintf(stderr,
+                        "mux: lazy window '%s' cannot use wait_for, ready or depends_on\n",
+                        win->name);
+                return -1;
+            }
+            if (check_exec_panes(win) != 0) return -1;
         }
 
         break; /* only first key in window mapping */
@@ -219,6 +669,147 @@ static int parse_window(Arena *a, yaml_document_t *doc, yaml_node_t *node, Windo
     return 0;
 }
 
+/* Resolve the pane an output condition watches. "from" names a window (its
+ * first pane), a "window.pane" index, or a pane title in the same window.
+ * Without it a wait_for gate watches the previous pane and a ready condition
+ * watches its own pane (pi is -1 for window-level conditions). */
+static int resolve_wait_source(const Project *p, WaitFor *w, int wi, int pi, bool ready) {
+    const char *name = p->windows[wi].name ? p->windows[wi].name : "";
+    const char *key = ready ? "ready" : "wait_for";
+    w->source_window = -1;
+    w->source_pane = 0;
+
+    if (w->from) {
+        if (project_find_pane(p, w->from, wi, &w->source_window, &w->source_pane) == 0 &&
+            w->source_pane < 0) {
+            w->source_pane = 0;
+        }
+    } else if (ready) {
+        w->source_window = wi;
+        w->source_pane = pi < 0 ? 0 : pi;
+    } else if (pi > 0) {
+        w->source_window = wi;
+        w->source_pane = pi - 1;
+    } else if (wi > 0) {
+        w->source_window = wi - 1;
+    }
+
+    if (w->source_window < 0) {
+        if (w->from) {
+            fprintf(stderr, "mux: %s in window '%s': no pane matches from: %s\n", key, name,
+                    w->from);
+        } else {
+            fprintf(stderr, "mux: %s in window '%s': no previous pane to watch; set from:\n", key,
+                    name);
+        }
+        return -1;
+    }
+    /* A window-level gate holds back every pane in its own window */
+    if (!ready && w->source_window == wi && (pi < 0 || w->source_pane == pi)) {
+        fprintf(stderr, "mux: %s in window '%s': cannot wait for its own output\n", key, name);
+        return -1;
+    }
+    return 0;
+}
+
+static int resolve_wait_list(const Project *p, WaitFor *waits, int count, int wi, int pi,
+                             bool ready) {
+    for (int k = 0; k < count; k++) {
+        if (waits[k].kind != WAIT_OUTPUT) continue;
+        if (resolve_wait_source(p, &waits[k], wi, pi, ready) != 0) return -1;
+    }
+    return 0;
+}
+
+static int resolve_wait_sources(Project *p) {
+    for (int i = 0; i < p->window_count; i++) {
+        Window *win = &p->windows[i];
+        if (resolve_wait_list(p, win->waits, win->wait_count, i, -1, false) != 0 ||
+            resolve_wait_list(p, win->ready, win->ready_count, i, -1, true) != 0) {
+            return -1;
+        }
+        for (int j = 0; j < win->pane_count; j++) {
+            Pane *pane = &win->panes[j];
+            if (resolve_wait_list(p, pane->waits, pane->wait_count, i, j, false) != 0 ||
+                resolve_wait_list(p, pane->ready, pane->ready_count, i, j, true) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Find the pane that sends a signal. Returns 1 and sets *wi and *pi, or 0. */
+static int find_signal_sender(const Project *p, const char *name, int *wi, int *pi) {
+    for (int i = 0; i < p->window_count; i++) {
+        const Window *win = &p->windows[i];
+        for (int j = 0; j < win->pane_count; j++) {
+            for (int k = 0; k < win->panes[j].signal_count; k++) {
+                if (strcmp(win->panes[j].signals[k], name) != 0) continue;
+                *wi = i;
+                *pi = j;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Every signal condition needs a pane that sends it, and a gate must not
+ * hold back the pane it waits for (pi is -1 for window-level gates). */
+static int check_signal_waits(const Project *p, const WaitFor *waits, int count, int wi, int pi,
+                              const char *key) {
+    const char *name = p->windows[wi].name ? p->windows[wi].name : "";
+    for (int k = 0; k < count; k++) {
+        int swi = -1, spi = -1;
+        if (waits[k].kind != WAIT_SIGNAL) continue;
+        if (!find_signal_sender(p, waits[k].target, &swi, &spi)) {
+            fprintf(stderr, "mux: %s in window '%s': signal %s is never sent by any pane\n", key,
+                    name, waits[k].target);
+            return -1;
+        }
+        if (strcmp(key, "wait_for") == 0 && swi == wi && (pi < 0 || spi == pi)) {
+            fprintf(stderr, "mux: %s in window '%s': cannot wait for its own signal %s\n", key,
+                    name, waits[k].target);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Signals are declared once each, and never in a lazy window, whose commands
+ * would not run until someone selects it. */
+static int check_signals(const Project *p) {
+    for (int i = 0; i < p->window_count; i++) {
+        const Window *win = &p->windows[i];
+        for (int j = 0; j < win->pane_count; j++) {
+            const Pane *pn = &win->panes[j];
+            for (int k = 0; k < pn->signal_count; k++) {
+                int swi = -1, spi = -1;
+                find_signal_sender(p, pn->signals[k], &swi, &spi);
+                if (win->lazy) {
+                    fprintf(stderr, "mux: lazy window '%s' cannot send signals\n", win->name);
+                    return -1;
+                }
+                if (swi != i || spi != j) {
+                    fprintf(stderr, "mux: signal %s is sent by more than one pane\n",
+                            pn->signals[k]);
+                    return -1;
+                }
+            }
+            if (check_signal_waits(p, pn->waits, pn->wait_count, i, j, "wait_for") != 0 ||
+                check_signal_waits(p, pn->ready, pn->ready_count, i, j, "ready") != 0) {
+                return -1;
+            }
+        }
+        if (check_signal_waits(p, win->waits, win->wait_count, i, -1, "wait_for") != 0 ||
+            check_signal_waits(p, win->ready, win->ready_count, i, -1, "ready") != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static int parse_document(Arena *a, yaml_document_t *doc, Project *p) {
     yaml_node_t *root = yaml_document_get_root_node(doc);
     if (!root || root->type != YAML_MAPPING_NODE) {
@@ -235,6 +826,7 @@ static int parse_document(Arena *a, yaml_document_t *doc, Project *p) {
         const char *raw_key = (const char *)key->data.scalar.value;
         const char *k = config_canonical_key(raw_key);
         if (!k) continue; /* ignored/deprecated */
+        int hook = hook_kind_for_key(k);
 
         if (strcmp(k, "name") == 0 && val->type == YAML_SCALAR_NODE) {
             p->name = arena_strdup(a, (const char *)val->data.scalar.value);
@@ -257,6 +849,9 @@ static int parse_document(Arena *a, yaml_document_t *doc, Project *p) {
         } else if (strcmp(k, "attach") == 0 && val->type == YAML_SCALAR_NODE) {
             const char *sv = (const char *)val->data.scalar.value;
             p->attach = !(strcmp(sv, "false") == 0 || strcmp(sv, "0") == 0);
+        } else if (strcmp(k, "progressive") == 0 && val->type == YAML_SCALAR_NODE) {
+            const char *sv = (const char *)val->data.scalar.value;
+            p->progressive = (strcmp(sv, "true") == 0 || strcmp(sv, "1") == 0);
         } else if (strcmp(k, "enable_pane_titles") == 0 && val->type == YAML_SCALAR_NODE) {
             const char *sv = (const char *)val->data.scalar.value;
             p->enable_pane_titles = (strcmp(sv, "true") == 0 || strcmp(sv, "1") == 0);
@@ -264,16 +859,14 @@ static int parse_document(Arena *a, yaml_document_t *doc, Project *p) {
             p->pane_title_format = arena_strdup(a, (const char *)val->data.scalar.value);
         } else if (strcmp(k, "pane_title_position") == 0 && val->type == YAML_SCALAR_NODE) {
             p->pane_title_position = arena_strdup(a, (const char *)val->data.scalar.value);
-        } else if (strcmp(k, "on_project_start") == 0) {
-            p->on_project_start = join_yaml_sequence(a, doc, val);
-        } else if (strcmp(k, "on_project_first_start") == 0) {
-            p->on_project_first_start = join_yaml_sequence(a, doc, val);
-        } else if (strcmp(k, "on_project_restart") == 0) {
-            p->on_project_restart = join_yaml_sequence(a, doc, val);
-        } else if (strcmp(k, "on_project_exit") == 0) {
-            p->on_project_exit = join_yaml_sequence(a, doc, val);
-        } else if (strcmp(k, "on_project_stop") == 0) {
-            p->on_project_stop = join_yaml_sequence(a, doc, val);
+        } else if (strcmp(k, "max_parallel") == 0 && val->type == YAML_SCALAR_NODE) {
+            if (parse_count(k, (const char *)val->data.scalar.value, &p->max_parallel) != 0) {
+                return -1;
+            }
+        } else if (strcmp(k, "prewarm") == 0 && val->type == YAML_SCALAR_NODE) {
+            if (parse_count(k, (const char *)val->data.scalar.value, &p->prewarm) != 0) return -1;
+        } else if (hook >= 0) {
+            if (parse_hook(a, doc, val, p, (HookKind)hook) != 0) return -1;
         } else if (strcmp(k, "windows") == 0 && val->type == YAML_SEQUENCE_NODE) {
             int n = (int)(val->data.sequence.items.top - val->data.sequence.items.start);
             if (n > 0) {
@@ -283,15 +876,16 @@ static int parse_document(Arena *a, yaml_document_t *doc, Project *p) {
                      item < val->data.sequence.items.top; item++) {
                     yaml_node_t *wnode = yaml_document_get_node(doc, *item);
                     if (!wnode) continue;
-                    if (parse_window(a, doc, wnode, &p->windows[p->window_count]) == 0) {
-                        p->window_count++;
-                    }
+                    int rc = parse_window(a, doc, wnode, &p->windows[p->window_count]);
+                    if (rc < 0) return -1;
+                    if (rc == 0) p->window_count++;
                 }
             }
         }
     }
 
-    return 0;
+    if (resolve_wait_sources(p) != 0 || check_signals(p) != 0) return -1;
+    return schedule_resolve(a, p);
 }
 
 int config_parse_string(Arena *a, const char *yaml, size_t yaml_len, Project *p,
@@ -301,7 +895,9 @@ int config_parse_string(Arena *a, const char *yaml, size_t yaml_len, Project *p,
     /* Template substitution pass */
     char *processed = NULL;
     if (settings && setting_count > 0) {
+        trace_begin("template");
         processed = template_substitute(a, yaml, settings, setting_count);
+        trace_end();
     } else {
         processed = arena_strndup(a, yaml, yaml_len);
     }
@@ -317,14 +913,19 @@ int config_parse_string(Arena *a, const char *yaml, size_t yaml_len, Project *p,
 
     yaml_parser_set_input_string(&parser, (const unsigned char *)processed, processed_len);
 
-    if (!yaml_parser_load(&parser, &doc)) {
+    trace_begin("parse yaml");
+    int loaded = yaml_parser_load(&parser, &doc);
+    trace_end();
+    if (!loaded) {
         fprintf(stderr, "mux: YAML parse error at line %lu: %s\n",
                 (unsigned long)parser.problem_mark.line + 1, parser.problem);
         yaml_parser_delete(&parser);
         return -1;
     }
 
+    trace_begin("build project");
     int result = parse_document(a, &doc, p);
+    trace_end();
 
     yaml_document_delete(&doc);
     yaml_parser_delete(&parser);
@@ -334,10 +935,12 @@ int config_parse_string(Arena *a, const char *yaml, size_t yaml_len, Project *p,
 
 int config_parse(Arena *a, const char *filepath, Project *p, const char **settings,
                  int setting_count) {
+    trace_begin("read config");
     FILE *f = fopen(filepath, "r");
     if (!f) {
         fprintf(stderr, "mux: cannot open %s: ", filepath);
         perror(NULL);
+        trace_end();
         return -1;
     }
 
@@ -348,6 +951,7 @@ int config_parse(Arena *a, const char *filepath, Project *p, const char **settin
     if (fsize < 0) {
         fprintf(stderr, "mux: cannot read %s\n", filepath);
         fclose(f);
+        trace_end();
         return -1;
     }
 
@@ -355,6 +959,7 @@ int config_parse(Arena *a, const char *filepath, Project *p, const char **settin
     size_t nread = fread(content, 1, (size_t)fsize, f);
     fclose(f);
     content[nread] = '\0';
+    trace_end();
 
     return config_parse_string(a, content, nread, p, settings, setting_count);
 }
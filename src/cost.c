@@ -0,0 +1,285 @@
+#include "cost.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plan.h"
+#include "script.h"
+
+static const char *backend_names[COST_BACKEND_COUNT] = {"start", "herdr"};
+static const char *program_names[COST_PROGRAM_COUNT] = {"tmux", "herdr", "python3", "other"};
+
+/* Commands typed into a pane: one send-keys each, or with a paste through a
+ * buffer one load, one paste and one send-keys for the Enter. */
+static void count_sends(Cost *c, const PlanOp *op) {
+    for (int k = 0; k < op->line_count; k++) {
+        c->spawns[COST_TMUX] += plan_line_is_pasted(op->lines[k]) ? 3 : 1;
+        c->sends++;
+    }
+}
+
+static int project_has_exec_panes(const Project *p) {
+    for (int wi = 0; wi < p->window_count; wi++) {
+        for (int pi = 0; pi < p->windows[wi].pane_count; pi++) {
+            if (p->windows[wi].panes[pi].exec) return 1;
+        }
+    }
+    return 0;
+}
+
+/* What the start script spends on one operation: a tmux call for each. */
+static void count_tmux_op(Cost *c, const Project *p, const PlanOp *op) {
+    switch (op->kind) {
+    case PLAN_HOOK:
+        c->spawns[COST_OTHER]++;
+        return;
+    case PLAN_CREATE_SESSION:
+        /* Then the base indices again, and the session's options */
+        c->spawns[COST_TMUX] += 3 + project_has_exec_panes(p);
+        c->spawns[COST_TMUX] += p->enable_pane_titles * (1 + !!p->pane_title_format);
+        return;
+    case PLAN_SPLIT:
+        c->relayouts++;
+        break;
+    case PLAN_LAYOUT:
+        c->relayouts++;
+        break;
+    case PLAN_SET_TITLE:
+        if (!p->enable_pane_titles) return;
+        break;
+    case PLAN_SEND:
+        count_sends(c, op);
+        return;
+    default:
+        break;
+    }
+    c->spawns[COST_TMUX]++;
+}
+
+/* The Herdr CLI answers in JSON, and each value the script keeps is read
+ * out of it by python3. */
+static void count_herdr_op(Cost *c, const PlanOp *op) {
+    switch (op->kind) {
+    case PLAN_HOOK:
+        c->spawns[COST_OTHER]++;
+        return;
+    case PLAN_CREATE_SESSION:
+        c->spawns[COST_HERDR_CLI] += 2;
+        c->spawns[COST_PYTHON] += 3;
+        break;
+    case PLAN_CREATE_WINDOW:
+        c->spawns[COST_HERDR_CLI]++;
+        c->spawns[COST_PYTHON] += 2;
+        break;
+    case PLAN_SPLIT:
+        c->spawns[COST_HERDR_CLI]++;
+        c->spawns[COST_PYTHON]++;
+        c->relayouts++;
+        break;
+    case PLAN_SET_TITLE:
+        c->spawns[COST_HERDR_CLI]++;
+        return;
+    case PLAN_SEND:
+        c->spawns[COST_HERDR_CLI] += 2 * op->line_count;
+        c->sends += op->line_count;
+        return;
+    case PLAN_FOCUS:
+        c->spawns[COST_HERDR_CLI] += op->pane < 0 ? 2 : 1;
+        return;
+    case PLAN_ATTACH:
+        c->spawns[COST_HERDR_CLI]++;
+        return;
+    default:
+        return;
+    }
+    /* An exec pane's shell is handed its command as typed text */
+    if (op->text) {
+        c->spawns[COST_HERDR_CLI] += 2;
+        c->sends++;
+    }
+}
+
+static size_t script_bytes(char *script) {
+    size_t n = script ? strlen(script) : 0;
+    free(script);
+    return n;
+}
+
+void cost_estimate(Arena *a, const Project *p, CostReport *r) {
+    memset(r, 0, sizeof(*r));
+    r->windows = p->window_count;
+    for (int wi = 0; wi < p->window_count; wi++) r->panes += p->windows[wi].pane_count;
+
+    /* mux start types each line on its own, so the plan is counted as
+     * built, before its passes */
+    Plan *plan = plan_build(a, p);
+    r->unsupported = plan->unsupported;
+
+    for (int b = 0; b < COST_BACKEND_COUNT; b++) {
+        Cost *c = &r->backends[b];
+        c->shells = r->panes;
+        c->pre_window = p->pre_window && p->pre_window[0] ? r->panes : 0;
+
+        if (b == COST_HERDR) {
+            /* Server status, the workspace lookup and its focus at the end */
+            c->spawns[COST_HERDR_CLI] += 3;
+            c->spawns[COST_PYTHON]++;
+        } else {
+            /* start-server, the base indices and has-session */
+            c->spawns[COST_TMUX] += 4;
+        }
+        for (int i = 0; i < plan->count; i++) {
+            if (b == COST_HERDR) {
+                count_herdr_op(c, &plan->ops[i]);
+            } else {
+                count_tmux_op(c, p, &plan->ops[i]);
+            }
+        }
+        c->round_trips = c->spawns[b == COST_HERDR ? COST_HERDR_CLI : COST_TMUX];
+    }
+
+    r->backends[COST_START].bytes = script_bytes(script_generate_start(p));
+    r->backends[COST_HERDR].bytes = script_bytes(script_generate_start_herdr(p));
+}
+
+int cost_spawns(const Cost *c) {
+    int n = 0;
+    for (int k = 0; k < COST_PROGRAM_COUNT; k++) n += c->spawns[k];
+    return n;
+}
+
+double cost_ms(const Cost *c, const CostCalibration *cal) {
+    double ms = 0;
+    for (int k = 0; k < COST_PROGRAM_COUNT; k++) ms += c->spawns[k] * cal->ms[k];
+    return ms;
+}
+
+int cost_parse_calibration(const char *spec, CostCalibration *cal) {
+    memset(cal, 0, sizeof(*cal));
+    const char *s = spec;
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        const char *eq = memchr(s, '=', len);
+        int k = 0;
+        while (eq && k < COST_PROGRAM_COUNT &&
+               !(strlen(program_names[k]) == (size_t)(eq - s) &&
+                 strncmp(s, program_names[k], (size_t)(eq - s)) == 0)) {
+            k++;
+        }
+        char *end = NULL;
+        errno = 0;
+        double ms = eq ? strtod(eq + 1, &end) : 0;
+        if (!eq || k == COST_PROGRAM_COUNT || end == eq + 1 || end != s + len || errno != 0 ||
+            ms < 0) {
+            fprintf(stderr,
+                    "mux: --calibrate takes PROGRAM=MS pairs for tmux, herdr, python3 or "
+                    "other, not '%.*s'\n",
+                    (int)len, s);
+            return -1;
+        }
+        cal->ms[k] = ms;
+        s += len;
+        if (*s == ',') s++;
+    }
+    cal->set = true;
+    return 0;
+}
+
+typedef struct {
+    const char *label;
+    int (*value)(const Cost *c, int arg);
+    int arg;
+} CostRow;
+
+static int row_spawns(const Cost *c, int arg) {
+    return arg < 0 ? cost_spawns(c) : c->spawns[arg];
+}
+
+static int row_field(const Cost *c, int arg) {
+    switch (arg) {
+    case 0:
+        return c->round_trips;
+    case 1:
+        return c->sends;
+    case 2:
+        return c->relayouts;
+    case 3:
+        return c->shells;
+    case 4:
+        return c->pre_window;
+    default:
+        return (int)c->bytes;
+    }
+}
+
+static const CostRow rows[] = {
+    {"spawns", row_spawns, -1},
+    {"  tmux", row_spawns, COST_TMUX},
+    {"  herdr", row_spawns, COST_HERDR_CLI},
+    {"  python3", row_spawns, COST_PYTHON},
+    {"  other", row_spawns, COST_OTHER},
+    {"round trips", row_field, 0},
+    {"send calls", row_field, 1},
+    {"relayouts", row_field, 2},
+    {"shells", row_field, 3},
+    {"pre_window runs", row_field, 4},
+    {"script bytes", row_field, 5},
+};
+
+void cost_format_table(const CostReport *r, const Project *p, const CostCalibration *cal,
+                       Str *out) {
+    str_appendf(out, "Start cost of %s: %d window%s, %d pane%s\n", p->name, r->windows,
+                r->windows == 1 ? "" : "s", r->panes, r->panes == 1 ? "" : "s");
+    if (r->unsupported) {
+        str_appendf(out, "The plan leaves out %s; counts are a floor.\n", r->unsupported);
+    }
+    str_appendf(out, "\n%-16s", "");
+    for (int b = 0; b < COST_BACKEND_COUNT; b++) str_appendf(out, "%10s", backend_names[b]);
+    str_append_char(out, '\n');
+
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        str_appendf(out, "%-16s", rows[i].label);
+        for (int b = 0; b < COST_BACKEND_COUNT; b++) {
+            str_appendf(out, "%10d", rows[i].value(&r->backends[b], rows[i].arg));
+        }
+        str_append_char(out, '\n');
+    }
+    if (cal && cal->set) {
+        str_appendf(out, "%-16s", "estimated ms");
+        for (int b = 0; b < COST_BACKEND_COUNT; b++) {
+            str_appendf(out, "%10.1f", cost_ms(&r->backends[b], cal));
+        }
+        str_append_char(out, '\n');
+    }
+}
+
+void cost_format_json(const CostReport *r, const Project *p, const CostCalibration *cal,
+                      Str *out) {
+    str_append(out, "{\"project\": ");
+    str_append_json(out, p->name);
+    str_appendf(out, ", \"windows\": %d, \"panes\": %d, \"unsupported\": ", r->windows,
+                r->panes);
+    if (r->unsupported) {
+        str_append_json(out, r->unsupported);
+    } else {
+        str_append(out, "null");
+    }
+    str_append(out, ", \"backends\": {");
+    for (int b = 0; b < COST_BACKEND_COUNT; b++) {
+        const Cost *c = &r->backends[b];
+        str_appendf(out, "%s\"%s\": ", b ? ", " : "", backend_names[b]);
+        str_appendf(out, "{\"spawns\": %d, \"spawns_by_program\": {", cost_spawns(c));
+        for (int k = 0; k < COST_PROGRAM_COUNT; k++) {
+            str_appendf(out, "%s\"%s\": %d", k ? ", " : "", program_names[k], c->spawns[k]);
+        }
+        str_appendf(out,
+                    "}, \"round_trips\": %d, \"sends\": %d, \"relayouts\": %d, \"shells\": %d, "
+                    "\"pre_window\": %d, \"script_bytes\": %zu",
+                    c->round_trips, c->sends, c->relayouts, c->shells, c->pre_window, c->bytes);
+        if (cal && cal->set) str_appendf(out, ", \"estimated_ms\": %.3f", cost_ms(c, cal));
+        str_append_char(out, '}');
+    }
+    str_append(out, "}}\n");
+}
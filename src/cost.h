@@ -0,0 +1,71 @@
+#ifndef MUX_COST_H
+#define MUX_COST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+#include "project.h"
+#include "str.h"
+
+/* A static model of what starting a project costs, counted from its launch
+ * plan without running anything. */
+
+typedef enum {
+    COST_START, /* mux start: the tmux start script */
+    COST_HERDR, /* mux start --backend herdr */
+    COST_BACKEND_COUNT,
+} CostBackend;
+
+typedef enum {
+    COST_TMUX,
+    COST_HERDR_CLI,
+    COST_PYTHON, /* python3, which reads Herdr's JSON */
+    COST_OTHER,  /* hooks and helpers such as grep */
+    COST_PROGRAM_COUNT,
+} CostProgram;
+
+typedef struct {
+    int spawns[COST_PROGRAM_COUNT]; /* processes the script starts, by program */
+    int round_trips;                /* clients that connect to the server and wait on it */
+    int sends;                      /* send-keys or send-text calls */
+    int relayouts;                  /* splits and layouts, each resizing the window's panes */
+    int shells;                     /* shells started in panes */
+    int pre_window;                 /* times pre_window is typed or run */
+    size_t bytes;                   /* size of the generated script */
+} Cost;
+
+typedef struct {
+    int windows;
+    int panes;
+    const char *unsupported; /* what the plan leaves out, so the counts are a floor */
+    Cost backends[COST_BACKEND_COUNT];
+} CostReport;
+
+/* Measured milliseconds one spawn of each program takes. */
+typedef struct {
+    bool set;
+    double ms[COST_PROGRAM_COUNT];
+} CostCalibration;
+
+/* Count the cost of starting p on every backend. */
+void cost_estimate(Arena *a, const Project *p, CostReport *r);
+
+/* All processes a backend's script starts. */
+int cost_spawns(const Cost *c);
+
+/* Estimated milliseconds the spawns take. */
+double cost_ms(const Cost *c, const CostCalibration *cal);
+
+/* Parse "tmux=MS,herdr=MS,python3=MS,other=MS"; programs left out cost
+ * nothing. Returns 0, or -1 after reporting a bad entry. */
+int cost_parse_calibration(const char *spec, CostCalibration *cal);
+
+/* Append the report as a table with a column per backend, or as JSON. cal
+ * may be NULL. */
+void cost_format_table(const CostReport *r, const Project *p, const CostCalibration *cal,
+                       Str *out);
+void cost_format_json(const CostReport *r, const Project *p, const CostCalibration *cal,
+                      Str *out);
+
+#endif
@@ -0,0 +1,136 @@
+#include "hook.h"
+
+#include <glob.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "path.h"
+#include "shell.h"
+#include "str.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t hash_file(uint64_t hash, const char *path) {
+    hash = fnv1a(hash, path, strlen(path) + 1);
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return fnv1a(hash, "not-a-file", 11);
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return fnv1a(hash, "unreadable", 11);
+
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        hash = fnv1a(hash, buf, n);
+    }
+    fclose(f);
+    return fnv1a(hash, "", 1);
+}
+
+static char *resolve_pattern(Arena *a, const char *root, const char *pattern) {
+    if (pattern[0] == '/' || pattern[0] == '~') return path_expand(a, pattern);
+    if (!root || !root[0]) return arena_strdup(a, pattern);
+
+    Str buf = str_new();
+    str_appendf(&buf, "%s/%s", path_expand(a, root), pattern);
+    char *result = arena_strdup(a, str_cstr(&buf));
+    str_free(&buf);
+    return result;
+}
+
+char *hook_digest(Arena *a, const char *root, char **inputs, int input_count) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (int i = 0; i < input_count; i++) {
+        hash = fnv1a(hash, inputs[i], strlen(inputs[i]) + 1);
+
+        glob_t g;
+        int ret = glob(resolve_pattern(a, root, inputs[i]), 0, NULL, &g);
+        if (ret == 0) {
+            for (size_t j = 0; j < g.gl_pathc; j++) {
+                hash = hash_file(hash, g.gl_pathv[j]);
+            }
+        } else {
+            hash = fnv1a(hash, "missing", 8);
+        }
+        globfree(&g);
+    }
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return arena_strdup(a, hex);
+}
+
+/* Build <state_dir>/<subdir>/<project>.<hook><suffix>, keeping file names tame
+ * since project names may contain anything tmux accepts. */
+static char *hook_state_file(Arena *a, const char *state_dir, const char *subdir,
+                             const char *project, HookKind kind, const char *suffix) {
+    Str buf = str_new();
+    str_appendf(&buf, ".%s%s", project_hook_name(kind), suffix);
+    char *result = path_state_file(a, state_dir, subdir, project, str_cstr(&buf));
+    str_free(&buf);
+    return result;
+}
+
+char *hook_stamp_path(Arena *a, const char *state_dir, const char *project, HookKind kind) {
+    return hook_state_file(a, state_dir, "stamps", project, kind, "");
+}
+
+char *hook_log_path(Arena *a, const char *state_dir, const char *project, HookKind kind) {
+    return hook_state_file(a, state_dir, "logs", project, kind, ".log");
+}
+
+static int stamp_matches(const char *stamp_path, const char *digest) {
+    FILE *f = fopen(stamp_path, "r");
+    if (!f) return 0;
+
+    char line[64] = {0};
+    int matches = 0;
+    if (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        matches = strcmp(line, digest) == 0;
+    }
+    fclose(f);
+    return matches;
+}
+
+void hook_resolve(Arena *a, Project *p, const char *state_dir) {
+    for (int k = 0; k < HOOK_COUNT; k++) {
+        HookOptions *h = &p->hooks[k];
+        if (state_dir && h->mode != HOOK_MODE_INLINE) {
+            h->log_path = hook_log_path(a, state_dir, p->name, (HookKind)k);
+        }
+        if (h->input_count == 0) continue;
+
+        h->digest = hook_digest(a, p->root, h->inputs, h->input_count);
+        if (!state_dir) continue;
+        h->stamp_path = hook_stamp_path(a, state_dir, p->name, (HookKind)k);
+        h->up_to_date = stamp_matches(h->stamp_path, h->digest);
+    }
+}
+
+int hook_digest_command(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "mux: usage: mux hook-digest ROOT INPUT...\n");
+        return 2;
+    }
+    Arena a = arena_new();
+    printf("%s\n", hook_digest(&a, argv[0], &argv[1], argc - 1));
+    arena_free(&a);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef MUX_HOOK_H
+#define MUX_HOOK_H
+
+#include "arena.h"
+#include "project.h"
+
+/* Hash the contents of every file matched by the input globs. Relative
+ * patterns are resolved against root (or the current directory when root is
+ * NULL). Inputs that match nothing still contribute to the hash, so creating
+ * them later changes the digest. Returns an arena-allocated hex digest. */
+char *hook_digest(Arena *a, const char *root, char **inputs, int input_count);
+
+/* Return the stamp file for a project hook: <state_dir>/stamps/<project>.<hook> */
+char *hook_stamp_path(Arena *a, const char *state_dir, const char *project, HookKind kind);
+
+/* Return the log file for a supervised hook: <state_dir>/logs/<project>.<hook>.log */
+char *hook_log_path(Arena *a, const char *state_dir, const char *project, HookKind kind);
+
+/* Resolve memoised hooks: hash each hook's inputs and compare the digest with
+ * the stamp recorded in state_dir by its last successful run, and assign log
+ * files to supervised hooks. Inline hooks without inputs are left untouched. */
+void hook_resolve(Arena *a, Project *p, const char *state_dir);
+
+/* Entry point for `mux hook-digest ROOT INPUT...`: print the digest of the
+ * inputs as they are now, so that a generated script stamps a hook with what
+ * it left behind rather than what it started from. An empty ROOT resolves
+ * relative inputs against the current directory. Returns 0, or 2 on usage. */
+int hook_digest_command(int argc, char **argv);
+
+#endif
@@ -0,0 +1,253 @@
+#include "layout.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* tmux's default main-pane-width and main-pane-height */
+#define LAYOUT_MAIN_WIDTH 80
+#define LAYOUT_MAIN_HEIGHT 24
+
+static LayoutCell *new_cells(Arena *a, int n) {
+    LayoutCell *cells = arena_alloc(a, sizeof(LayoutCell) * (size_t)n);
+    memset(cells, 0, sizeof(LayoutCell) * (size_t)n);
+    for (int i = 0; i < n; i++) cells[i].weight = 1;
+    return cells;
+}
+
+/* Turn cell into a split of n equally weighted panes. */
+static void split_cell(Arena *a, LayoutCell *cell, LayoutKind kind, int n) {
+    cell->kind = kind;
+    cell->children = new_cells(a, n);
+    cell->child_count = n;
+}
+
+/* Place the children of a laid out cell, sharing its length along the split
+ * by weight after one cell of border between each. As in tmux, rounding
+ * leftovers go to the last child. Returns -1 when a cell gets no space. */
+static int arrange(LayoutCell *cell) {
+    if (cell->sx < 1 || cell->sy < 1) return -1;
+    if (cell->kind == LAYOUT_PANE) return 0;
+
+    int cols = cell->kind == LAYOUT_COLUMNS;
+    int n = cell->child_count;
+    long long avail = (cols ? cell->sx : cell->sy) - (n - 1);
+    long long total = 0, used = 0;
+    for (int i = 0; i < n; i++) total += cell->children[i].weight;
+    if (avail < n || total <= 0) return -1;
+
+    int offset = cols ? cell->x : cell->y;
+    for (int i = 0; i < n; i++) {
+        LayoutCell *c = &cell->children[i];
+        int size = (int)(i == n - 1 ? avail - used : avail * c->weight / total);
+        used += size;
+        c->x = cols ? offset : cell->x;
+        c->y = cols ? cell->y : offset;
+        c->sx = cols ? size : cell->sx;
+        c->sy = cols ? cell->sy : size;
+        offset += size + 1;
+        if (arrange(c) != 0) return -1;
+    }
+    return 0;
+}
+
+static void number_panes(LayoutCell *cell, int *next) {
+    if (cell->kind == LAYOUT_PANE) cell->pane = (*next)++;
+    for (int i = 0; i < cell->child_count; i++) number_panes(&cell->children[i], next);
+}
+
+/* A main pane of the given size beside (or above) the others, which share
+ * the rest evenly. The main pane shrinks to leave the others one cell. */
+static void main_layout(Arena *a, LayoutCell *root, LayoutKind kind, int main, int panes) {
+    int len = kind == LAYOUT_COLUMNS ? root->sx : root->sy;
+    if (main > len - 2) main = len - 2;
+    split_cell(a, root, kind, 2);
+    root->children[0].weight = main;
+    root->children[1].weight = len - 1 - main;
+    if (panes > 2) {
+        split_cell(a, &root->children[1],
+                   kind == LAYOUT_COLUMNS ? LAYOUT_ROWS : LAYOUT_COLUMNS, panes - 1);
+    }
+}
+
+/* tmux's tiled layout: a grid with at least as many rows as columns. A row
+ * holding a single pane is that pane, and in a short last row the last pane
+ * takes the rest of the width. */
+static void tiled_layout(Arena *a, LayoutCell *root, int panes) {
+    int rows = 1, columns = 1;
+    while (rows * columns < panes) {
+        rows++;
+        if (rows * columns < panes) columns++;
+    }
+    int used_rows = (panes + columns - 1) / columns;
+    int width = (root->sx - (columns - 1)) / columns;
+
+    split_cell(a, root, LAYOUT_ROWS, used_rows);
+    for (int j = 0; j < used_rows; j++) {
+        LayoutCell *row = &root->children[j];
+        int left = panes - j * columns;
+        if (left == 1 || columns == 1) continue;
+        int n = left < columns ? left : columns;
+        split_cell(a, row, LAYOUT_COLUMNS, n);
+        if (n == columns) continue;
+        for (int i = 0; i < n - 1; i++) row->children[i].weight = width;
+        row->children[n - 1].weight = root->sx - (n - 1) * (width + 1);
+    }
+}
+
+LayoutCell *layout_preset(Arena *a, const char *name, int panes, int sx, int sy) {
+    if (!name || panes < 1) return NULL;
+    LayoutCell *root = new_cells(a, 1);
+    root->sx = sx;
+    root->sy = sy;
+
+    if (strcmp(name, "even-horizontal") == 0) {
+        if (panes > 1) split_cell(a, root, LAYOUT_COLUMNS, panes);
+    } else if (strcmp(name, "even-vertical") == 0) {
+        if (panes > 1) split_cell(a, root, LAYOUT_ROWS, panes);
+    } else if (strcmp(name, "main-vertical") == 0) {
+        if (panes > 1) main_layout(a, root, LAYOUT_COLUMNS, LAYOUT_MAIN_WIDTH, panes);
+    } else if (strcmp(name, "main-horizontal") == 0) {
+        if (panes > 1) main_layout(a, root, LAYOUT_ROWS, LAYOUT_MAIN_HEIGHT, panes);
+    } else if (strcmp(name, "tiled") == 0) {
+        if (panes > 1) tiled_layout(a, root, panes);
+    } else {
+        return NULL;
+    }
+
+    int next = 0;
+    if (arrange(root) != 0) return NULL;
+    number_panes(root, &next);
+    return root;
+}
+
+static void copy_cell(Arena *a, LayoutCell *dst, const LayoutCell *src) {
+    *dst = *src;
+    if (src->child_count == 0) return;
+    dst->children = new_cells(a, src->child_count);
+    for (int i = 0; i < src->child_count; i++) {
+        copy_cell(a, &dst->children[i], &src->children[i]);
+    }
+}
+
+LayoutCell *layout_fit(Arena *a, const LayoutCell *spec, int sx, int sy) {
+    LayoutCell *root = new_cells(a, 1);
+    copy_cell(a, root, spec);
+    root->x = 0;
+    root->y = 0;
+    root->sx = sx;
+    root->sy = sy;
+
+    int next = 0;
+    if (arrange(root) != 0) return NULL;
+    number_panes(root, &next);
+    return root;
+}
+
+/* Read a decimal number at *p into *out, moving past it. */
+static int parse_number(const char **p, int *out) {
+    if (!isdigit((unsigned char)**p)) return -1;
+    char *end = NULL;
+    long n = strtol(*p, &end, 10);
+    if (n > 100000) return -1;
+    *out = (int)n;
+    *p = end;
+    return 0;
+}
+
+/* Parse "SXxSY,X,Y" and then ",ID" for a pane, or a {columns} or [rows]
+ * list of cells. As in tmux, a number after the offsets is a pane ID unless
+ * it is followed by 'x', which starts the next cell. */
+static int parse_cell(Arena *a, const char **p, LayoutCell *cell) {
+    memset(cell, 0, sizeof(*cell));
+    cell->weight = 1;
+    if (parse_number(p, &cell->sx) != 0 || *(*p)++ != 'x' || parse_number(p, &cell->sy) != 0 ||
+        *(*p)++ != ',' || parse_number(p, &cell->x) != 0 || *(*p)++ != ',' ||
+        parse_number(p, &cell->y) != 0) {
+        return -1;
+    }
+
+    if (**p == ',') {
+        const char *id = *p + 1;
+        int ignored;
+        if (parse_number(&id, &ignored) == 0 && *id != 'x') *p = id;
+    }
+    if (**p != '{' && **p != '[') return 0;
+
+    cell->kind = **p == '{' ? LAYOUT_COLUMNS : LAYOUT_ROWS;
+    char close = **p == '{' ? '}' : ']';
+    int cap = 4;
+    cell->children = arena_alloc(a, sizeof(LayoutCell) * (size_t)cap);
+    do {
+        (*p)++;
+        if (cell->child_count == cap) {
+            LayoutCell *grown = arena_alloc(a, sizeof(LayoutCell) * (size_t)cap * 2);
+            memcpy(grown, cell->children, sizeof(LayoutCell) * (size_t)cap);
+            cell->children = grown;
+            cap *= 2;
+        }
+        if (parse_cell(a, p, &cell->children[cell->child_count++]) != 0) return -1;
+    } while (**p == ',');
+    if (**p != close) return -1;
+    (*p)++;
+    return 0;
+}
+
+LayoutCell *layout_parse(Arena *a, const char *layout) {
+    if (!layout) return NULL;
+    const char *body = layout;
+    const char *comma = strchr(layout, ',');
+    const char *x = strchr(layout, 'x');
+    if (comma && (!x || comma < x)) {
+        /* A checksum comes first, as four hex digits */
+        char *end = NULL;
+        unsigned long csum = strtoul(layout, &end, 16);
+        if (end != comma || comma - layout != 4) return NULL;
+        body = comma + 1;
+        if (csum != layout_checksum(body)) return NULL;
+    }
+
+    LayoutCell *root = arena_alloc(a, sizeof(LayoutCell));
+    const char *p = body;
+    if (parse_cell(a, &p, root) != 0 || *p != '\0') return NULL;
+    int next = 0;
+    number_panes(root, &next);
+    return root;
+}
+
+int layout_pane_count(const LayoutCell *cell) {
+    if (cell->kind == LAYOUT_PANE) return 1;
+    int n = 0;
+    for (int i = 0; i < cell->child_count; i++) n += layout_pane_count(&cell->children[i]);
+    return n;
+}
+
+unsigned layout_checksum(const char *body) {
+    unsigned csum = 0;
+    for (const unsigned char *c = (const unsigned char *)body; *c; c++) {
+        csum = (csum >> 1) + ((csum & 1) << 15);
+        csum = (csum + *c) & 0xffff;
+    }
+    return csum;
+}
+
+static void format_cell(const LayoutCell *cell, Str *out) {
+    str_appendf(out, "%dx%d,%d,%d", cell->sx, cell->sy, cell->x, cell->y);
+    if (cell->kind == LAYOUT_PANE) {
+        str_appendf(out, ",%d", cell->pane);
+        return;
+    }
+    str_append_char(out, cell->kind == LAYOUT_COLUMNS ? '{' : '[');
+    for (int i = 0; i < cell->child_count; i++) {
+        if (i > 0) str_append_char(out, ',');
+        format_cell(&cell->children[i], out);
+    }
+    str_append_char(out, cell->kind == LAYOUT_COLUMNS ? '}' : ']');
+}
+
+void layout_format(const LayoutCell *root, Str *out) {
+    Str body = str_new();
+    format_cell(root, &body);
+    str_appendf(out, "%04x,%s", layout_checksum(str_cstr(&body)), str_cstr(&body));
+    str_free(&body);
+}
@@ -0,0 +1,57 @@
+#ifndef MUX_LAYOUT_H
+#define MUX_LAYOUT_H
+
+#include "arena.h"
+#include "str.h"
+
+/* Window layouts as trees of cells, written out as tmux layout strings so
+ * that a window takes its final shape in one select-layout. */
+
+/* Size a window is assumed to have when none is known: new-session's default. */
+#define LAYOUT_DEFAULT_WIDTH 120
+#define LAYOUT_DEFAULT_HEIGHT 40
+
+typedef enum {
+    LAYOUT_PANE,    /* a leaf holding one pane */
+    LAYOUT_COLUMNS, /* children side by side */
+    LAYOUT_ROWS,    /* children stacked top to bottom */
+} LayoutKind;
+
+typedef struct LayoutCell {
+    LayoutKind kind;
+    int weight; /* share of the parent's size, relative to the other children */
+    int sx, sy; /* geometry, once laid out */
+    int x, y;
+    int pane; /* pane index for leaves, in tree order */
+    struct LayoutCell *children;
+    int child_count;
+} LayoutCell;
+
+/* Lay out one of tmux's preset layouts (even-horizontal, even-vertical,
+ * main-horizontal, main-vertical, tiled) for panes in an sx by sy window,
+ * as tmux does with its default main pane sizes; tmux windows get the main-*
+ * layouts by name, to follow their own main pane options. Returns NULL for
+ * any other name, which tmux is left to interpret. */
+LayoutCell *layout_preset(Arena *a, const char *name, int panes, int sx, int sy);
+
+/* Lay out a split spec in an sx by sy window, sharing each cell among its
+ * children by weight, and number its panes in tree order. Returns NULL when
+ * a pane would get no space. */
+LayoutCell *layout_fit(Arena *a, const LayoutCell *spec, int sx, int sy);
+
+/* Parse a tmux layout string such as #{window_layout}, with or without its
+ * checksum, into a laid out tree with its panes numbered in tree order, as
+ * tmux assigns them. Returns NULL when the string is malformed or the
+ * checksum does not match. */
+LayoutCell *layout_parse(Arena *a, const char *layout);
+
+/* Number of panes in a layout. */
+int layout_pane_count(const LayoutCell *cell);
+
+/* The 16-bit checksum tmux expects ahead of a layout string. */
+unsigned layout_checksum(const char *body);
+
+/* Append the tmux layout string for a laid out tree, checksum included. */
+void layout_format(const LayoutCell *root, Str *out);
+
+#endif
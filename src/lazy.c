@@ -0,0 +1,82 @@
+#include "lazy.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "shell.h"
+#include "str.h"
+
+int lazy_run(const char *path) {
+    /* Renaming claims the script, so switching to the window twice in
+     * quick succession cannot send its commands twice */
+    Str claimed = str_new();
+    str_appendf(&claimed, "%s.started", path);
+    if (rename(path, str_cstr(&claimed)) != 0) {
+        str_free(&claimed);
+        return 0;
+    }
+
+    int rc = -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        /* tmux would show any output from a run-shell hook in the pane */
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+        }
+        execlp("bash", "bash", str_cstr(&claimed), (char *)NULL);
+        _exit(127);
+    }
+    int status = 0;
+    if (pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+        WEXITSTATUS(status) == 0) {
+        rc = 0;
+    }
+    unlink(str_cstr(&claimed));
+
+    /* The last lazy window to start takes the start's directory with it */
+    char *slash = strrchr(claimed.data, '/');
+    if (slash && slash != claimed.data) {
+        *slash = '\0';
+        rmdir(claimed.data);
+    }
+    str_free(&claimed);
+    return rc;
+}
+
+int lazy_command(int argc, char **argv) {
+    if (argc != 1) {
+        fputs("usage: mux lazy-start WINDOW_ID\n", stderr);
+        return 2;
+    }
+
+    /* Runs inside tmux, where $TMUX points plain tmux at the right server */
+    Arena arena = arena_new();
+    const char *window = shell_escape(&arena, argv[0]);
+    Str cmd = str_new();
+    str_appendf(&cmd, "tmux show-options -wqv -t %s @mux_lazy 2>/dev/null", window);
+    FILE *pipe = popen(str_cstr(&cmd), "r");
+    char path[4096] = "";
+    if (pipe) {
+        if (!fgets(path, sizeof(path), pipe)) path[0] = '\0';
+        pclose(pipe);
+    }
+    path[strcspn(path, "\n")] = '\0';
+
+    int rc = 0;
+    if (path[0]) {
+        str_clear(&cmd);
+        str_appendf(&cmd, "tmux set-option -wqu -t %s @mux_lazy", window);
+        shell_exec(str_cstr(&cmd));
+        rc = lazy_run(path) == 0 ? 0 : 1;
+    }
+    str_free(&cmd);
+    arena_free(&arena);
+    return rc;
+}
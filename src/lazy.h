@@ -0,0 +1,18 @@
+#ifndef MUX_LAZY_H
+#define MUX_LAZY_H
+
+/* Lazy windows are created at start, but the commands for their panes are
+ * written to a script that runs when the window is first selected. The
+ * script's path is kept in the window's @mux_lazy tmux option. */
+
+/* Run a lazy window's script unless another caller already has, then
+ * remove the script, and its directory once no other script is left there.
+ * Returns 0 when the script ran or had already been claimed, -1 when it
+ * failed. */
+int lazy_run(const char *path);
+
+/* Entry point for `mux lazy-start WINDOW_ID`, run from the tmux
+ * session-window-changed hook. Returns a process exit status. */
+int lazy_command(int argc, char **argv);
+
+#endif
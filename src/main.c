@@ -1,3 +1,5 @@
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,16 +7,26 @@
 #include <unistd.h>
 
 #include "arena.h"
+#include "bench.h"
 #include "cli.h"
 #include "completion.h"
 #include "config.h"
+#include "cost.h"
 #include "doctor.h"
+#include "hook.h"
+#include "lazy.h"
 #include "path.h"
+#include "plan.h"
+#include "priority.h"
 #include "project.h"
 #include "script.h"
 #include "shell.h"
+#include "stats.h"
+#include "str.h"
 #include "template.h"
 #include "tmux.h"
+#include "trace.h"
+#include "wait.h"
 
 static const char *selected_backend(const CliArgs *args) {
     if (args->backend && args->backend[0]) return args->backend;
@@ -64,14 +76,41 @@ static void parse_settings(Arena *a, const CliArgs *args, const char ***settings
     *count = n;
 }
 
+/* Parse the project at filepath with the command line's settings, name and
+ * jobs, and resolve its hooks and saved layouts. */
+static int load_project_file(Arena *a, const CliArgs *args, const char *filepath, Project *p) {
+    const char **settings = NULL;
+    int setting_count = 0;
+    parse_settings(a, args, &settings, &setting_count);
+
+    if (config_parse(a, filepath, p, settings, setting_count) != 0) {
+        return -1;
+    }
+
+    /* Override session name if --name was given */
+    if (args->override_name) {
+        p->name = arena_strdup(a, args->override_name);
+    }
+    p->jobs = args->jobs;
+
+    trace_begin("resolve hooks and layouts");
+    char *state_dir = path_state_dir(a);
+    hook_resolve(a, p, state_dir);
+    if (state_dir) project_load_layouts(a, p, state_dir);
+    trace_end();
+    return 0;
+}
+
 static int load_project(Arena *a, const CliArgs *args, Project *p) {
     const char *filepath = NULL;
 
+    trace_begin("find project");
     if (args->project_config) {
         filepath = args->project_config;
     } else if (args->project_name) {
         filepath = path_find_project(a, args->project_name);
     }
+    trace_end();
 
     if (!filepath) {
         if (args->project_name) {
@@ -81,21 +120,41 @@ static int load_project(Arena *a, const CliArgs *args, Project *p) {
         }
         return -1;
     }
+    return load_project_file(a, args, filepath, p);
+}
 
-    const char **settings = NULL;
-    int setting_count = 0;
-    parse_settings(a, args, &settings, &setting_count);
-
-    if (config_parse(a, filepath, p, settings, setting_count) != 0) {
-        return -1;
-    }
+/* Run a start script. With --trace the script records each tmux and Herdr
+ * command it runs, and the trace is written once it returns. */
+static int run_start_script(Arena *a, const CliArgs *args, const Project *p, const char *script) {
+    if (!args->trace) return shell_exec_bash(script);
 
-    /* Override session name if --name was given */
-    if (args->override_name) {
-        p->name = arena_strdup(a, args->override_name);
+    char *events = arena_alloc(a, strlen(args->trace) + sizeof(".events"));
+    sprintf(events, "%s.events", args->trace);
+    FILE *f = fopen(events, "w");
+    if (!f) {
+        fprintf(stderr, "mux: cannot write %s: %s\n", events, strerror(errno));
+        return 1;
     }
-
-    return 0;
+    fclose(f);
+    setenv("MUX_TRACE_EVENTS", events, 1);
+
+    const char *herdr = getenv("MUX_HERDR_COMMAND");
+    const char *programs[] = {
+        p->tmux_command && p->tmux_command[0] ? p->tmux_command : "tmux",
+        herdr && herdr[0] ? herdr : "herdr",
+    };
+    Str traced = str_new();
+    trace_append_wrappers(&traced, programs, 2);
+    str_append(&traced, script);
+
+    trace_begin("run script");
+    int ret = shell_exec_bash(str_cstr(&traced));
+    trace_end();
+    str_free(&traced);
+
+    if (trace_write(args->trace, events) != 0 && ret == 0) ret = 1;
+    unlink(events);
+    return ret;
 }
 
 static int cmd_start(Arena *a, const CliArgs *args) {
@@ -105,13 +164,15 @@ static int cmd_start(Arena *a, const CliArgs *args) {
     int herdr = backend_is_herdr(args);
     if (herdr < 0) return 1;
 
+    trace_begin("generate script");
     char *script = herdr ? script_generate_start_herdr(&p) : script_generate_start(&p);
+    trace_end();
     if (!script) {
         fprintf(stderr, "mux: failed to generate start script\n");
         return 1;
     }
 
-    int ret = shell_exec_bash(script);
+    int ret = run_start_script(a, args, &p, script);
     free(script);
     return ret;
 }
@@ -134,14 +195,74 @@ static int cmd_stop(Arena *a, const CliArgs *args) {
     return ret;
 }
 
+static int cmd_prewarm(Arena *a, const CliArgs *args) {
+    Project p;
+    if (load_project(a, args, &p) != 0) return 1;
+
+    int herdr = backend_is_herdr(args);
+    if (herdr < 0) return 1;
+    if (herdr) {
+        fprintf(stderr, "mux: prewarm needs the tmux backend\n");
+        return 1;
+    }
+    if (p.prewarm <= 0) {
+        fprintf(stderr, "mux: project '%s' does not set prewarm\n", p.name);
+        return 1;
+    }
+
+    char *script = script_generate_prewarm(&p);
+    int ret = shell_exec_bash(script);
+    free(script);
+    return ret;
+}
+
+static int cmd_layout(Arena *a, const CliArgs *args) {
+    if (!args->layout_action || strcmp(args->layout_action, "save") != 0) {
+        fprintf(stderr, "mux: usage: mux layout save <project>\n");
+        return 1;
+    }
+
+    Project p;
+    if (load_project(a, args, &p) != 0) return 1;
+
+    int herdr = backend_is_herdr(args);
+    if (herdr < 0) return 1;
+    if (herdr) {
+        fprintf(stderr, "mux: layout save needs the tmux backend\n");
+        return 1;
+    }
+    if (!p.layout_cache) return 1;
+
+    char *script = script_generate_layout_save(&p);
+    int ret = shell_exec_bash(script);
+    free(script);
+    return ret;
+}
+
+/* Print the launch plan, after its passes. */
+static int debug_plan(Arena *a, const Project *p) {
+    Plan *plan = plan_build(a, p);
+    plan_coalesce(a, plan);
+    plan_dedupe(a, plan);
+    plan_schedule(plan);
+    Str out = str_new();
+    plan_dump(plan, p, &out);
+    printf("%s", str_cstr(&out));
+    str_free(&out);
+    return 0;
+}
+
 static int cmd_debug(Arena *a, const CliArgs *args) {
     Project p;
     if (load_project(a, args, &p) != 0) return 1;
+    if (args->plan) return debug_plan(a, &p);
 
     int herdr = backend_is_herdr(args);
     if (herdr < 0) return 1;
 
+    trace_begin("generate script");
     char *script = herdr ? script_generate_start_herdr(&p) : script_generate_start(&p);
+    trace_end();
     if (!script) {
         fprintf(stderr, "mux: failed to generate script\n");
         return 1;
@@ -152,6 +273,59 @@ static int cmd_debug(Arena *a, const CliArgs *args) {
     return 0;
 }
 
+/* Print the launch plan, or with --cost what starting from it costs on each
+ * backend. */
+static int cmd_plan(Arena *a, const CliArgs *args) {
+    Project p;
+    if (load_project(a, args, &p) != 0) return 1;
+    if (!args->cost) return debug_plan(a, &p);
+
+    CostCalibration cal = {0};
+    if (args->calibrate && cost_parse_calibration(args->calibrate, &cal) != 0) return 1;
+    CostReport report;
+    cost_estimate(a, &p, &report);
+    Str out = str_new();
+    if (args->json) {
+        cost_format_json(&report, &p, &cal, &out);
+    } else {
+        cost_format_table(&report, &p, &cal, &out);
+    }
+    printf("%s", str_cstr(&out));
+    str_free(&out);
+    return 0;
+}
+
+/* Time starts and stops of a project on a tmux server of its own */
+static int cmd_bench(Arena *a, const CliArgs *args) {
+    Project p;
+    if (load_project(a, args, &p) != 0) return 1;
+
+    int herdr = backend_is_herdr(args);
+    if (herdr < 0) return 1;
+    if (herdr) {
+        fprintf(stderr, "mux: bench runs on a private tmux server, not Herdr\n");
+        return 1;
+    }
+
+    char socket[64];
+    snprintf(socket, sizeof(socket), "mux-bench-%ld", (long)getpid());
+    bench_prepare(&p, arena_strdup(a, socket), args->stub);
+    BenchResult result = {.stubbed = args->stub};
+    if (bench_run(a, &p, args->runs > 0 ? args->runs : BENCH_DEFAULT_RUNS, &result) != 0) {
+        return 1;
+    }
+
+    Str out = str_new();
+    if (args->json) {
+        bench_format_json(&result, &p, &out);
+    } else {
+        bench_format_table(&result, &p, &out);
+    }
+    printf("%s", str_cstr(&out));
+    str_free(&out);
+    return 0;
+}
+
 static int cmd_new(Arena *a, const CliArgs *args) {
     const char *name = args->project_name;
     if (!name) {
@@ -331,26 +505,18 @@ static int cmd_local(Arena *a, const CliArgs *args) {
         return 1;
     }
 
-    const char **settings = NULL;
-    int setting_count = 0;
-    parse_settings(a, args, &settings, &setting_count);
-
     Project p;
-    if (config_parse(a, filepath, &p, settings, setting_count) != 0) {
-        return 1;
-    }
-
-    if (args->override_name) {
-        p.name = arena_strdup(a, args->override_name);
-    }
+    if (load_project_file(a, args, filepath, &p) != 0) return 1;
 
     int herdr = backend_is_herdr(args);
     if (herdr < 0) return 1;
 
+    trace_begin("generate script");
     char *script = herdr ? script_generate_start_herdr(&p) : script_generate_start(&p);
+    trace_end();
     if (!script) return 1;
 
-    int ret = shell_exec_bash(script);
+    int ret = run_start_script(a, args, &p, script);
     free(script);
     return ret;
 }
@@ -416,11 +582,29 @@ static int cmd_completions(const CliArgs *args) {
     return 0;
 }
 
+/* Let generated scripts call back into this binary for internal commands
+ * such as wait-for, even when mux is not on PATH. */
+static void export_self_path(const char *argv0) {
+    char path[PATH_MAX];
+#ifdef __linux__
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n > 0) {
+        path[n] = '\0';
+        setenv("MUX_BIN", path, 1);
+        return;
+    }
+#endif
+    if (strchr(argv0, '/') && realpath(argv0, path)) setenv("MUX_BIN", path, 1);
+}
+
 int main(int argc, char **argv) {
     CliArgs args;
     if (cli_parse(argc, argv, &args) != 0) {
         return 1;
     }
+    export_self_path(argv[0]);
+    stats_start_from_env();
+    if (args.trace) trace_start();
 
     Arena a = arena_new();
     int ret = 0;
@@ -438,6 +622,18 @@ int main(int argc, char **argv) {
     case CMD_STOP:
         ret = cmd_stop(&a, &args);
         break;
+    case CMD_PREWARM:
+        ret = cmd_prewarm(&a, &args);
+        break;
+    case CMD_LAYOUT:
+        ret = cmd_layout(&a, &args);
+        break;
+    case CMD_PLAN:
+        ret = cmd_plan(&a, &args);
+        break;
+    case CMD_BENCH:
+        ret = cmd_bench(&a, &args);
+        break;
     case CMD_DEBUG:
         ret = cmd_debug(&a, &args);
         break;
@@ -471,6 +667,18 @@ int main(int argc, char **argv) {
     case CMD_COMPLETIONS:
         ret = cmd_completions(&args);
         break;
+    case CMD_WAIT_FOR:
+        ret = wait_command(args.setting_count, (char **)args.settings);
+        break;
+    case CMD_PRIORITY:
+        ret = priority_command(args.setting_count, (char **)args.settings);
+        break;
+    case CMD_LAZY_START:
+        ret = lazy_command(args.setting_count, (char **)args.settings);
+        break;
+    case CMD_HOOK_DIGEST:
+        ret = hook_digest_command(args.setting_count, (char **)args.settings);
+        break;
     case CMD_NONE:
         cli_usage();
         ret = 1;
@@ -478,5 +686,6 @@ int main(int argc, char **argv) {
     }
 
     arena_free(&a);
+    stats_report();
     return ret;
 }
@@ -83,6 +83,43 @@ char *path_config_dir(Arena *a) {
     }
 }
 
+char *path_state_dir(Arena *a) {
+    Str buf = str_new();
+    const char *xdg = getenv("XDG_STATE_HOME");
+    if (xdg && xdg[0]) {
+        str_appendf(&buf, "%s/mux", xdg);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home) {
+            fprintf(stderr, "mux: $HOME not set\n");
+            str_free(&buf);
+            return NULL;
+        }
+        str_appendf(&buf, "%s/.local/state/mux", home);
+    }
+    char *result = arena_strdup(a, str_cstr(&buf));
+    str_free(&buf);
+    return result;
+}
+
+char *path_state_file(Arena *a, const char *state_dir, const char *subdir, const char *name,
+                      const char *suffix) {
+    Str buf = str_new();
+    str_appendf(&buf, "%s/%s/", state_dir, subdir);
+    for (const char *c = name ? name : "default"; *c; c++) {
+        if ((*c >= 'A' && *c <= 'Z') || (*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9') ||
+            *c == '-' || *c == '_' || *c == '.') {
+            str_append_char(&buf, *c);
+        } else {
+            str_append_char(&buf, '_');
+        }
+    }
+    str_append(&buf, suffix);
+    char *result = arena_strdup(a, str_cstr(&buf));
+    str_free(&buf);
+    return result;
+}
+
 char *path_find_project(Arena *a, const char *name) {
     if (!name) return NULL;
 
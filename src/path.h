@@ -11,6 +11,15 @@
  * Returns the first that exists, or the XDG default if none exist. */
 char *path_config_dir(Arena *a);
 
+/* Return the directory where mux keeps runtime state such as hook stamps:
+ * $XDG_STATE_HOME/mux, or ~/.local/state/mux. The directory may not exist. */
+char *path_state_dir(Arena *a);
+
+/* Return <state_dir>/<subdir>/<name><suffix>, with characters other than
+ * letters, digits, '-', '_' and '.' in name replaced by '_'. */
+char *path_state_file(Arena *a, const char *state_dir, const char *subdir, const char *name,
+                      const char *suffix);
+
 /* Find a project config file by name. Searches config dir for name.yml.
  * Returns arena-allocated path, or NULL if not found. */
 char *path_find_project(Arena *a, const char *name);
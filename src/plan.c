@@ -0,0 +1,562 @@
+#include "plan.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "schedule.h"
+
+void plan_window_size(int *sx, int *sy) {
+    const char *columns = getenv("MUX_TMUX_COLUMNS");
+    const char *lines = getenv("MUX_TMUX_LINES");
+    *sx = columns && atoi(columns) > 0 ? atoi(columns) : LAYOUT_DEFAULT_WIDTH;
+    *sy = lines && atoi(lines) > 0 ? atoi(lines) : LAYOUT_DEFAULT_HEIGHT;
+}
+
+/* tmux splits a pane only if both halves keep a line or column */
+#define PLAN_SPLIT_MIN 3
+
+/* Size of the smallest cell when n panes are tiled, as tmux's tiled layout
+ * lays them out */
+static void plan_tiled_cell(int n, int sx, int sy, int *cw, int *ch) {
+    int rows = 1, columns = 1;
+    while (rows * columns < n) {
+        rows++;
+        if (rows * columns < n) columns++;
+    }
+    *cw = (sx - (columns - 1)) / columns;
+    *ch = (sy - (rows - 1)) / rows;
+}
+
+bool plan_next_split(int count, int pi, int *cw, int *ch, int *percent, bool *horizontal) {
+    bool tile = *cw < PLAN_SPLIT_MIN && *ch < PLAN_SPLIT_MIN;
+    if (tile) {
+        int sx, sy;
+        plan_window_size(&sx, &sy);
+        plan_tiled_cell(pi, sx, sy, cw, ch);
+    }
+    int left = count - pi + 1;
+    *percent = 100 * (left - 1) / left;
+    *horizontal = *ch < PLAN_SPLIT_MIN || (*cw >= PLAN_SPLIT_MIN && *cw > *ch);
+
+    /* tmux takes the percentage of the pane, keeping a column or line each
+     * side of the border */
+    int *side = *horizontal ? cw : ch;
+    int size = *side * *percent / 100;
+    if (size > *side - 2) size = *side - 2;
+    *side = size < 1 ? 1 : size;
+    return tile;
+}
+
+/* The built-in layouts and split specs are worked out for the window's size
+ * (tmux scales the string if a client makes the window another size); other
+ * names and custom strings are left to the backend. The main-* layouts go by
+ * name too, so tmux sizes the main pane from main-pane-width and
+ * main-pane-height. */
+const char *plan_window_layout(Arena *a, const Window *w) {
+    const char *name = w->layout && w->layout[0] ? w->layout : NULL;
+    if (!name && !w->layout_spec && w->pane_count < 2) return NULL;
+    if (w->saved_layout) return w->saved_layout;
+    if (name && !w->layout_spec && strncmp(name, "main-", 5) == 0) return name;
+
+    int sx, sy;
+    plan_window_size(&sx, &sy);
+    LayoutCell *root = w->layout_spec
+                           ? layout_fit(a, w->layout_spec, sx, sy)
+                           : layout_preset(a, name ? name : "tiled", w->pane_count, sx, sy);
+    if (!root) {
+        if (name && !w->layout_spec) return name;
+        return name || w->pane_count > 1 ? "tiled" : NULL;
+    }
+    Str layout = str_new();
+    layout_format(root, &layout);
+    char *out = arena_strdup(a, str_cstr(&layout));
+    str_free(&layout);
+    return out;
+}
+
+LayoutCell *plan_window_layout_tree(Arena *a, const Window *w) {
+    int sx, sy;
+    plan_window_size(&sx, &sy);
+    LayoutCell *root = NULL;
+    if (w->saved_layout) {
+        root = layout_parse(a, w->saved_layout);
+    } else if (w->layout_spec) {
+        root = layout_fit(a, w->layout_spec, sx, sy);
+    } else if (w->layout && strchr(w->layout, ',')) {
+        root = layout_parse(a, w->layout);
+    } else {
+        root = layout_preset(a, w->layout && w->layout[0] ? w->layout : "tiled", w->pane_count,
+                             sx, sy);
+    }
+    return root && layout_pane_count(root) == w->pane_count ? root : NULL;
+}
+
+int plan_pane_lines(Arena *a, const Project *p, const Window *w, const Pane *pn,
+                    const char ***lines) {
+    const char **out = arena_alloc(a, sizeof(char *) * (size_t)(pn->command_count + 2));
+    int n = 0;
+    if (p->pre_window && p->pre_window[0]) out[n++] = p->pre_window;
+    if (w->pre && w->pre[0]) out[n++] = w->pre;
+    for (int ci = 0; ci < pn->command_count; ci++) out[n++] = pn->commands[ci];
+    *lines = out;
+    return n;
+}
+
+const char *plan_exec_command(Arena *a, const Project *p, const Window *w, const Pane *pn) {
+    if (!pn->exec) return NULL;
+    const char **lines;
+    int n = plan_pane_lines(a, p, w, pn, &lines);
+    if (n == 0) return NULL;
+
+    Str cmd = str_new();
+    for (int i = 0; i < n; i++) {
+        if (i > 0) str_append(&cmd, "; ");
+        str_append(&cmd, lines[i]);
+    }
+    char *out = arena_strdup(a, str_cstr(&cmd));
+    str_free(&cmd);
+    return out;
+}
+
+bool plan_line_is_pasted(const char *line) {
+    return strlen(line) >= 1024 || strchr(line, '\n');
+}
+
+static int is_nonnegative_int(const char *value) {
+    if (!value || !value[0]) return 0;
+    for (const char *c = value; *c; c++) {
+        if (*c < '0' || *c > '9') return 0;
+    }
+    return 1;
+}
+
+int plan_focused_pane(const Window *w) {
+    if (!w->focused_pane || !w->focused_pane[0]) return -1;
+    if (is_nonnegative_int(w->focused_pane)) return atoi(w->focused_pane);
+
+    for (int i = 0; i < w->pane_count; i++) {
+        if (w->panes[i].title && strcmp(w->panes[i].title, w->focused_pane) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int plan_startup_window(const Project *p) {
+    for (int wi = 0; p->startup_window && wi < p->window_count; wi++) {
+        if (p->windows[wi].name && strcmp(p->windows[wi].name, p->startup_window) == 0) {
+            return wi;
+        }
+    }
+    return 0;
+}
+
+/* Name the first thing p uses that the plan does not model, or NULL. */
+static const char *plan_unsupported(const Project *p) {
+    if (p->progressive && p->window_count > 1) return "progressive";
+    if (p->prewarm > 0) return "prewarm";
+    if (p->jobs > 1) return "jobs";
+    if (schedule_active(p)) return "depends_on and max_parallel";
+    for (int k = 0; k < HOOK_COUNT; k++) {
+        if (p->hooks[k].digest) return "hook inputs";
+    }
+    for (int wi = 0; wi < p->window_count; wi++) {
+        const Window *w = &p->windows[wi];
+        if (w->lazy && wi != plan_startup_window(p)) return "lazy windows";
+        if (w->wait_count > 0 || w->ready_count > 0) return "wait_for and ready";
+        for (int pi = 0; pi < w->pane_count; pi++) {
+            const Pane *pn = &w->panes[pi];
+            Priority prio = project_pane_priority(w, pn);
+            if (pn->wait_count > 0 || pn->ready_count > 0) return "wait_for and ready";
+            if (pn->signal_count > 0) return "signals";
+            if (prio.has_nice || prio.ionice || prio.cpu_affinity) return "priority";
+        }
+    }
+    return NULL;
+}
+
+static int plan_add(Arena *a, Plan *plan, PlanOpKind kind, int window, int pane) {
+    if (plan->count == plan->cap) {
+        int cap = plan->cap ? plan->cap * 2 : 32;
+        PlanOp *ops = arena_alloc(a, sizeof(PlanOp) * (size_t)cap);
+        if (plan->count > 0) memcpy(ops, plan->ops, sizeof(PlanOp) * (size_t)plan->count);
+        plan->ops = ops;
+        plan->cap = cap;
+    }
+    plan->ops[plan->count] = (PlanOp){.kind = kind, .window = window, .pane = pane};
+    return plan->count++;
+}
+
+/* Make op follow dep, once. Negative deps are ignored. */
+static void plan_depend(Arena *a, PlanOp *op, int dep) {
+    if (dep < 0) return;
+    for (int i = 0; i < op->dep_count; i++) {
+        if (op->deps[i] == dep) return;
+    }
+    /* Dependency lists are short; grow them in powers of two */
+    if ((op->dep_count & (op->dep_count - 1)) == 0) {
+        int *deps = arena_alloc(a, sizeof(int) * (size_t)(op->dep_count ? op->dep_count * 2 : 1));
+        if (op->dep_count > 0) memcpy(deps, op->deps, sizeof(int) * (size_t)op->dep_count);
+        op->deps = deps;
+    }
+    op->deps[op->dep_count++] = dep;
+}
+
+/* A hook that holds the build up until it is done, or -1 for none. */
+static int plan_add_hook(Arena *a, Plan *plan, const Project *p, HookKind kind, const char *cmd,
+                         int after) {
+    if (!cmd || !cmd[0]) return after;
+    int op = plan_add(a, plan, PLAN_HOOK, -1, -1);
+    plan->ops[op].hook = kind;
+    plan->ops[op].text = cmd;
+    plan_depend(a, &plan->ops[op], after);
+    HookMode mode = p->hooks[kind].mode;
+    return mode == HOOK_MODE_INLINE || mode == HOOK_MODE_SYNC ? op : after;
+}
+
+/* Every operation no other operation follows, for ones that come last. */
+static void plan_depend_on_sinks(Arena *a, Plan *plan, int op) {
+    char *followed = arena_alloc(a, (size_t)op + 1);
+    memset(followed, 0, (size_t)op + 1);
+    for (int i = 0; i < op; i++) {
+        for (int k = 0; k < plan->ops[i].dep_count; k++) followed[plan->ops[i].deps[k]] = 1;
+    }
+    for (int i = 0; i < op; i++) {
+        if (!followed[i]) plan_depend(a, &plan->ops[op], i);
+    }
+}
+
+Plan *plan_build(Arena *a, const Project *p) {
+    Plan *plan = arena_alloc(a, sizeof(Plan));
+    memset(plan, 0, sizeof(Plan));
+    plan->unsupported = plan_unsupported(p);
+
+    int hooks = plan_add_hook(a, plan, p, HOOK_PROJECT_START, p->on_project_start, -1);
+    hooks = plan_add_hook(a, plan, p, HOOK_PROJECT_FIRST_START, p->on_project_first_start, hooks);
+
+    int sx, sy;
+    plan_window_size(&sx, &sy);
+    int session = -1;
+    int *last = arena_alloc(a, sizeof(int) * (size_t)(p->window_count + 1));
+    int startup = plan_startup_window(p);
+    int startup_focus = -1;
+    for (int wi = 0; wi < p->window_count; wi++) {
+        const Window *w = &p->windows[wi];
+        const char *wr = w->root && w->root[0] ? w->root : p->root;
+
+        int create = plan_add(a, plan, wi == 0 ? PLAN_CREATE_SESSION : PLAN_CREATE_WINDOW, wi, 0);
+        plan->ops[create].cwd = wr;
+        plan->ops[create].text = plan_exec_command(a, p, w, &w->panes[0]);
+        plan_depend(a, &plan->ops[create], wi == 0 ? hooks : session);
+        if (wi == 0) session = create;
+
+        int sync = -1;
+        if (w->synchronize && strcmp(w->synchronize, "before") == 0) {
+            sync = plan_add(a, plan, PLAN_SYNCHRONIZE, wi, -1);
+            plan_depend(a, &plan->ops[sync], create);
+        }
+
+        /* Each split takes its share off the newest pane along that pane's
+         * longer side, as the start script does */
+        int cw = sx, ch = sy;
+        int *sends = arena_alloc(a, sizeof(int) * (size_t)(w->pane_count + 1));
+        int send_count = 0;
+        int made = create;
+        for (int pi = 0; pi < w->pane_count; pi++) {
+            const Pane *pn = &w->panes[pi];
+            if (pi > 0) {
+                int percent;
+                bool horizontal;
+                if (plan_next_split(w->pane_count, pi, &cw, &ch, &percent, &horizontal)) {
+                    int tile = plan_add(a, plan, PLAN_LAYOUT, wi, -1);
+                    plan->ops[tile].text = "tiled";
+                    plan_depend(a, &plan->ops[tile], made);
+                    made = tile;
+                }
+                int split = plan_add(a, plan, PLAN_SPLIT, wi, pi);
+                plan->ops[split].cwd = wr;
+                plan->ops[split].text = plan_exec_command(a, p, w, pn);
+                plan->ops[split].percent = percent;
+                plan->ops[split].horizontal = horizontal;
+                plan_depend(a, &plan->ops[split], made);
+                made = split;
+            }
+            if (pn->title && pn->title[0]) {
+                int title = plan_add(a, plan, PLAN_SET_TITLE, wi, pi);
+                plan->ops[title].text = pn->title;
+                plan_depend(a, &plan->ops[title], made);
+            }
+            if (pn->exec) continue;
+
+            const char **lines;
+            int n = plan_pane_lines(a, p, w, pn, &lines);
+            int prev = made;
+            for (int li = 0; li < n; li++) {
+                int send = plan_add(a, plan, PLAN_SEND, wi, pi);
+                plan->ops[send].lines = &lines[li];
+                plan->ops[send].line_count = 1;
+                plan_depend(a, &plan->ops[send], prev);
+                plan_depend(a, &plan->ops[send], sync);
+                prev = send;
+            }
+            if (n > 0) sends[send_count++] = prev;
+        }
+
+        const char *layout = plan_window_layout(a, w);
+        if (layout) {
+            int op = plan_add(a, plan, PLAN_LAYOUT, wi, -1);
+            plan->ops[op].text = layout;
+            plan_depend(a, &plan->ops[op], made);
+        }
+        last[wi] = made;
+
+        /* Splitting makes the new pane active, so focus waits for the last */
+        int focus_index = plan_focused_pane(w);
+        if (focus_index >= 0 && focus_index < w->pane_count) {
+            int op = plan_add(a, plan, PLAN_FOCUS, wi, focus_index);
+            plan_depend(a, &plan->ops[op], made);
+            if (wi == startup) startup_focus = op;
+        }
+
+        if (w->synchronize && strcmp(w->synchronize, "after") == 0) {
+            int op = plan_add(a, plan, PLAN_SYNCHRONIZE, wi, -1);
+            plan_depend(a, &plan->ops[op], made);
+            for (int k = 0; k < send_count; k++) plan_depend(a, &plan->ops[op], sends[k]);
+        }
+    }
+
+    /* new-window selects the window it makes, so the startup window is
+     * selected once they all exist */
+    if (p->window_count > 0) {
+        int op = plan_add(a, plan, PLAN_FOCUS, startup, -1);
+        for (int wi = 0; wi < p->window_count; wi++) plan_depend(a, &plan->ops[op], last[wi]);
+        int pane = p->startup_pane;
+        if (pane >= 0 && pane < p->windows[startup].pane_count) {
+            int focus = plan_add(a, plan, PLAN_FOCUS, startup, pane);
+            plan_depend(a, &plan->ops[focus], op);
+            plan_depend(a, &plan->ops[focus], startup_focus);
+        }
+    }
+
+    if (p->attach) {
+        int op = plan_add(a, plan, PLAN_ATTACH, -1, -1);
+        plan_depend_on_sinks(a, plan, op);
+    }
+    if (p->on_project_exit && p->on_project_exit[0]) {
+        int op = plan_add(a, plan, PLAN_HOOK, -1, -1);
+        plan->ops[op].hook = HOOK_PROJECT_EXIT;
+        plan->ops[op].text = p->on_project_exit;
+        plan_depend_on_sinks(a, plan, op);
+    }
+    return plan;
+}
+
+/* Rebuild the plan from into[], which gives for each operation its own
+ * index to keep it, an earlier index it was merged into, or -1 to drop it.
+ * Whatever followed a merged or dropped operation follows what it became,
+ * or what it followed. */
+static void plan_compact(Arena *a, Plan *plan, const int *into) {
+    int *index = arena_alloc(a, sizeof(int) * (size_t)(plan->count + 1));
+    PlanOp *old = plan->ops;
+    int n = 0;
+    for (int i = 0; i < plan->count; i++) {
+        index[i] = into[i] == i ? n++ : into[i] >= 0 ? index[into[i]] : -1;
+    }
+
+    /* Deps only point backwards, so a dropped operation's own deps are
+     * already resolved when its dependents are reached */
+    int **resolved = arena_alloc(a, sizeof(int *) * (size_t)(plan->count + 1));
+    int *resolved_count = arena_alloc(a, sizeof(int) * (size_t)(plan->count + 1));
+    PlanOp *ops = arena_alloc(a, sizeof(PlanOp) * (size_t)(n + 1));
+    for (int i = 0; i < plan->count; i++) {
+        PlanOp tmp = {0};
+        for (int k = 0; k < old[i].dep_count; k++) {
+            int d = old[i].deps[k];
+            if (index[d] >= 0) {
+                plan_depend(a, &tmp, index[d]);
+                continue;
+            }
+            for (int j = 0; j < resolved_count[d]; j++) plan_depend(a, &tmp, resolved[d][j]);
+        }
+        resolved[i] = tmp.deps;
+        resolved_count[i] = tmp.dep_count;
+        if (index[i] < 0) continue;
+
+        PlanOp *op = &ops[index[i]];
+        if (into[i] == i) {
+            *op = old[i];
+            op->deps = NULL;
+            op->dep_count = 0;
+        }
+        for (int k = 0; k < tmp.dep_count; k++) {
+            if (tmp.deps[k] != index[i]) plan_depend(a, op, tmp.deps[k]);
+        }
+    }
+    plan->ops = ops;
+    plan->count = n;
+    plan->cap = n;
+}
+
+void plan_coalesce(Arena *a, Plan *plan) {
+    int *into = arena_alloc(a, sizeof(int) * (size_t)(plan->count + 1));
+    int target = -1;
+    int merged = 0;
+    for (int i = 0; i < plan->count; i++) {
+        const PlanOp *op = &plan->ops[i];
+        into[i] = i;
+        if (op->kind != PLAN_SEND) {
+            target = -1;
+            continue;
+        }
+        const PlanOp *t = target >= 0 ? &plan->ops[target] : NULL;
+        if (!t || t->window != op->window || t->pane != op->pane) {
+            target = i;
+            continue;
+        }
+        into[i] = target;
+        merged = 1;
+    }
+    if (!merged) return;
+
+    /* Gather each send's lines before the indexes change */
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->ops[i].kind != PLAN_SEND || into[i] != i) continue;
+        int n = 0;
+        for (int j = i; j < plan->count && (j == i || into[j] == i); j++) {
+            n += plan->ops[j].line_count;
+        }
+        const char **lines = arena_alloc(a, sizeof(char *) * (size_t)n);
+        n = 0;
+        for (int j = i; j < plan->count && (j == i || into[j] == i); j++) {
+            for (int k = 0; k < plan->ops[j].line_count; k++) lines[n++] = plan->ops[j].lines[k];
+        }
+        plan->ops[i].lines = lines;
+        plan->ops[i].line_count = n;
+    }
+    plan_compact(a, plan, into);
+}
+
+/* Windows and panes start out selected as tmux leaves them: a new session
+ * or window is the current one, and a split's new pane is its window's
+ * active pane. */
+void plan_dedupe(Arena *a, Plan *plan) {
+    int windows = 0;
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->ops[i].window >= windows) windows = plan->ops[i].window + 1;
+    }
+    int *active = arena_alloc(a, sizeof(int) * (size_t)(windows + 1));
+    int *into = arena_alloc(a, sizeof(int) * (size_t)(plan->count + 1));
+    int current = -1;
+    int dropped = 0;
+    for (int i = 0; i < plan->count; i++) {
+        const PlanOp *op = &plan->ops[i];
+        into[i] = i;
+        switch (op->kind) {
+        case PLAN_CREATE_SESSION:
+        case PLAN_CREATE_WINDOW:
+            current = op->window;
+            active[op->window] = 0;
+            break;
+        case PLAN_SPLIT:
+            active[op->window] = op->pane;
+            break;
+        case PLAN_FOCUS:
+            if (op->pane < 0 ? current == op->window : active[op->window] == op->pane) {
+                into[i] = -1;
+                dropped = 1;
+            }
+            if (op->pane < 0) current = op->window;
+            if (op->pane >= 0) active[op->window] = op->pane;
+            break;
+        default:
+            break;
+        }
+    }
+    if (dropped) plan_compact(a, plan, into);
+}
+
+int plan_schedule(Plan *plan) {
+    int levels = 0;
+    for (int i = 0; i < plan->count; i++) {
+        PlanOp *op = &plan->ops[i];
+        op->level = 0;
+        for (int k = 0; k < op->dep_count; k++) {
+            int level = plan->ops[op->deps[k]].level + 1;
+            if (level > op->level) op->level = level;
+        }
+        if (op->level + 1 > levels) levels = op->level + 1;
+    }
+    return levels;
+}
+
+static const char *plan_op_name(PlanOpKind kind) {
+    switch (kind) {
+    case PLAN_HOOK:
+        return "hook";
+    case PLAN_CREATE_SESSION:
+        return "create-session";
+    case PLAN_CREATE_WINDOW:
+        return "create-window";
+    case PLAN_SPLIT:
+        return "split";
+    case PLAN_SET_TITLE:
+        return "set-title";
+    case PLAN_SEND:
+        return "send";
+    case PLAN_LAYOUT:
+        return "layout";
+    case PLAN_SYNCHRONIZE:
+        return "synchronize";
+    case PLAN_FOCUS:
+        return "focus";
+    case PLAN_ATTACH:
+        return "attach";
+    }
+    return "?";
+}
+
+void plan_dump(const Plan *plan, const Project *p, Str *out) {
+    int levels = 0;
+    for (int i = 0; i < plan->count; i++) {
+        if (plan->ops[i].level + 1 > levels) levels = plan->ops[i].level + 1;
+    }
+    str_appendf(out, "plan: %d operation%s in %d level%s\n", plan->count,
+                plan->count == 1 ? "" : "s", levels, levels == 1 ? "" : "s");
+    if (plan->unsupported) {
+        str_appendf(out, "not modelled: %s (mux start builds it)\n", plan->unsupported);
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        const PlanOp *op = &plan->ops[i];
+        str_appendf(out, "%3d [L%d] %s", i, op->level, plan_op_name(op->kind));
+        if (op->kind == PLAN_HOOK) {
+            str_appendf(out, " %s", project_hook_name(op->hook));
+        } else if (op->window >= 0) {
+            str_appendf(out, " %s:%s", p->name, p->windows[op->window].name);
+            if (op->pane >= 0) str_appendf(out, ".%d", op->pane);
+        }
+        switch (op->kind) {
+        case PLAN_SPLIT:
+            str_appendf(out, " %s %d%%", op->horizontal ? "-h" : "-v", op->percent);
+            /* fallthrough */
+        case PLAN_CREATE_SESSION:
+        case PLAN_CREATE_WINDOW:
+            if (op->cwd && op->cwd[0]) str_appendf(out, " cwd=%s", op->cwd);
+            if (op->text) str_appendf(out, " exec=\"%s\"", op->text);
+            break;
+        case PLAN_SET_TITLE:
+        case PLAN_LAYOUT:
+            str_appendf(out, " %s", op->text);
+            break;
+        case PLAN_SEND:
+            for (int k = 0; k < op->line_count; k++) str_appendf(out, " \"%s\"", op->lines[k]);
+            break;
+        default:
+            break;
+        }
+        for (int k = 0; k < op->dep_count; k++) {
+            str_appendf(out, "%s%d", k == 0 ? " <- " : ",", op->deps[k]);
+        }
+        str_append_char(out, '\n');
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef MUX_PLAN_H
+#define MUX_PLAN_H
+
+#include "arena.h"
+#include "project.h"
+#include "str.h"
+
+/* A launch plan: the operations that build a project's session, in order,
+ * each naming the operations it has to follow. It is backend neutral, so
+ * passes over it and the numbers taken from it hold for every backend. */
+
+typedef enum {
+    PLAN_HOOK,           /* run a project hook */
+    PLAN_CREATE_SESSION, /* the session, with window 0 and its first pane */
+    PLAN_CREATE_WINDOW,  /* a window with its first pane */
+    PLAN_SPLIT,          /* a pane split off the window's newest pane */
+    PLAN_SET_TITLE,      /* a pane title */
+    PLAN_SEND,           /* lines typed into a pane's shell */
+    PLAN_LAYOUT,         /* the window's layout, once its panes exist */
+    PLAN_SYNCHRONIZE,    /* synchronize-panes on for a window */
+    PLAN_FOCUS,          /* select a window, or a pane of it */
+    PLAN_ATTACH,         /* attach to the session, or switch to it */
+} PlanOpKind;
+
+typedef struct {
+    PlanOpKind kind;
+    int window; /* window index, or -1 */
+    int pane;   /* pane index in the window, or -1 */
+    const char *text;    /* hook commands, exec command, title or layout */
+    const char *cwd;     /* create and split: start directory */
+    HookKind hook;       /* PLAN_HOOK */
+    const char **lines;  /* PLAN_SEND */
+    int line_count;
+    int percent;         /* PLAN_SPLIT: share of the split pane the new pane takes */
+    bool horizontal;     /* PLAN_SPLIT: side by side rather than stacked */
+    int *deps;           /* indexes of the operations this one follows */
+    int dep_count;
+    int level;           /* set by plan_schedule() */
+} PlanOp;
+
+typedef struct {
+    PlanOp *ops;
+    int count;
+    int cap;
+    /* What the plan leaves out, when the project uses something only the
+     * full start script does, or NULL */
+    const char *unsupported;
+} Plan;
+
+/* Size windows are built at: $MUX_TMUX_COLUMNS by $MUX_TMUX_LINES, or the
+ * layout defaults, as given to new-session. */
+void plan_window_size(int *sx, int *sy);
+
+/* The split that makes pane pi of a window of count panes. It is taken off
+ * the newest pane, *cw by *ch cells (the window size for pane 1), along its
+ * longer side, leaving the new pane every pane still to come; *cw and *ch
+ * become the new pane's size. Returns true when the newest pane is too small
+ * to split, so the panes made so far have to be tiled first. */
+bool plan_next_split(int count, int pi, int *cw, int *ch, int *percent, bool *horizontal);
+
+/* The layout string a window is given after its panes are split: a saved
+ * layout, a built-in layout or split spec worked out for the window size,
+ * or the configured name (always for main-horizontal and main-vertical,
+ * whose main pane size is a tmux option). Windows without a layout are tiled; NULL when a
+ * window needs no layout. */
+const char *plan_window_layout(Arena *a, const Window *w);
+
+/* The same layout as a laid out tree, for backends that build it split by
+ * split, or NULL when it cannot be worked out for the window's panes. */
+LayoutCell *plan_window_layout_tree(Arena *a, const Window *w);
+
+/* Lines typed into a pane: pre_window, the window's pre, then its commands.
+ * Returns the number of lines. */
+int plan_pane_lines(Arena *a, const Project *p, const Window *w, const Pane *pn,
+                    const char ***lines);
+
+/* What an exec pane runs: its lines joined into one shell command, or NULL
+ * when the pane is not an exec pane or has nothing to run. */
+const char *plan_exec_command(Arena *a, const Project *p, const Window *w, const Pane *pn);
+
+/* True for a line too long, or spanning lines, to type: it is pasted
+ * through a buffer instead. */
+bool plan_line_is_pasted(const char *line);
+
+/* Index of the pane focused_pane names in w, or -1. */
+int plan_focused_pane(const Window *w);
+
+/* Index of the window to select once the session is built. */
+int plan_startup_window(const Project *p);
+
+/* Build the plan for starting p in a new session. */
+Plan *plan_build(Arena *a, const Project *p);
+
+/* Merge consecutive sends to one pane into a single send. */
+void plan_coalesce(Arena *a, Plan *plan);
+
+/* Drop focus operations that select what is already selected. */
+void plan_dedupe(Arena *a, Plan *plan);
+
+/* Give every operation the length of its longest chain of dependencies as
+ * its level; operations of one level do not depend on each other. Returns
+ * the number of levels. */
+int plan_schedule(Plan *plan);
+
+/* Append a readable listing of the plan. */
+void plan_dump(const Plan *plan, const Project *p, Str *out);
+
+#endif
@@ -0,0 +1,258 @@
+#include "priority.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+#endif
+
+/* Parse a whole decimal number in [lo, hi]. */
+static bool parse_int(const char *s, int lo, int hi, int *out) {
+    char *end = NULL;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || errno != 0 || v < lo || v > hi) return false;
+    *out = (int)v;
+    return true;
+}
+
+int priority_parse_ionice(const char *spec, IoniceClass *cls, int *level) {
+    if (!spec || !spec[0]) return -1;
+    if (isdigit((unsigned char)spec[0])) {
+        *cls = IONICE_BEST_EFFORT;
+        return parse_int(spec, 0, 7, level) ? 0 : -1;
+    }
+
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+    if (len == 4 && strncmp(spec, "idle", len) == 0) {
+        *cls = IONICE_IDLE;
+        *level = 0;
+        return colon ? -1 : 0; /* the idle class has no levels */
+    }
+    if ((len == 11 && strncmp(spec, "best-effort", len) == 0) ||
+        (len == 2 && strncmp(spec, "be", len) == 0)) {
+        *cls = IONICE_BEST_EFFORT;
+    } else if ((len == 8 && strncmp(spec, "realtime", len) == 0) ||
+               (len == 2 && strncmp(spec, "rt", len) == 0)) {
+        *cls = IONICE_REALTIME;
+    } else {
+        return -1;
+    }
+    *level = 4;
+    return !colon || parse_int(colon + 1, 0, 7, level) ? 0 : -1;
+}
+
+int priority_parse_cpus(const char *list, int *cpus, int max) {
+    if (!list || !list[0]) return -1;
+    bool *seen = calloc((size_t)max, sizeof(bool));
+    const char *p = list;
+    int rc = 0;
+    while (rc == 0) {
+        char *end = NULL;
+        long first = isdigit((unsigned char)*p) ? strtol(p, &end, 10) : -1;
+        long last = first;
+        if (first >= 0 && *end == '-' && isdigit((unsigned char)end[1])) {
+            last = strtol(end + 1, &end, 10);
+        }
+        if (first < 0 || last < first || last >= max || (*end != ',' && *end != '\0')) {
+            rc = -1;
+            break;
+        }
+        for (long cpu = first; cpu <= last; cpu++) seen[cpu] = true;
+        if (*end == '\0') break;
+        p = end + 1;
+    }
+
+    int count = 0;
+    for (int cpu = 0; rc == 0 && cpu < max; cpu++) {
+        if (seen[cpu]) cpus[count++] = cpu;
+    }
+    free(seen);
+    return rc == 0 ? count : -1;
+}
+
+typedef struct {
+    bool has_nice;
+    int nice;
+    IoniceClass ionice;
+    int ionice_level;
+    int *cpus;
+    int cpu_count;
+} PrioritySettings;
+
+/* Apply settings to one thread, reporting the first failure. */
+static int apply_task(const PrioritySettings *set, int tid) {
+    if (set->has_nice && setpriority(PRIO_PROCESS, (id_t)tid, set->nice) != 0) {
+        fprintf(stderr, "mux: priority: cannot set nice %d for pid %d: %s\n", set->nice, tid,
+                strerror(errno));
+        return -1;
+    }
+#ifdef __linux__
+    if (set->ionice != IONICE_NONE) {
+        int prio = ((int)set->ionice << IOPRIO_CLASS_SHIFT) | set->ionice_level;
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, prio) != 0) {
+            fprintf(stderr, "mux: priority: cannot set ionice for pid %d: %s\n", tid,
+                    strerror(errno));
+            return -1;
+        }
+    }
+    if (set->cpu_count > 0) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int i = 0; i < set->cpu_count; i++) CPU_SET(set->cpus[i], &mask);
+        if (sched_setaffinity(tid, sizeof(mask), &mask) != 0) {
+            fprintf(stderr, "mux: priority: cannot set cpu_affinity for pid %d: %s\n", tid,
+                    strerror(errno));
+            return -1;
+        }
+    }
+#endif
+    return 0;
+}
+
+#ifdef __linux__
+/* Read the parent of pid from /proc/PID/stat, or -1. */
+static int parent_pid(int pid) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    /* The command name may contain spaces and parentheses */
+    char *close = strrchr(buf, ')');
+    int ppid = -1;
+    if (!close || sscanf(close + 1, " %*c %d", &ppid) != 1) return -1;
+    return ppid;
+}
+
+/* Apply settings to every thread of pid. */
+static int apply_process(const PrioritySettings *set, int pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    DIR *dir = opendir(path);
+    if (!dir) return apply_task(set, pid);
+
+    int rc = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        int tid = atoi(ent->d_name);
+        if (tid > 0 && apply_task(set, tid) != 0) rc = -1;
+    }
+    closedir(dir);
+    return rc;
+}
+
+/* Apply settings to root and all of its descendants. Processes started
+ * afterwards inherit the settings from their parent. */
+static int apply_tree(const PrioritySettings *set, int root) {
+    int cap = 256, count = 0;
+    int *pids = malloc(sizeof(int) * (size_t)cap);
+    int *ppids = malloc(sizeof(int) * (size_t)cap);
+    DIR *proc = opendir("/proc");
+    struct dirent *ent;
+    while (proc && (ent = readdir(proc)) != NULL) {
+        int pid = atoi(ent->d_name);
+        if (pid <= 0) continue;
+        if (count == cap) {
+            cap *= 2;
+            pids = realloc(pids, sizeof(int) * (size_t)cap);
+            ppids = realloc(ppids, sizeof(int) * (size_t)cap);
+        }
+        pids[count] = pid;
+        ppids[count++] = parent_pid(pid);
+    }
+    if (proc) closedir(proc);
+
+    /* Breadth-first over the parent links, reusing a queue of found pids */
+    int *queue = malloc(sizeof(int) * (size_t)(count + 1));
+    int head = 0, tail = 0, rc = 0;
+    queue[tail++] = root;
+    while (head < tail) {
+        int pid = queue[head++];
+        if (apply_process(set, pid) != 0) rc = -1;
+        for (int i = 0; i < count; i++) {
+            if (ppids[i] == pid && tail <= count) queue[tail++] = pids[i];
+        }
+    }
+    free(queue);
+    free(pids);
+    free(ppids);
+    return rc;
+}
+#else
+static int apply_tree(const PrioritySettings *set, int root) {
+    return apply_task(set, root);
+}
+#endif
+
+static const char *const PRIORITY_USAGE =
+    "usage: mux priority [--nice N] [--ionice CLASS[:LEVEL]] [--cpus LIST] PID...\n";
+
+int priority_command(int argc, char **argv) {
+    PrioritySettings set = {0};
+    int cpus[PRIORITY_CPU_MAX];
+    int status = 0, first_pid = argc;
+
+    for (int i = 0; i < argc && status == 0 && first_pid == argc; i++) {
+        const char *opt = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (opt[0] != '-') {
+            first_pid = i;
+        } else if (!val) {
+            status = 2;
+        } else if (strcmp(opt, "--nice") == 0) {
+            set.has_nice = parse_int(val, -20, 19, &set.nice);
+            if (!set.has_nice) status = 2;
+            i++;
+        } else if (strcmp(opt, "--ionice") == 0) {
+            if (priority_parse_ionice(val, &set.ionice, &set.ionice_level) != 0) status = 2;
+            i++;
+        } else if (strcmp(opt, "--cpus") == 0) {
+            set.cpus = cpus;
+            set.cpu_count = priority_parse_cpus(val, cpus, PRIORITY_CPU_MAX);
+            if (set.cpu_count <= 0) status = 2;
+            i++;
+        } else {
+            status = 2;
+        }
+    }
+    if (status == 0 && first_pid == argc) status = 2;
+#ifndef __linux__
+    if (status == 0 && (set.ionice != IONICE_NONE || set.cpu_count > 0)) {
+        fprintf(stderr, "mux: priority: ionice and cpu_affinity need Linux; ignoring them\n");
+        set.ionice = IONICE_NONE;
+        set.cpu_count = 0;
+    }
+#endif
+
+    for (int i = first_pid; status == 0 && i < argc; i++) {
+        int pid = 0;
+        if (!parse_int(argv[i], 1, 0x7fffffff, &pid)) status = 2;
+    }
+    if (status == 2) {
+        fputs(PRIORITY_USAGE, stderr);
+        return status;
+    }
+
+    for (int i = first_pid; i < argc; i++) {
+        if (apply_tree(&set, atoi(argv[i])) != 0) status = 1;
+    }
+    return status;
+}
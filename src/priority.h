@@ -0,0 +1,29 @@
+#ifndef MUX_PRIORITY_H
+#define MUX_PRIORITY_H
+
+/* CPU and I/O priority for pane processes, applied by the hidden
+ * `mux priority` command that generated scripts run with a pane's PID. */
+
+#define PRIORITY_CPU_MAX 1024
+
+typedef enum {
+    IONICE_NONE = 0,
+    IONICE_REALTIME = 1,
+    IONICE_BEST_EFFORT = 2,
+    IONICE_IDLE = 3,
+} IoniceClass;
+
+/* Parse "idle", "best-effort[:LEVEL]", "realtime[:LEVEL]" or a bare
+ * best-effort LEVEL from 0 (highest) to 7. Returns 0 or -1. */
+int priority_parse_ionice(const char *spec, IoniceClass *cls, int *level);
+
+/* Parse a CPU list such as "0-3,8" into ascending CPU numbers. Returns the
+ * number of CPUs, or -1 for a malformed list or a CPU numbered max or above. */
+int priority_parse_cpus(const char *list, int *cpus, int max);
+
+/* Entry point for `mux priority [--nice N] [--ionice CLASS[:LEVEL]]
+ * [--cpus LIST] PID...`. Every process in each PID's tree is changed.
+ * Returns a process exit status: 0 applied, 1 partly failed, 2 usage. */
+int priority_command(int argc, char **argv);
+
+#endif
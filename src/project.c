@@ -4,12 +4,108 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "path.h"
+
 void project_init(Project *p) {
     memset(p, 0, sizeof(Project));
     p->attach = true;
     p->startup_pane = -1;
 }
 
+const char *project_hook_name(HookKind kind) {
+    switch (kind) {
+    case HOOK_PROJECT_START:
+        return "on_project_start";
+    case HOOK_PROJECT_FIRST_START:
+        return "on_project_first_start";
+    case HOOK_PROJECT_RESTART:
+        return "on_project_restart";
+    case HOOK_PROJECT_EXIT:
+        return "on_project_exit";
+    case HOOK_PROJECT_STOP:
+        return "on_project_stop";
+    case HOOK_COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+static int find_window(const Project *p, const char *name, size_t len) {
+    for (int i = 0; i < p->window_count; i++) {
+        const char *wn = p->windows[i].name;
+        if (wn && strlen(wn) == len && strncmp(wn, name, len) == 0) return i;
+    }
+    return -1;
+}
+
+int project_find_pane(const Project *p, const char *ref, int wi, int *window, int *pane) {
+    *pane = -1;
+    if ((*window = find_window(p, ref, strlen(ref))) >= 0) return 0;
+
+    const char *dot = strrchr(ref, '.');
+    if (dot && dot[1] != '\0') {
+        char *end = NULL;
+        long idx = strtol(dot + 1, &end, 10);
+        int found = find_window(p, ref, (size_t)(dot - ref));
+        if (*end == '\0' && found >= 0 && idx >= 0 && idx < p->windows[found].pane_count) {
+            *window = found;
+            *pane = (int)idx;
+            return 0;
+        }
+    }
+
+    if (wi >= 0 && wi < p->window_count) {
+        const Window *w = &p->windows[wi];
+        for (int k = 0; k < w->pane_count; k++) {
+            if (w->panes[k].title && strcmp(w->panes[k].title, ref) == 0) {
+                *window = wi;
+                *pane = k;
+                return 0;
+            }
+        }
+    }
+    *window = -1;
+    return -1;
+}
+
+Priority project_pane_priority(const Window *w, const Pane *pn) {
+    Priority prio = w->priority;
+    if (pn->priority.has_nice) {
+        prio.has_nice = true;
+        prio.nice = pn->priority.nice;
+    }
+    if (pn->priority.ionice) prio.ionice = pn->priority.ionice;
+    if (pn->priority.cpu_affinity) prio.cpu_affinity = pn->priority.cpu_affinity;
+    return prio;
+}
+
+void project_load_layouts(Arena *a, Project *p, const char *state_dir) {
+    p->layout_cache = path_state_file(a, state_dir, "layouts", p->name, "");
+    FILE *f = fopen(p->layout_cache, "r");
+    if (!f) return;
+
+    /* One "<panes> <layout> <name>" line per window, as list-windows wrote it */
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline(&line, &cap, f) > 0) {
+        line[strcspn(line, "\n")] = '\0';
+        int panes = 0, layout_end = 0;
+        if (sscanf(line, "%d %*s %n", &panes, &layout_end) != 1 || layout_end == 0) continue;
+        const char *layout = strchr(line, ' ') + 1;
+        const char *name = line + layout_end;
+        for (int i = 0; i < p->window_count; i++) {
+            Window *w = &p->windows[i];
+            if (w->saved_layout || !w->name || strcmp(w->name, name) != 0) continue;
+            if (w->pane_count == panes) {
+                w->saved_layout = arena_strndup(a, layout, strcspn(layout, " "));
+            }
+            break;
+        }
+    }
+    free(line);
+    fclose(f);
+}
+
 void project_free(Project *p) {
     /* When using arena allocation, this is a no-op since the arena
      * owns all the memory. This function exists for the case where
@@ -17,6 +113,25 @@ void project_free(Project *p) {
     (void)p;
 }
 
+static void dump_waits(const char *key, const WaitFor *waits, int count, const char *indent) {
+    static const char *kind_names[] = {"tcp", "file", "output", "signal"};
+    for (int i = 0; i < count; i++) {
+        const WaitFor *w = &waits[i];
+        printf("%s%s %s: %s (timeout %ds)", indent, key, kind_names[w->kind], w->target,
+               w->timeout);
+        if (w->kind == WAIT_OUTPUT) {
+            printf(" from [%d].%d", w->source_window, w->source_pane);
+        }
+        printf("\n");
+    }
+}
+
+static void dump_priority(const Priority *prio, const char *indent) {
+    if (prio->has_nice) printf("%snice: %d\n", indent, prio->nice);
+    if (prio->ionice) printf("%sionice: %s\n", indent, prio->ionice);
+    if (prio->cpu_affinity) printf("%scpu_affinity: %s\n", indent, prio->cpu_affinity);
+}
+
 void project_dump(const Project *p) {
     printf("Project: %s\n", p->name ? p->name : "(unnamed)");
     printf("  root: %s\n", p->root ? p->root : "(none)");
@@ -28,6 +143,9 @@ void project_dump(const Project *p) {
     printf("  startup_window: %s\n", p->startup_window ? p->startup_window : "(none)");
     printf("  startup_pane: %d\n", p->startup_pane);
     printf("  attach: %s\n", p->attach ? "true" : "false");
+    if (p->progressive) printf("  progressive: true\n");
+    if (p->max_parallel > 0) printf("  max_parallel: %d\n", p->max_parallel);
+    if (p->prewarm > 0) printf("  prewarm: %d\n", p->prewarm);
     printf("  enable_pane_titles: %s\n", p->enable_pane_titles ? "true" : "false");
     printf("  pane_title_format: %s\n", p->pane_title_format ? p->pane_title_format : "(none)");
     printf("  pane_title_position: %s\n",
@@ -39,6 +157,17 @@ void project_dump(const Project *p) {
     if (p->on_project_restart) printf("  on_project_restart: %s\n", p->on_project_restart);
     if (p->on_project_exit) printf("  on_project_exit: %s\n", p->on_project_exit);
     if (p->on_project_stop) printf("  on_project_stop: %s\n", p->on_project_stop);
+    static const char *mode_names[] = {"inline", "sync", "background", "parallel"};
+    for (int k = 0; k < HOOK_COUNT; k++) {
+        const HookOptions *h = &p->hooks[k];
+        if (h->mode != HOOK_MODE_INLINE || h->timeout > 0) {
+            printf("  %s mode: %s, timeout: %ds\n", project_hook_name((HookKind)k),
+                   mode_names[h->mode], h->timeout);
+        }
+        for (int i = 0; i < h->input_count; i++) {
+            printf("  %s input: %s\n", project_hook_name((HookKind)k), h->inputs[i]);
+        }
+    }
 
     printf("  windows (%d):\n", p->window_count);
     for (int i = 0; i < p->window_count; i++) {
@@ -46,9 +175,26 @@ void project_dump(const Project *p) {
         printf("    [%d] %s\n", i, w->name ? w->name : "(unnamed)");
         if (w->root) printf("      root: %s\n", w->root);
         if (w->layout) printf("      layout: %s\n", w->layout);
+        if (w->layout_spec) {
+            Arena a = arena_new();
+            LayoutCell *root =
+                layout_fit(&a, w->layout_spec, LAYOUT_DEFAULT_WIDTH, LAYOUT_DEFAULT_HEIGHT);
+            Str s = str_new();
+            if (root) layout_format(root, &s);
+            printf("      layout: %s\n", root ? str_cstr(&s) : "(does not fit)");
+            str_free(&s);
+            arena_free(&a);
+        }
         if (w->pre) printf("      pre: %s\n", w->pre);
         if (w->focused_pane) printf("      focused_pane: %s\n", w->focused_pane);
         if (w->synchronize) printf("      synchronize: %s\n", w->synchronize);
+        if (w->lazy) printf("      lazy: true\n");
+        dump_waits("wait_for", w->waits, w->wait_count, "      ");
+        dump_waits("ready", w->ready, w->ready_count, "      ");
+        for (int k = 0; k < w->depends_on_count; k++) {
+            printf("      depends_on: %s\n", w->depends_on[k]);
+        }
+        dump_priority(&w->priority, "      ");
         printf("      panes (%d):\n", w->pane_count);
         for (int j = 0; j < w->pane_count; j++) {
             Pane *pn = &w->panes[j];
@@ -60,6 +206,17 @@ void project_dump(const Project *p) {
             for (int k = 0; k < pn->command_count; k++) {
                 printf("          cmd: %s\n", pn->commands[k]);
             }
+            if (pn->exec) printf("          exec: true\n");
+            for (int k = 0; k < pn->signal_count; k++) {
+                printf("          signal: %s\n", pn->signals[k]);
+            }
+            dump_waits("wait_for", pn->waits, pn->wait_count, "          ");
+            dump_waits("ready", pn->ready, pn->ready_count, "          ");
+            for (int k = 0; k < pn->after_count; k++) {
+                printf("          after node: %d\n", pn->after[k]);
+            }
+            if (pn->turn_after >= 0) printf("          turn after node: %d\n", pn->turn_after);
+            dump_priority(&pn->priority, "          ");
         }
     }
 }
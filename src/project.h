@@ -3,23 +3,102 @@
 
 #include <stdbool.h>
 
+#include "layout.h"
+
+typedef enum {
+    WAIT_TCP,    /* a TCP port accepts connections */
+    WAIT_FILE,   /* a file exists */
+    WAIT_OUTPUT, /* another pane printed a line matching a pattern */
+    WAIT_SIGNAL, /* another pane reached one of its signal points */
+} WaitKind;
+
+/* A readiness gate: commands are only sent once the condition holds. */
+typedef struct {
+    WaitKind kind;
+    char *target;      /* [host:]port, file path, extended regex, or signal name */
+    char *from;        /* output: pane to watch, as written in the config */
+    int source_window; /* output: resolved pane to watch */
+    int source_pane;
+    int timeout; /* seconds */
+} WaitFor;
+
+/* Scheduling priority for a pane's processes; pane values override the window's. */
+typedef struct {
+    bool has_nice;
+    int nice;           /* -20 (highest) to 19 */
+    char *ionice;       /* "idle", "best-effort[:LEVEL]" or "realtime[:LEVEL]" */
+    char *cpu_affinity; /* CPU list such as "0-3,8" */
+} Priority;
+
 typedef struct {
     char *title;
     char **commands;
     int command_count;
+    WaitFor *waits;
+    int wait_count;
+    WaitFor *ready; /* conditions under which the pane counts as up */
+    int ready_count;
+    char **depends_on; /* windows or panes that must be up first */
+    int depends_on_count;
+    int *after; /* resolved node ids to wait for, set by schedule_resolve() */
+    int after_count;
+    int turn_after; /* node queued ahead of this pane under max_parallel, or -1 */
+    Priority priority;
+    bool exec; /* commands run as the pane's process instead of being typed into a shell */
+    char **signals; /* tmux wait-for channels signalled once the commands are done */
+    int signal_count;
 } Pane;
 
 typedef struct {
     char *name;
     char *root;
     char *layout;
+    LayoutCell *layout_spec; /* a declarative split tree given instead of a layout name */
+    char *saved_layout;      /* from `mux layout save`, kept while the pane count matches */
     char *pre;
     char *focused_pane;
     char *synchronize; /* "before", "after", or NULL */
+    WaitFor *waits;    /* gates every pane in the window */
+    int wait_count;
+    WaitFor *ready; /* applies to every pane in the window */
+    int ready_count;
+    char **depends_on;
+    int depends_on_count;
+    Priority priority;
+    bool lazy; /* commands wait until the window is first selected */
+    bool exec; /* every pane is an exec pane */
     Pane *panes;
     int pane_count;
 } Window;
 
+/* Project lifecycle hooks, in the order they appear in a Project. */
+typedef enum {
+    HOOK_PROJECT_START = 0,
+    HOOK_PROJECT_FIRST_START,
+    HOOK_PROJECT_RESTART,
+    HOOK_PROJECT_EXIT,
+    HOOK_PROJECT_STOP,
+    HOOK_COUNT,
+} HookKind;
+
+typedef enum {
+    HOOK_MODE_INLINE = 0, /* pasted into the generated script, as tmuxinator does */
+    HOOK_MODE_SYNC,       /* runs to completion (or its timeout) before continuing */
+    HOOK_MODE_BACKGROUND, /* detached; never delays the build or the attach */
+    HOOK_MODE_PARALLEL,   /* overlaps the build and is joined before attaching */
+} HookMode;
+
+typedef struct {
+    HookMode mode;
+    int timeout;    /* seconds; 0 means no deadline */
+    char *log_path; /* captured output for non-inline hooks, set by hook_resolve() */
+    char **inputs;  /* files or globs whose contents memoise the hook */
+    int input_count;
+    char *digest;     /* content hash of inputs, set by hook_resolve() */
+    char *stamp_path; /* digest of the last successful run */
+    bool up_to_date;  /* stamp matches digest, so the hook can be skipped */
+} HookOptions;
+
 typedef struct {
     char *name;
     char *root;
@@ -31,9 +110,14 @@ typedef struct {
     char *startup_window;
     int startup_pane;
     bool attach;
+    bool progressive; /* attach to the startup window while the others build */
     bool enable_pane_titles;
     char *pane_title_format;
     char *pane_title_position;
+    int max_parallel; /* panes starting at once under depends_on; 0 is unlimited */
+    int prewarm;      /* warm windows `mux prewarm` keeps pooled for starts; 0 is off */
+    int jobs;         /* windows built at once (`--jobs`); 0 or 1 builds them in order */
+    char *layout_cache; /* file `mux layout save` writes the session's layouts to */
 
     /* Hooks */
     char *on_project_start;
@@ -41,6 +125,7 @@ typedef struct {
     char *on_project_restart;
     char *on_project_exit;
     char *on_project_stop;
+    HookOptions hooks[HOOK_COUNT];
 
     Window *windows;
     int window_count;
@@ -49,6 +134,22 @@ typedef struct {
 /* Initialise a project with defaults. */
 void project_init(Project *p);
 
+/* Return the config key for a hook, e.g. "on_project_start". */
+const char *project_hook_name(HookKind kind);
+
+/* Resolve a reference to a window ("db"), a pane by index ("db.1") or a pane
+ * title in window wi. Sets *pane to -1 when the reference names a whole
+ * window. Returns 0, or -1 if nothing matches. */
+int project_find_pane(const Project *p, const char *ref, int wi, int *window, int *pane);
+
+/* Return the priority for a pane, taking each setting from the pane or else
+ * from its window. */
+Priority project_pane_priority(const Window *w, const Pane *pn);
+
+/* Set p->layout_cache to <state_dir>/layouts/<project> and give each window
+ * the layout saved there under its name, if it had as many panes then. */
+void project_load_layouts(Arena *a, Project *p, const char *state_dir);
+
 /* Free project contents (but not the Project pointer itself). */
 void project_free(Project *p);
 
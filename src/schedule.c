@@ -0,0 +1,191 @@
+#include "schedule.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "str.h"
+
+typedef struct {
+    int *deps;
+    int count;
+    int cap;
+} NodeDeps;
+
+bool schedule_active(const Project *p) {
+    if (p->max_parallel > 0) return true;
+    for (int wi = 0; wi < p->window_count; wi++) {
+        const Window *w = &p->windows[wi];
+        if (w->depends_on_count > 0) return true;
+        for (int pi = 0; pi < w->pane_count; pi++) {
+            if (w->panes[pi].depends_on_count > 0) return true;
+        }
+    }
+    return false;
+}
+
+int schedule_node_id(const Project *p, int wi, int pi) {
+    int id = 0;
+    for (int i = 0; i < wi; i++) id += p->windows[i].pane_count;
+    return id + pi;
+}
+
+static void add_dep(NodeDeps *node, int dep) {
+    for (int i = 0; i < node->count; i++) {
+        if (node->deps[i] == dep) return;
+    }
+    if (node->count == node->cap) {
+        node->cap = node->cap ? node->cap * 2 : 4;
+        node->deps = realloc(node->deps, sizeof(int) * (size_t)node->cap);
+    }
+    node->deps[node->count++] = dep;
+}
+
+/* Make every pane in [first, first + count) depend on the panes named by ref. */
+static int add_reference(const Project *p, NodeDeps *nodes, int wi, int first, int count,
+                         const char *ref) {
+    int window = -1, pane = -1;
+    if (project_find_pane(p, ref, wi, &window, &pane) != 0) {
+        fprintf(stderr, "mux: window '%s' depends_on unknown window or pane '%s'\n",
+                p->windows[wi].name ? p->windows[wi].name : "", ref);
+        return -1;
+    }
+
+    if (p->windows[window].lazy) {
+        fprintf(stderr, "mux: window '%s' cannot depend on lazy window '%s'\n",
+                p->windows[wi].name ? p->windows[wi].name : "", p->windows[window].name);
+        return -1;
+    }
+
+    int from = schedule_node_id(p, window, pane < 0 ? 0 : pane);
+    int to = pane < 0 ? from + p->windows[window].pane_count : from + 1;
+    for (int n = first; n < first + count; n++) {
+        for (int dep = from; dep < to; dep++) add_dep(&nodes[n], dep);
+    }
+    return 0;
+}
+
+static void append_node_label(Str *s, const Project *p, int node) {
+    for (int wi = 0; wi < p->window_count; wi++) {
+        const Window *w = &p->windows[wi];
+        if (node < w->pane_count) {
+            str_append(s, w->name ? w->name : "");
+            if (w->pane_count > 1) str_appendf(s, ".%d", node);
+            return;
+        }
+        node -= w->pane_count;
+    }
+}
+
+/* Every unfinished node waits on another unfinished node, so walking those
+ * waits from any of them must revisit a node: report that loop. */
+static void report_cycle(const Project *p, const NodeDeps *nodes, const bool *done, int n) {
+    int *step = malloc(sizeof(int) * (size_t)n);
+    int *walk = malloc(sizeof(int) * (size_t)n);
+    for (int i = 0; i < n; i++) step[i] = -1;
+
+    int node = 0, len = 0;
+    while (done[node]) node++;
+    while (step[node] < 0) {
+        step[node] = len;
+        walk[len++] = node;
+        for (int i = 0; i < nodes[node].count; i++) {
+            if (!done[nodes[node].deps[i]]) {
+                node = nodes[node].deps[i];
+                break;
+            }
+        }
+    }
+
+    Str msg = str_new();
+    for (int i = step[node]; i < len; i++) {
+        append_node_label(&msg, p, walk[i]);
+        str_append(&msg, " -> ");
+    }
+    append_node_label(&msg, p, node);
+    fprintf(stderr, "mux: depends_on cycle: %s\n", str_cstr(&msg));
+    str_free(&msg);
+    free(walk);
+    free(step);
+}
+
+int schedule_resolve(Arena *a, Project *p) {
+    for (int wi = 0; wi < p->window_count; wi++) {
+        for (int pi = 0; pi < p->windows[wi].pane_count; pi++) {
+            p->windows[wi].panes[pi].turn_after = -1;
+        }
+    }
+    if (!schedule_active(p)) return 0;
+
+    int n = schedule_node_id(p, p->window_count, 0);
+    NodeDeps *nodes = calloc((size_t)n, sizeof(NodeDeps));
+    bool *done = calloc((size_t)n, sizeof(bool));
+    int *order = malloc(sizeof(int) * (size_t)n);
+    int rc = 0;
+
+    for (int wi = 0; wi < p->window_count && rc == 0; wi++) {
+        const Window *w = &p->windows[wi];
+        int first = schedule_node_id(p, wi, 0);
+        for (int k = 0; k < w->depends_on_count && rc == 0; k++) {
+            rc = add_reference(p, nodes, wi, first, w->pane_count, w->depends_on[k]);
+        }
+        for (int pi = 0; pi < w->pane_count && rc == 0; pi++) {
+            const Pane *pn = &w->panes[pi];
+            for (int k = 0; k < pn->depends_on_count && rc == 0; k++) {
+                rc = add_reference(p, nodes, wi, first + pi, 1, pn->depends_on[k]);
+            }
+        }
+    }
+
+    /* Topological order, keeping config order among independent panes */
+    for (int placed = 0; placed < n && rc == 0; placed++) {
+        int next = -1;
+        for (int i = 0; i < n && next < 0; i++) {
+            if (done[i]) continue;
+            int ready = 1;
+            for (int k = 0; k < nodes[i].count && ready; k++) ready = done[nodes[i].deps[k]];
+            if (ready) next = i;
+        }
+        if (next < 0) {
+            report_cycle(p, nodes, done, n);
+            rc = -1;
+            break;
+        }
+        done[next] = true;
+        order[placed] = next;
+    }
+
+    for (int wi = 0; wi < p->window_count && rc == 0; wi++) {
+        Window *w = &p->windows[wi];
+        for (int pi = 0; pi < w->pane_count; pi++) {
+            NodeDeps *node = &nodes[schedule_node_id(p, wi, pi)];
+            w->panes[pi].after_count = node->count;
+            if (node->count > 0) {
+                w->panes[pi].after = arena_alloc(a, sizeof(int) * (size_t)node->count);
+                memcpy(w->panes[pi].after, node->deps, sizeof(int) * (size_t)node->count);
+            }
+        }
+    }
+
+    /* max_parallel splits that order into queues that start one pane at a
+     * time. A pane takes its turn once the pane ahead of it has finished
+     * starting, whether or not it came up; every turn points forward in the
+     * order, so queues cannot deadlock with depends_on. Lazy windows start
+     * when selected and exec panes as they are created, outside the queues. */
+    int queued = 0;
+    for (int i = 0; rc == 0 && p->max_parallel > 0 && i < n; i++) {
+        int wi = 0, node = order[i];
+        while (node >= p->windows[wi].pane_count) node -= p->windows[wi++].pane_count;
+        if (p->windows[wi].lazy || p->windows[wi].panes[node].exec) continue;
+        if (queued >= p->max_parallel) {
+            p->windows[wi].panes[node].turn_after = order[queued - p->max_parallel];
+        }
+        order[queued++] = order[i];
+    }
+
+    for (int i = 0; i < n; i++) free(nodes[i].deps);
+    free(nodes);
+    free(done);
+    free(order);
+    return rc;
+}
@@ -0,0 +1,23 @@
+#ifndef MUX_SCHEDULE_H
+#define MUX_SCHEDULE_H
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "project.h"
+
+/* Every pane is a scheduling node, numbered in config order. */
+
+/* True when depends_on or max_parallel orders the project's panes. */
+bool schedule_active(const Project *p);
+
+/* Return the node id of pane pi in window wi. */
+int schedule_node_id(const Project *p, int wi, int pi);
+
+/* Resolve depends_on into each pane's after list and check the graph for
+ * cycles. With max_parallel, panes also queue in dependency order through
+ * turn_after so that no more than max_parallel of them are starting at once.
+ * Returns 0, or -1 after reporting an unknown reference or a cycle. */
+int schedule_resolve(Arena *a, Project *p);
+
+#endif
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "plan.h"
+#include "schedule.h"
 #include "str.h"
 
 static const char *tmux_cmd(const Project *p) {
@@ -42,6 +44,17 @@ static void append_shell_word(Str *s, const char *word) {
     str_append_char(s, '\'');
 }
 
+/* Names are never paths, so a leading ~ is quoted rather than expanded */
+static void append_name_word(Str *s, const char *name) {
+    if (name && name[0] == '~' && shell_word_is_safe(name)) {
+        str_append_char(s, '\'');
+        str_append(s, name);
+        str_append_char(s, '\'');
+        return;
+    }
+    append_shell_word(s, name);
+}
+
 static void append_pane_title_arg(Str *s, const char *title) {
     if (shell_word_is_safe(title)) {
         str_appendf(s, "\"%s\"", title);
@@ -76,11 +89,20 @@ static void append_pane_target(Str *s, const Project *p, const char *window, int
     str_appendf(s, ".$((pane_base_index+%d))", pane_index);
 }
 
-static void append_select_tiled_layout(Str *s, const Project *p, const char *window) {
-    append_tmux_base(s, p);
-    str_append(s, " select-layout -t ");
-    append_window_target(s, p, window);
-    str_append(s, " tiled\n");
+/* Give a window its layout in one select-layout once every pane exists. A
+ * layout saved by `mux layout save` comes first; see plan_window_layout(). */
+static void append_select_layout(Str *s, const Project *p, const Window *w) {
+    Arena a = arena_new();
+    const char *layout = plan_window_layout(&a, w);
+    if (layout) {
+        append_tmux_base(s, p);
+        str_append(s, " select-layout -t ");
+        append_window_target(s, p, w->name);
+        str_append_char(s, ' ');
+        append_shell_word(s, layout);
+        str_append_char(s, '\n');
+    }
+    arena_free(&a);
 }
 
 static void append_query_base_indices(Str *s, const Project *p) {
@@ -98,8 +120,41 @@ static void append_session_target(Str *s, const Project *p) {
     append_shell_word(s, p->name);
 }
 
+/* Paste a large command through a tmux buffer: one load-buffer from a pipe
+ * and one paste, instead of escaping it into a send-keys argument. printf is
+ * a shell builtin, so the payload never meets the exec argument limit. -p
+ * pastes it in one piece into shells that ask for bracketed paste, and the
+ * buffer is named after the pane so background jobs never share one. */
+static void append_paste_payload(Str *s, const Project *p, const char *window, int pane_index,
+                                 const char *cmd) {
+    Str name = str_new();
+    str_appendf(&name, "%s.%d", window, pane_index);
+    str_append(s, "printf '%s' ");
+    append_shell_word(s, cmd);
+    str_append(s, " | ");
+    append_tmux_base(s, p);
+    str_append(s, " load-buffer -b \"mux-$$-\"");
+    append_shell_word(s, str_cstr(&name));
+    str_append(s, " -\n");
+    append_tmux_base(s, p);
+    str_append(s, " paste-buffer -d -p -b \"mux-$$-\"");
+    append_shell_word(s, str_cstr(&name));
+    str_append(s, " -t ");
+    append_pane_target(s, p, window, pane_index);
+    str_append(s, "\n");
+    append_tmux_base(s, p);
+    str_append(s, " send-keys -t ");
+    append_pane_target(s, p, window, pane_index);
+    str_append(s, " C-m\n");
+    str_free(&name);
+}
+
 static void append_send_keys_raw(Str *s, const Project *p, const char *window, int pane_index,
                                  const char *cmd) {
+    if (plan_line_is_pasted(cmd)) {
+        append_paste_payload(s, p, window, pane_index, cmd);
+        return;
+    }
     /* Escape double quotes in the command for embedding in bash */
     Str escaped = str_new();
     for (const char *c = cmd; *c; c++) {
@@ -122,6 +177,168 @@ static void append_send_keys_raw(Str *s, const Project *p, const char *window, i
     str_free(&escaped);
 }
 
+static int project_has_hook_mode(const Project *p, HookMode mode) {
+    for (int k = 0; k < HOOK_COUNT; k++) {
+        if (p->hooks[k].mode == mode) return 1;
+    }
+    return 0;
+}
+
+/* Emit the shell helpers used by supervised (non-inline) hooks. mux_hook runs
+ * a hook with its output captured to a log, enforces the deadline with a
+ * watchdog, and reports duration and exit status on stderr. */
+static void append_hook_helpers(Str *s, const Project *p) {
+    int supervised = 0;
+    for (int k = 0; k < HOOK_COUNT; k++) {
+        if (p->hooks[k].mode != HOOK_MODE_INLINE) supervised = 1;
+    }
+    if (!supervised) return;
+
+    str_append(s, "mux_hook_pids=''\n");
+    str_append(s, "mux_now() {\n");
+    str_append(s, "  if [ -n \"${EPOCHREALTIME:-}\" ]; then\n");
+    str_append(s, "    mux_now_us=${EPOCHREALTIME/[.,]/}\n");
+    str_append(s, "  else\n");
+    str_append(s, "    mux_now_us=$((SECONDS * 1000000))\n");
+    str_append(s, "  fi\n");
+    str_append(s, "}\n\n");
+    str_append(s, "# mux_hook NAME TIMEOUT LOG COMMAND\n");
+    str_append(s, "mux_hook() {\n");
+    str_append(s, "  local name=$1 timeout=$2 log=$3 started pid watchdog='' status=0 "
+                  "outcome ms\n");
+    str_append(s, "  mux_now; started=$mux_now_us\n");
+    str_append(s, "  [ -z \"$log\" ] || [ -d \"${log%/*}\" ] || mkdir -p \"${log%/*}\"\n");
+    /* Job control gives the hook a process group of its own, so a timeout
+     * stops everything it started */
+    str_append(s, "  set -m\n");
+    str_append(s, "  if [ -n \"$log\" ]; then\n");
+    str_append(s, "    bash -euo pipefail -c \"$4\" </dev/null >\"$log\" 2>&1 &\n");
+    str_append(s, "  else\n");
+    str_append(s, "    bash -euo pipefail -c \"$4\" </dev/null &\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  pid=$!\n");
+    str_append(s, "  set +m\n");
+    str_append(s, "  if [ \"$timeout\" -gt 0 ]; then\n");
+    str_append(s, "    ( sleep \"$timeout\" & s=$!; trap 'kill \"$s\" 2>/dev/null; exit 1' TERM\n");
+    str_append(s, "      wait \"$s\"; trap '' TERM; kill -TERM -- \"-$pid\" 2>/dev/null ) &\n");
+    str_append(s, "    watchdog=$!\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  wait \"$pid\" || status=$?\n");
+    str_append(s, "  outcome=\"exited with status $status\"\n");
+    str_append(s, "  if [ -n \"$watchdog\" ]; then\n");
+    str_append(s, "    kill -TERM \"$watchdog\" 2>/dev/null || true\n");
+    str_append(s, "    if wait \"$watchdog\"; then outcome='timed out'; status=124; fi\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  mux_now; ms=$(((mux_now_us - started) / 1000))\n");
+    str_append(s, "  printf 'mux: %s %s after %d.%03ds%s\\n' \"$name\" \"$outcome\" "
+                  "$((ms / 1000)) $((ms % 1000)) \"${log:+ (log: $log)}\" >&2\n");
+    str_append(s, "  return \"$status\"\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_hook_join() {\n");
+    str_append(s, "  local pid\n");
+    str_append(s, "  for pid in $mux_hook_pids; do wait \"$pid\" || true; done\n");
+    str_append(s, "  mux_hook_pids=''\n");
+    str_append(s, "}\n\n");
+}
+
+/* The stamp is the digest of the inputs once the hook has run, since a hook
+ * such as bundle install may rewrite the very files it is keyed on. */
+static void append_hook_stamp(Str *s, const Project *p, const HookOptions *h) {
+    const char *slash = strrchr(h->stamp_path, '/');
+    if (slash && slash != h->stamp_path) {
+        char *dir = strndup(h->stamp_path, (size_t)(slash - h->stamp_path));
+        str_append(s, "mkdir -p ");
+        append_shell_word(s, dir);
+        str_append(s, " && ");
+        free(dir);
+    }
+    str_append(s, "\"${MUX_BIN:-mux}\" hook-digest ");
+    append_shell_word(s, p->root ? p->root : "");
+    for (int i = 0; i < h->input_count; i++) {
+        str_append_char(s, ' ');
+        append_shell_word(s, h->inputs[i]);
+    }
+    str_append(s, " > ");
+    append_shell_word(s, h->stamp_path);
+}
+
+/* Emit a project hook. Memoised hooks (those with inputs) are skipped when
+ * their stamp matches, and otherwise record a new stamp once they succeed.
+ * Supervised hooks run through mux_hook according to their mode. */
+static void append_hook(Str *s, const Project *p, HookKind kind, const char *cmd,
+                        const char *indent) {
+    const HookOptions *h = &p->hooks[kind];
+    const char *name = project_hook_name(kind);
+    int memoised = h->digest && h->stamp_path;
+
+    if (memoised && h->up_to_date) {
+        str_appendf(s, "%s# %s skipped: inputs unchanged (%s)\n", indent, name, h->digest);
+        return;
+    }
+    if (memoised) {
+        str_appendf(s, "%s# %s runs: inputs changed (%s)\n", indent, name, h->digest);
+    }
+
+    if (h->mode == HOOK_MODE_INLINE) {
+        str_appendf(s, "%s%s\n", indent, cmd);
+        if (memoised) {
+            str_append(s, indent);
+            append_hook_stamp(s, p, h);
+            str_append(s, "\n");
+        }
+        return;
+    }
+
+    str_append(s, indent);
+    if (h->mode != HOOK_MODE_SYNC) str_append(s, "( ");
+    str_appendf(s, "mux_hook %s %d ", name, h->timeout);
+    append_shell_word(s, h->log_path ? h->log_path : "");
+    str_append_char(s, ' ');
+    append_shell_word(s, cmd);
+    if (memoised && h->mode != HOOK_MODE_SYNC) {
+        str_append(s, " && ");
+        append_hook_stamp(s, p, h);
+    }
+
+    switch (h->mode) {
+    case HOOK_MODE_BACKGROUND:
+        /* Detached: the report goes to the hook log, never to the terminal */
+        str_append(s, " ) </dev/null >/dev/null 2>>");
+        append_shell_word(s, h->log_path ? h->log_path : "/dev/null");
+        str_append(s, " &\n");
+        break;
+    case HOOK_MODE_PARALLEL:
+        str_append(s, " ) &\n");
+        str_appendf(s, "%smux_hook_pids=\"$mux_hook_pids $!\"\n", indent);
+        break;
+    default:
+        /* On a line of its own, so that set -e stops the start when it fails,
+         * as it does for a hook without inputs */
+        str_append(s, "\n");
+        if (memoised) {
+            str_append(s, indent);
+            append_hook_stamp(s, p, h);
+            str_append(s, "\n");
+        }
+        break;
+    }
+}
+
+static void append_hook_join(Str *s, const Project *p, const char *indent) {
+    if (project_has_hook_mode(p, HOOK_MODE_PARALLEL)) {
+        str_appendf(s, "%smux_hook_join\n", indent);
+    }
+}
+
+/* on_project_exit runs after attach returns, so a parallel exit hook is joined
+ * straight away rather than outliving the script. */
+static void append_exit_hook(Str *s, const Project *p, const char *indent) {
+    append_hook(s, p, HOOK_PROJECT_EXIT, p->on_project_exit, indent);
+    if (p->hooks[HOOK_PROJECT_EXIT].mode == HOOK_MODE_PARALLEL) {
+        append_hook_join(s, p, indent);
+    }
+}
+
 static const char *window_root(const Project *p, const Window *w) {
     if (w->root && w->root[0]) return w->root;
     if (p->root && p->root[0]) return p->root;
@@ -135,24 +352,787 @@ static const char *herdr_split_direction(const Window *w) {
     return "down";
 }
 
-static int is_nonnegative_int(const char *value) {
-    if (!value || !value[0]) return 0;
-    for (const char *c = value; *c; c++) {
-        if (*c < '0' || *c > '9') return 0;
+typedef struct {
+    const WaitFor *waits;
+    int count;
+} WaitList;
+
+/* Collect every condition list in config order: each window's wait_for and
+ * ready lists, then those of its panes. Pass NULL to only count them. */
+static int project_wait_lists(const Project *p, WaitList *out) {
+    int n = 0;
+    for (int wi = 0; wi < p->window_count; wi++) {
+        const Window *w = &p->windows[wi];
+        for (int pi = -1; pi < w->pane_count; pi++) {
+            const WaitFor *lists[2] = {pi < 0 ? w->waits : w->panes[pi].waits,
+                                       pi < 0 ? w->ready : w->panes[pi].ready};
+            int counts[2] = {pi < 0 ? w->wait_count : w->panes[pi].wait_count,
+                             pi < 0 ? w->ready_count : w->panes[pi].ready_count};
+            for (int k = 0; k < 2; k++) {
+                if (counts[k] == 0) continue;
+                if (out) out[n] = (WaitList){lists[k], counts[k]};
+                n++;
+            }
+        }
     }
-    return 1;
+    return n;
+}
+
+/* What every pane of one script needs to know about the whole project,
+ * worked out once so that emitting a pane does not rescan every other */
+typedef struct {
+    int scheduled;  /* schedule_active() */
+    int wait_lists; /* project_wait_lists() */
+    int lazy_count; /* lazy windows emitted so far */
+} ScriptState;
+
+static ScriptState script_state(const Project *p) {
+    return (ScriptState){schedule_active(p), project_wait_lists(p, NULL), 0};
+}
+
+/* Number output conditions in config order; the id names the mark file. */
+static int output_wait_id(const Project *p, const WaitFor *target) {
+    int n = project_wait_lists(p, NULL);
+    WaitList *lists = malloc(sizeof(WaitList) * (size_t)(n + 1));
+    project_wait_lists(p, lists);
+    int id = 0, found = -1;
+    for (int i = 0; i < n && found < 0; i++) {
+        for (int k = 0; k < lists[i].count && found < 0; k++) {
+            if (&lists[i].waits[k] == target) found = id;
+            if (lists[i].waits[k].kind == WAIT_OUTPUT) id++;
+        }
+    }
+    free(lists);
+    return found;
+}
+
+static int project_uses_wait_dir(const Project *p) {
+    return project_wait_lists(p, NULL) > 0 || schedule_active(p);
+}
+
+/* Make the per-run directory of append_wait_helpers(). A reaper removes it
+ * once everything holding fd 8 has exited: the script and the pane jobs it
+ * started. It must be opened once the tmux server is up, or the server
+ * would inherit the fd and keep the directory for good. */
+static void append_wait_dir(Str *s, const Project *p) {
+    if (!project_uses_wait_dir(p)) return;
+    str_append(s, "mux_wait_dir=$(mktemp -d \"${TMPDIR:-/tmp}/mux-wait.XXXXXX\")\n");
+    str_append(s, "exec 8> >(cat >/dev/null; rm -rf -- \"$mux_wait_dir\")\n");
+}
+
+/* Emit the helpers shared by readiness gates and the depends_on scheduler.
+ * mux_gate runs `mux wait-for` and reports a gate that never opened through
+ * tmux (or stderr for Herdr). Output conditions and scheduled panes are
+ * marked by files in a per-run directory: a pane's node file says whether it
+ * came up, and mux_after waits for those of the panes it depends on. On tmux,
+ * mux_live tells a pane job whether its session is still the one this run
+ * made, so a job that outlives a stop and start never types into the new
+ * session. */
+static void append_wait_helpers(Str *s, const Project *p, int herdr) {
+    int scheduled = schedule_active(p);
+    if (!project_uses_wait_dir(p)) return;
+
+    if (!herdr) {
+        str_append(s, "mux_live() {\n");
+        str_append(s, "  [ \"$(");
+        append_tmux_base(s, p);
+        str_append(s, " show-option -qv -t ");
+        append_session_target(s, p);
+        str_append(s, " @mux_run 2>/dev/null)\" = \"$mux_run\" ]\n");
+        str_append(s, "}\n\n");
+    }
+    str_append(s, "mux_report() {\n");
+    if (!herdr) {
+        /* Attached clients would paint over stderr, so tell them in tmux */
+        str_append(s, "  if [ -n \"$(");
+        append_tmux_base(s, p);
+        str_append(s, " list-clients -t ");
+        append_session_target(s, p);
+        str_append(s, " 2>/dev/null)\" ]; then\n");
+        str_append(s, "    ");
+        append_tmux_base(s, p);
+        str_append(s, " display-message -t ");
+        append_session_target(s, p);
+        str_append(s, " \"$1\" || true\n");
+        str_append(s, "    return 0\n");
+        str_append(s, "  fi\n");
+    }
+    str_append(s, "  printf '%s\\n' \"$1\" >&2\n");
+    str_append(s, "}\n\n");
+    str_append(s, "# mux_gate LABEL CONDITION...\n");
+    str_append(s, "mux_gate() {\n");
+    str_append(s, "  local label=$1 msg\n");
+    str_append(s, "  shift\n");
+    str_append(s, "  if msg=$(\"${MUX_BIN:-mux}\" wait-for \"$@\" 2>&1); then\n");
+    str_append(s, "    return 0\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  mux_report \"mux: $label: ${msg#mux: wait-for: }; "
+                  "${mux_gate_outcome:-commands not sent}\"\n");
+    str_append(s, "  return 1\n");
+    str_append(s, "}\n\n");
+    if (!scheduled) return;
+
+    str_append(s, "# mux_mark STATE LABEL NODE\n");
+    str_append(s, "mux_mark() {\n");
+    str_append(s, "  printf '%s %s\\n' \"$1\" \"$2\" > \"$3.tmp\" && mv \"$3.tmp\" \"$3\"\n");
+    str_append(s, "}\n\n");
+    str_append(s, "# mux_after LABEL NODE...\n");
+    str_append(s, "mux_after() {\n");
+    str_append(s, "  local label=$1 node state dep\n");
+    str_append(s, "  shift\n");
+    str_append(s, "  for node in \"$@\"; do\n");
+    str_append(s, "    \"${MUX_BIN:-mux}\" wait-for --timeout 86400 --file \"$node\" "
+                  "|| return 1\n");
+    str_append(s, "    read -r state dep < \"$node\" || true\n");
+    str_append(s, "    if [ \"$state\" != up ]; then\n");
+    str_append(s, "      mux_report \"mux: $label: not started because $dep did not come up\"\n");
+    str_append(s, "      return 1\n");
+    str_append(s, "    fi\n");
+    str_append(s, "  done\n");
+    str_append(s, "}\n\n");
+    if (p->max_parallel > 0) {
+        /* A turn is taken once the pane ahead has started, up or not */
+        str_append(s, "# mux_turn NODE\n");
+        str_append(s, "mux_turn() {\n");
+        str_append(s, "  \"${MUX_BIN:-mux}\" wait-for --timeout 86400 --file \"$1\"\n");
+        str_append(s, "}\n\n");
+    }
+    str_append(s, "# mux_up LABEL NODE [CONDITION...]\n");
+    str_append(s, "mux_up() {\n");
+    str_append(s, "  local label=$1 node=$2 state=up\n");
+    str_append(s, "  shift 2\n");
+    str_append(s, "  if [ \"$#\" -gt 0 ] && "
+                  "! mux_gate_outcome='dependents not started' mux_gate \"$label\" \"$@\"; then\n");
+    str_append(s, "    state=down\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  mux_mark \"$state\" \"$label\" \"$node\"\n");
+    str_append(s, "}\n\n");
+}
+
+static int window_starts_lazily(const Project *p, int wi) {
+    return p->windows[wi].lazy && wi != plan_startup_window(p);
+}
+
+/* Write a lazy window's deferred commands to a script and point the window's
+ * @mux_lazy option at it for `mux lazy-start`. */
+static void append_lazy_script(Str *s, const Project *p, int wi, const Str *deferred) {
+    const Window *w = &p->windows[wi];
+    str_appendf(s, "cat > \"$mux_lazy_dir/%d.sh\" <<'MUX_LAZY'\n", wi);
+    append_query_base_indices(s, p);
+    str_append(s, str_cstr(deferred));
+    str_append(s, "MUX_LAZY\n");
+    append_tmux_base(s, p);
+    str_append(s, " set-option -w -t ");
+    append_window_target(s, p, w->name);
+    str_appendf(s, " @mux_lazy \"$mux_lazy_dir/%d.sh\"\n", wi);
+}
+
+/* Apply nice, ionice and cpu_affinity to the pane's shell before anything
+ * runs in it, so that the commands it starts inherit them. */
+static void append_pane_priority(Str *s, const Project *p, int wi, int pi) {
+    const Window *w = &p->windows[wi];
+    Priority prio = project_pane_priority(w, &w->panes[pi]);
+    if (!prio.has_nice && !prio.ionice && !prio.cpu_affinity) return;
+
+    str_append(s, "\"${MUX_BIN:-mux}\" priority");
+    if (prio.has_nice) str_appendf(s, " --nice %d", prio.nice);
+    if (prio.ionice) {
+        str_append(s, " --ionice ");
+        append_shell_word(s, prio.ionice);
+    }
+    if (prio.cpu_affinity) {
+        str_append(s, " --cpus ");
+        append_shell_word(s, prio.cpu_affinity);
+    }
+    str_append(s, " \"$(");
+    append_tmux_base(s, p);
+    str_append(s, " display-message -p -t ");
+    append_pane_target(s, p, w->name, pi);
+    str_append(s, " '#{pane_pid}')\" || true\n");
 }
 
-static int focused_pane_index(const Window *w) {
-    if (!w->focused_pane || !w->focused_pane[0]) return -1;
-    if (is_nonnegative_int(w->focused_pane)) return atoi(w->focused_pane);
+/* Start the watcher for every output condition that reads this pane. tmux
+ * pipes the pane's output into `mux wait-for`, which marks each condition as
+ * its pattern matches and exits (closing the pipe) once all have, or at the
+ * deadline. */
+static void append_output_watch(Str *s, const Project *p, const ScriptState *st, int wi,
+                                int pi) {
+    int list_count = st->wait_lists;
+    if (list_count == 0) return;
+    WaitList *lists = malloc(sizeof(WaitList) * (size_t)list_count);
+    project_wait_lists(p, lists);
+
+    Str format = str_new();
+    Str args = str_new();
+    for (int i = 0; i < list_count; i++) {
+        for (int k = 0; k < lists[i].count; k++) {
+            const WaitFor *wf = &lists[i].waits[k];
+            if (wf->kind != WAIT_OUTPUT || wf->source_window != wi || wf->source_pane != pi) {
+                continue;
+            }
+            str_appendf(&format, " --timeout %d --output %%q --mark %%q", wf->timeout);
+            str_append_char(&args, ' ');
+            append_shell_word(&args, wf->target);
+            str_appendf(&args, " \"$mux_wait_dir/%d\"", output_wait_id(p, wf));
+        }
+    }
+
+    /* The pane echoes what is typed into it, which must not count as output */
+    if (format.len > 0) {
+        const Window *w = &p->windows[wi];
+        const Pane *pn = &w->panes[pi];
+        const char *typed[] = {p->pre_window, w->pre};
+        for (int i = 0; i < 2 + pn->command_count; i++) {
+            const char *cmd = i < 2 ? typed[i] : pn->commands[i - 2];
+            if (!cmd || !cmd[0]) continue;
+            str_append(&format, " --ignore %q");
+            str_append_char(&args, ' ');
+            append_shell_word(&args, cmd);
+        }
+        str_appendf(s, "printf -v mux_watch 'exec %%q wait-for%s' \"${MUX_BIN:-mux}\"%s\n",
+                    str_cstr(&format), str_cstr(&args));
+        /* tmux expands formats and strftime escapes in pipe-pane commands */
+        str_append(s, "mux_watch=${mux_watch//%/%%}\n");
+        str_append(s, "mux_watch=${mux_watch//\\#/\\#\\#}\n");
+        append_tmux_base(s, p);
+        str_append(s, " pipe-pane -o -t ");
+        append_pane_target(s, p, p->windows[wi].name, pi);
+        str_append(s, " \"$mux_watch\"\n");
+    }
+    str_free(&format);
+    str_free(&args);
+    free(lists);
+}
+
+/* Append `mux wait-for` arguments for a list of gates. Returns the number of
+ * conditions appended. */
+static int append_wait_args(Str *s, const Project *p, const Window *w, const WaitFor *waits,
+                            int count, int herdr) {
+    int appended = 0;
+    for (int k = 0; k < count; k++) {
+        const WaitFor *wf = &waits[k];
+        if ((wf->kind == WAIT_OUTPUT || wf->kind == WAIT_SIGNAL) && herdr) continue;
+        str_appendf(s, " --timeout %d", wf->timeout);
+        appended++;
+        if (wf->kind == WAIT_TCP) {
+            str_append(s, " --tcp ");
+            append_shell_word(s, wf->target);
+        } else if (wf->kind == WAIT_SIGNAL) {
+            str_appendf(s, " --signal \"mux-$mux_run-%s\"", wf->target);
+        } else if (wf->kind == WAIT_FILE) {
+            /* Relative paths are relative to the pane's working directory */
+            const char *root = window_root(p, w);
+            str_append(s, " --file ");
+            if (wf->target[0] == '/' || wf->target[0] == '~' || !root) {
+                append_shell_word(s, wf->target);
+            } else {
+                Str path = str_new();
+                str_appendf(&path, "%s/%s", root, wf->target);
+                append_shell_word(s, str_cstr(&path));
+                str_free(&path);
+            }
+        } else {
+            str_appendf(s, " --file \"$mux_wait_dir/%d\"", output_wait_id(p, wf));
+        }
+    }
+    return appended;
+}
+
+typedef enum {
+    JOB_NONE,  /* commands are sent inline */
+    JOB_GATED, /* "{ if PRECONDITIONS; then ... fi; } &" */
+    JOB_PLAIN, /* "{ ... } &": scheduled pane with nothing to wait for */
+} PaneJob;
+
+static void append_pane_label(Str *s, const Window *w, int pi) {
+    Str label = str_new();
+    str_appendf(&label, "%s.%d", w->name, pi);
+    append_shell_word(s, str_cstr(&label));
+    str_free(&label);
+}
+
+/* Open the background job that sends a pane's commands once its
+ * preconditions hold, so the rest of the session keeps building: the panes it
+ * depends on must have come up and its wait_for gates must pass. Under the
+ * depends_on scheduler every pane is such a job. Close it with
+ * append_pane_job_end(). */
+static PaneJob append_pane_job_begin(Str *s, const Project *p, const ScriptState *st, int wi,
+                                     int pi, int herdr) {
+    const Window *w = &p->windows[wi];
+    const Pane *pn = &w->panes[pi];
+    int scheduled = st->scheduled;
+    int has_commands = (p->pre_window && p->pre_window[0]) || (w->pre && w->pre[0]) ||
+                       pn->command_count > 0 || pn->signal_count > 0;
+    if (!scheduled && !has_commands) return JOB_NONE;
+
+    Str args = str_new();
+    int gated = append_wait_args(&args, p, w, w->waits, w->wait_count, herdr) +
+                append_wait_args(&args, p, w, pn->waits, pn->wait_count, herdr);
+    if (!gated && pn->after_count == 0 && pn->turn_after < 0) {
+        str_free(&args);
+        if (!scheduled) return JOB_NONE;
+        str_append(s, "{\n");
+        return JOB_PLAIN;
+    }
+
+    str_append(s, "{ if ");
+    if (pn->turn_after >= 0) {
+        str_appendf(s, "mux_turn \"$mux_wait_dir/node-%d\"", pn->turn_after);
+        if (pn->after_count > 0 || gated) str_append(s, " && ");
+    }
+    if (pn->after_count > 0) {
+        str_append(s, "mux_after ");
+        append_pane_label(s, w, pi);
+        for (int k = 0; k < pn->after_count; k++) {
+            str_appendf(s, " \"$mux_wait_dir/node-%d\"", pn->after[k]);
+        }
+        if (gated) str_append(s, " && ");
+    }
+    if (gated) {
+        str_append(s, "mux_gate ");
+        append_pane_label(s, w, pi);
+        str_append(s, str_cstr(&args));
+    }
+    if (!herdr) str_append(s, " && mux_live");
+    str_append(s, "; then\n");
+    str_free(&args);
+    return JOB_GATED;
+}
+
+/* Close a pane job. Scheduled panes record whether they came up, after their
+ * ready conditions, so that their dependents can go ahead. */
+static void append_pane_job_end(Str *s, const Project *p, const ScriptState *st, int wi, int pi,
+                                int herdr, PaneJob job) {
+    if (job == JOB_NONE) return;
+    const Window *w = &p->windows[wi];
+    const Pane *pn = &w->panes[pi];
+    int node = schedule_node_id(p, wi, pi);
+
+    if (st->scheduled) {
+        str_append(s, "mux_up ");
+        append_pane_label(s, w, pi);
+        str_appendf(s, " \"$mux_wait_dir/node-%d\"", node);
+        append_wait_args(s, p, w, w->ready, w->ready_count, herdr);
+        append_wait_args(s, p, w, pn->ready, pn->ready_count, herdr);
+        str_append(s, "\n");
+        if (job == JOB_GATED) {
+            str_append(s, "else\nmux_mark down ");
+            append_pane_label(s, w, pi);
+            str_appendf(s, " \"$mux_wait_dir/node-%d\"\n", node);
+        }
+    }
+    str_append(s, job == JOB_GATED ? "fi; } &\n" : "} &\n");
+}
+
+/* Warm windows wait in this session on the project's tmux server until a
+ * start claims them. */
+#define POOL_SESSION "_mux_pool"
+
+/* Emit mux_pool_fill, which tops the pool up to COUNT windows. Another fill
+ * may be running, such as the refill after a start, so a pool session that
+ * appears between the check and new-session is counted, not an error. */
+static void append_pool_fill_helper(Str *s, const Project *p) {
+    str_append(s, "# mux_pool_fill COUNT\n");
+    str_append(s, "mux_pool_fill() {\n");
+    str_append(s, "  local have=1\n");
+    str_append(s, "  if ");
+    append_tmux_base(s, p);
+    str_append(s, " has-session -t =" POOL_SESSION " 2>/dev/null ||\n     ! ");
+    append_tmux_base(s, p);
+    str_append(s, " new-session -d -s " POOL_SESSION " -n mux-pool 2>/dev/null; then\n");
+    str_append(s, "    have=$(");
+    append_tmux_base(s, p);
+    str_append(s, " list-windows -t =" POOL_SESSION " -F . | wc -l)\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  while [ \"$have\" -lt \"$1\" ]; do\n    ");
+    append_tmux_base(s, p);
+    str_append(s, " new-window -d -t =" POOL_SESSION ": -n mux-pool\n");
+    str_append(s, "    have=$((have + 1))\n");
+    str_append(s, "  done\n");
+    str_append(s, "}\n\n");
+}
+
+/* Emit mux_claim, which moves a warm window from the pool to TARGET, names
+ * it and changes to DIR, or fails so the caller creates the window itself.
+ * Once the pool has run dry the rest of the start skips asking. */
+static void append_pool_claim_helper(Str *s, const Project *p) {
+    append_pool_fill_helper(s, p);
+    str_append(s, "mux_pool_empty=''\n");
+    str_append(s, "# mux_claim TARGET NAME DIR [-k]\n");
+    str_append(s, "mux_claim() {\n");
+    str_append(s, "  local win='' dir\n");
+    str_append(s, "  [ -z \"$mux_pool_empty\" ] || return 1\n");
+    str_append(s, "  win=$(");
+    append_tmux_base(s, p);
+    str_append(s, " list-windows -t =" POOL_SESSION " -F '#{window_id}' 2>/dev/null) || true\n");
+    str_append(s, "  win=${win%%$'\\n'*}\n");
+    str_append(s, "  if [ -z \"$win\" ] || ! ");
+    append_tmux_base(s, p);
+    str_append(s, " move-window -d ${4:-} -s \"$win\" -t \"$1\" 2>/dev/null; then\n");
+    str_append(s, "    mux_pool_empty=1\n");
+    str_append(s, "    return 1\n");
+    str_append(s, "  fi\n  ");
+    append_tmux_base(s, p);
+    str_append(s, " rename-window -t \"$win\" \"$2\"\n");
+    str_append(s, "  if [ -n \"$3\" ]; then\n");
+    str_append(s, "    printf -v dir '%q' \"$3\"\n    ");
+    append_tmux_base(s, p);
+    str_append(s, " send-keys -t \"$win\" \" cd -- $dir && clear\" C-m\n");
+    str_append(s, "  fi\n");
+    str_append(s, "}\n\n");
+}
+
+/* Top the pool back up once this start has taken its windows. */
+static void append_pool_refill(Str *s, const Project *p) {
+    if (p->prewarm <= 0) return;
+    str_append(s, "\n# Refill the pool of warm windows\n");
+    str_appendf(s, "( mux_pool_fill %d ) </dev/null >/dev/null 2>&1 &\n", p->prewarm);
+}
+
+/* For an exec pane, finish the command that creates it with the pane's
+ * command and keep the pane once it exits. Chaining set-option onto the same
+ * tmux call means tmux applies it before it can notice the command exit.
+ * The new pane is the active one, so the window target finds it. */
+static void append_exec_spawn(Str *s, const Project *p, int wi, int pi) {
+    const Window *w = &p->windows[wi];
+    Arena a = arena_new();
+    const char *cmd = plan_exec_command(&a, p, w, &w->panes[pi]);
+    if (!window_starts_lazily(p, wi) && cmd) {
+        str_append_char(s, ' ');
+        append_shell_word(s, cmd);
+        for (int k = 0; k < w->panes[pi].signal_count; k++) {
+            str_appendf(s, "\"; tmux wait-for -S mux-$mux_run-%s\"", w->panes[pi].signals[k]);
+        }
+        str_append(s, " \\; set-option -p -t ");
+        append_window_target(s, p, w->name);
+        str_append(s, " remain-on-exit on");
+    }
+    arena_free(&a);
+}
+
+/* A lazy window's exec panes get their command when it is first selected. */
+static void append_exec_respawn(Str *s, const Project *p, int wi, int pi) {
+    const Window *w = &p->windows[wi];
+    const char *wr = window_root(p, w);
+    Arena a = arena_new();
+    const char *cmd = plan_exec_command(&a, p, w, &w->panes[pi]);
+    if (cmd) {
+        append_tmux_base(s, p);
+        str_append(s, " respawn-pane -k -t ");
+        append_pane_target(s, p, w->name, pi);
+        if (wr && wr[0]) {
+            str_append(s, " -c ");
+            append_shell_word(s, wr);
+        }
+        str_append_char(s, ' ');
+        append_shell_word(s, cmd);
+        str_append(s, " \\; set-option -p -t ");
+        append_pane_target(s, p, w->name, pi);
+        str_append(s, " remain-on-exit on\n");
+    }
+    arena_free(&a);
+}
+
+static int project_has_signals(const Project *p) {
+    for (int wi = 0; wi < p->window_count; wi++) {
+        for (int pi = 0; pi < p->windows[wi].pane_count; pi++) {
+            if (p->windows[wi].panes[pi].signal_count > 0) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Signals are tmux wait-for channels named after this run, so a channel
+ * left signalled by an earlier start never opens a gate, and mux_live checks
+ * the session against it. `mux wait-for` reaches the project's server
+ * through MUX_TMUX; panes already know it. */
+static void append_signal_run(Str *s, const Project *p) {
+    int signals = project_has_signals(p);
+    if (!signals && !project_uses_wait_dir(p)) return;
+    str_append(s, "mux_run=\"$$-$RANDOM\"\n");
+    if (!signals) {
+        str_append(s, "\n");
+        return;
+    }
+    Str tmux = str_new();
+    append_tmux_base(&tmux, p);
+    str_append(s, "export MUX_TMUX=");
+    append_shell_word(s, str_cstr(&tmux));
+    str_append(s, "\n\n");
+    str_free(&tmux);
+}
+
+/* Type the commands that send a pane's signals once its commands are done. */
+static void append_send_signals(Str *s, const Project *p, int wi, int pi) {
+    const Window *w = &p->windows[wi];
+    const Pane *pn = &w->panes[pi];
+    for (int k = 0; k < pn->signal_count; k++) {
+        append_tmux_base(s, p);
+        str_append(s, " send-keys -t ");
+        append_pane_target(s, p, w->name, pi);
+        str_appendf(s, " \"tmux wait-for -S mux-$mux_run-%s\" C-m\n", pn->signals[k]);
+    }
+}
+
+static int project_has_exec_panes(const Project *p) {
+    for (int wi = 0; wi < p->window_count; wi++) {
+        for (int pi = 0; pi < p->windows[wi].pane_count; pi++) {
+            if (p->windows[wi].panes[pi].exec) return 1;
+        }
+    }
+    return 0;
+}
+
+typedef enum {
+    WINDOW_EXISTS,   /* made by new-session */
+    WINDOW_NEW,      /* new-window, which also selects it */
+    WINDOW_DETACHED, /* new-window -d at its own index, leaving clients where they are */
+} WindowCreate;
+
+/* Emit the commands that create window wi, its panes and layout, and start
+ * its commands. st counts the lazy windows emitted so far. */
+static void append_window(Str *s, const Project *p, int wi, WindowCreate create,
+                          ScriptState *st) {
+    Window *w = &p->windows[wi];
+    const char *wr = window_root(p, w);
+    int lazy = window_starts_lazily(p, wi);
+    Str deferred = str_new();
+
+    str_appendf(s, "\n# Window: %s%s\n", w->name, lazy ? " (lazy)" : "");
+    if (lazy && st->lazy_count++ == 0) {
+        str_append(s, "mux_lazy_dir=$(mktemp -d \"${TMPDIR:-/tmp}/mux-lazy.XXXXXX\")\n");
+    }
+
+    /* A warm shell is no use to an exec pane */
+    int claim = p->prewarm > 0 && !(w->panes[0].exec && !lazy);
+    if (claim) {
+        /* Take a warm window from the pool, replacing the session's own */
+        str_append(s, create == WINDOW_EXISTS ? "mux_claim " : "if ! mux_claim ");
+        append_session_target(s, p);
+        if (create == WINDOW_EXISTS) {
+            str_append_char(s, ':');
+            append_name_word(s, w->name);
+        } else if (create == WINDOW_DETACHED) {
+            str_appendf(s, ":$((base_index + %d))", wi);
+        } else {
+            str_append_char(s, ':');
+        }
+        str_append_char(s, ' ');
+        append_name_word(s, w->name);
+        str_append_char(s, ' ');
+        append_shell_word(s, wr ? wr : "");
+        str_append(s, create == WINDOW_EXISTS ? " -k || true\n" : "; then\n");
+    }
+    if (create != WINDOW_EXISTS) {
+        /* Create new window */
+        append_tmux_base(s, p);
+        str_append(s, create == WINDOW_DETACHED ? " new-window -d -t " : " new-window -t ");
+        append_session_target(s, p);
+        if (create == WINDOW_DETACHED) str_appendf(s, ":$((base_index + %d))", wi);
+        str_append(s, " -n ");
+        append_name_word(s, w->name);
+        if (wr && wr[0]) {
+            str_append(s, " -c ");
+            append_shell_word(s, wr);
+        }
+        append_exec_spawn(s, p, wi, 0);
+        str_append(s, "\n");
+        if (claim) str_append(s, "fi\n");
+    }
+
+    /* Synchronize panes "before" — set sync before sending commands */
+    if (w->synchronize && strcmp(w->synchronize, "before") == 0) {
+        append_tmux_base(s, p);
+        str_append(s, " set-window-option -t ");
+        append_window_target(s, p, w->name);
+        str_append(s, " synchronize-panes on\n");
+    }
+
+    /* Create panes (first pane already exists with the window). Each split
+     * takes its share off the newest pane along that pane's longer side, so
+     * every pane has room and keeps its index until the layout is applied;
+     * a window with more panes than that leaves room for is tiled on the way. */
+    int cw, ch;
+    plan_window_size(&cw, &ch);
+    for (int pi = 0; pi < w->pane_count; pi++) {
+        if (pi > 0) {
+            int percent;
+            bool horizontal;
+            if (plan_next_split(w->pane_count, pi, &cw, &ch, &percent, &horizontal)) {
+                append_tmux_base(s, p);
+                str_append(s, " select-layout -t ");
+                append_window_target(s, p, w->name);
+                str_append(s, " tiled\n");
+            }
+            append_tmux_base(s, p);
+            str_append(s, " splitw -t ");
+            append_window_target(s, p, w->name);
+            str_appendf(s, " %s -p %d", horizontal ? "-h" : "-v", percent);
+            if (wr && wr[0]) {
+                str_append(s, " -c ");
+                append_shell_word(s, wr);
+            }
+            append_exec_spawn(s, p, wi, pi);
+            str_append(s, "\n");
+        }
+
+        /* Pane title */
+        if (p->enable_pane_titles && w->panes[pi].title) {
+            append_tmux_base(s, p);
+            str_append(s, " select-pane -t ");
+            append_pane_target(s, p, w->name, pi);
+            str_append(s, " -T ");
+            append_pane_title_arg(s, w->panes[pi].title);
+            str_append(s, "\n");
+        }
 
-    for (int i = 0; i < w->pane_count; i++) {
-        if (w->panes[i].title && strcmp(w->panes[i].title, w->focused_pane) == 0) {
-            return i;
+        /* Set up this pane's priority and output watch before anything runs in it */
+        append_pane_priority(s, p, wi, pi);
+        append_output_watch(s, p, st, wi, pi);
+        Pane *pn = &w->panes[pi];
+        if (pn->exec) {
+            /* Already running, unless the window is lazy; scheduled panes still report */
+            PaneJob job = JOB_NONE;
+            if (lazy) {
+                append_exec_respawn(&deferred, p, wi, pi);
+            } else if (st->scheduled) {
+                job = append_pane_job_begin(s, p, st, wi, pi, 0);
+            }
+            append_pane_job_end(s, p, st, wi, pi, 0, job);
+            continue;
         }
+        PaneJob job = lazy ? JOB_NONE : append_pane_job_begin(s, p, st, wi, pi, 0);
+        Str *keys = lazy ? &deferred : s;
+
+        /* pre_window, the window's pre, then the pane's commands */
+        Arena a = arena_new();
+        const char **lines;
+        int n = plan_pane_lines(&a, p, w, pn, &lines);
+        for (int li = 0; li < n; li++) append_send_keys_raw(keys, p, w->name, pi, lines[li]);
+        arena_free(&a);
+        append_send_signals(keys, p, wi, pi);
+        append_pane_job_end(s, p, st, wi, pi, 0, job);
+    }
+    if (lazy) append_lazy_script(s, p, wi, &deferred);
+    str_free(&deferred);
+
+    /* Set layout after all panes are created */
+    append_select_layout(s, p, w);
+
+    int focus_index = plan_focused_pane(w);
+    if (focus_index >= 0) {
+        append_tmux_base(s, p);
+        str_append(s, " select-pane -t ");
+        append_pane_target(s, p, w->name, focus_index);
+        str_append(s, "\n");
+    }
+
+    /* Synchronize panes "after" — set sync after sending commands */
+    if (w->synchronize && strcmp(w->synchronize, "after") == 0) {
+        append_tmux_base(s, p);
+        str_append(s, " set-window-option -t ");
+        append_window_target(s, p, w->name);
+        str_append(s, " synchronize-panes on\n");
     }
-    return -1;
+}
+
+/* Build every window but first in up to p->jobs parallel workers, each a
+ * subshell making its window at its own index with new-window -d. A FIFO
+ * holds one token per free worker, so a worker starts as soon as another
+ * finishes without polling. The join waits for all of them and fails the
+ * build if any did. */
+static void append_window_workers(Str *s, const Project *p, int first, ScriptState *st) {
+    int workers = p->window_count - 1;
+    int slots = p->jobs < workers ? p->jobs : workers;
+    int lazy = 0;
+    for (int wi = 0; wi < p->window_count; wi++) {
+        if (wi != first) lazy |= window_starts_lazily(p, wi);
+    }
+
+    str_appendf(s, "\n# Build the other windows in up to %d parallel workers\n", slots);
+    if (lazy && st->lazy_count++ == 0) {
+        str_append(s, "mux_lazy_dir=$(mktemp -d \"${TMPDIR:-/tmp}/mux-lazy.XXXXXX\")\n");
+    }
+    str_append(s, "mux_slots=$(mktemp -u \"${TMPDIR:-/tmp}/mux-slots.XXXXXX\")\n");
+    str_append(s, "mkfifo \"$mux_slots\"\n");
+    str_append(s, "exec 9<>\"$mux_slots\"\n");
+    str_append(s, "rm -f \"$mux_slots\"\n");
+    str_append(s, "printf '");
+    for (int i = 0; i < slots; i++) str_append_char(s, '.');
+    str_append(s, "' >&9\n");
+    str_append(s, "mux_workers=()\n");
+    for (int wi = 0; wi < p->window_count; wi++) {
+        if (wi == first) continue;
+        str_append(s, "read -r -n 1 -u 9 _\n");
+        str_append(s, "(\ntrap 'printf . >&9' EXIT\n");
+        append_window(s, p, wi, WINDOW_DETACHED, st);
+        str_append(s, ") &\nmux_workers+=($!)\n");
+    }
+    str_append(s, "\n# Join the workers\n");
+    str_append(s, "mux_failed=0\n");
+    str_append(s, "for mux_worker in \"${mux_workers[@]}\"; do\n");
+    str_append(s, "  wait \"$mux_worker\" || mux_failed=1\n");
+    str_append(s, "done\n");
+    str_append(s, "exec 9>&-\n");
+    str_append(s, "if [ \"$mux_failed\" -ne 0 ]; then\n");
+    str_append(s, "  echo 'mux: not every window could be built' >&2\n");
+    str_append(s, "  exit 1\n");
+    str_append(s, "fi\n");
+}
+
+static void append_lazy_hook(Str *s, const Project *p) {
+    str_append(s, "\n# Start lazy windows when first selected\n");
+    append_tmux_base(s, p);
+    str_append(s, " set-hook -t ");
+    append_session_target(s, p);
+    str_append(s, " session-window-changed "
+                  "\"run-shell -b '\\\"${MUX_BIN:-mux}\\\" lazy-start #{window_id}'\"\n");
+}
+
+/* Build every window but the startup one in a detached subshell, so that the
+ * client attaches as soon as the startup window is ready. The status line
+ * says so until the builder exits, and a failure is shown to the client. */
+static void append_background_build(Str *s, const Project *p, int first) {
+    int lazy = 0;
+    for (int wi = 0; wi < p->window_count; wi++) lazy |= window_starts_lazily(p, wi);
+
+    str_append(s, "\n# Show progress until the other windows are built\n");
+    str_append(s, "mux_status_right=$(");
+    append_tmux_base(s, p);
+    str_append(s, " show-option -gqv status-right)\n");
+    append_tmux_base(s, p);
+    str_append(s, " set-option -t ");
+    append_session_target(s, p);
+    str_appendf(s, " status-right \"#[reverse] mux: starting %d more window%s #[default] "
+                   "$mux_status_right\"\n",
+                p->window_count - 1, p->window_count > 2 ? "s" : "");
+    str_append(s, "mux_built() {\n  ");
+    append_tmux_base(s, p);
+    str_append(s, " set-option -qu -t ");
+    append_session_target(s, p);
+    str_append(s, " status-right || true\n");
+    str_append(s, "  if [ \"$1\" -ne 0 ]; then\n    ");
+    append_tmux_base(s, p);
+    str_append(s, " display-message -t ");
+    append_session_target(s, p);
+    str_append(s, " \"mux: not every window could be built (status $1)\" || true\n");
+    str_append(s, "  fi\n}\n");
+
+    /* Windows created with -d never change the current window, so the hook
+     * can go in before they exist */
+    if (lazy) append_lazy_hook(s, p);
+
+    str_append(s, "\n# Build the other windows in the background\n");
+    str_append(s, "(\ntrap 'mux_built $?' EXIT\n");
+    ScriptState st = script_state(p);
+    if (p->jobs > 1) {
+        append_window_workers(s, p, first, &st);
+    }
+    for (int wi = 0; p->jobs <= 1 && wi < p->window_count; wi++) {
+        if (wi != first) append_window(s, p, wi, WINDOW_DETACHED, &st);
+    }
+    append_pool_refill(s, p);
+    str_append(s, ") </dev/null >/dev/null 2>&1 &\n");
 }
 
 char *script_generate_start(const Project *p) {
@@ -160,6 +1140,10 @@ char *script_generate_start(const Project *p) {
 
     str_append(&s, "#!/usr/bin/env bash\n");
     str_append(&s, "set -euo pipefail\n\n");
+    append_hook_helpers(&s, p);
+    append_wait_helpers(&s, p, 0);
+    append_signal_run(&s, p);
+    if (p->prewarm > 0) append_pool_claim_helper(&s, p);
 
     /* Query tmux base indices */
     append_tmux_base(&s, p);
@@ -170,7 +1154,7 @@ char *script_generate_start(const Project *p) {
 
     /* on_project_start hook */
     if (p->on_project_start && p->on_project_start[0]) {
-        str_appendf(&s, "%s\n", p->on_project_start);
+        append_hook(&s, p, HOOK_PROJECT_START, p->on_project_start, "");
     }
 
     /* Check if session already exists */
@@ -183,125 +1167,78 @@ char *script_generate_start(const Project *p) {
 
     /* on_project_first_start hook */
     if (p->on_project_first_start && p->on_project_first_start[0]) {
-        str_appendf(&s, "%s\n\n", p->on_project_first_start);
+        append_hook(&s, p, HOOK_PROJECT_FIRST_START, p->on_project_first_start, "");
+        str_append(&s, "\n");
     }
 
-    /* Create new session with first window */
+    /* Create new session with first window, or with the startup window when
+     * the others are built after attaching */
     str_append(&s, "\n# Create new session\n");
-    const char *first_win_name = (p->window_count > 0) ? p->windows[0].name : "main";
-    const char *first_root = (p->window_count > 0) ? window_root(p, &p->windows[0]) : p->root;
+    int progressive = p->progressive && p->window_count > 1;
+    int first = progressive ? plan_startup_window(p) : 0;
+    const char *first_win_name = (p->window_count > 0) ? p->windows[first].name : "main";
+    const char *first_root =
+        (p->window_count > 0) ? window_root(p, &p->windows[first]) : p->root;
 
     append_tmux_base(&s, p);
     str_append(&s, " new-session -d -s ");
     append_shell_word(&s, p->name);
     str_append(&s, " -x \"${MUX_TMUX_COLUMNS:-120}\" -y \"${MUX_TMUX_LINES:-40}\"");
     str_append(&s, " -n ");
-    append_shell_word(&s, first_win_name);
+    append_name_word(&s, first_win_name);
     if (first_root && first_root[0]) {
         str_append(&s, " -c ");
         append_shell_word(&s, first_root);
     }
-    str_append(&s, "\n\n");
+    if (p->window_count > 0) append_exec_spawn(&s, p, first, 0);
+    str_append(&s, "\n");
+    if (project_uses_wait_dir(p)) {
+        append_tmux_base(&s, p);
+        str_append(&s, " set-option -t ");
+        append_session_target(&s, p);
+        str_append(&s, " @mux_run \"$mux_run\"\n");
+        append_wait_dir(&s, p);
+    }
+    str_append(&s, "\n");
     str_append(&s, "# Refresh base indices after the first window exists\n");
     append_query_base_indices(&s, p);
+    if (project_has_exec_panes(p)) {
+        str_append(&s, "\n# Report exec panes that exit\n");
+        append_tmux_base(&s, p);
+        str_append(&s, " set-hook -t ");
+        append_session_target(&s, p);
+        str_append(&s, " pane-died \"display-message 'mux: #{window_name}.#{pane_index} "
+                       "exited with status #{pane_dead_status}'\"\n");
+    }
 
     /* Create windows and panes */
-    for (int wi = 0; wi < p->window_count; wi++) {
-        Window *w = &p->windows[wi];
-        const char *wr = window_root(p, w);
-
-        str_appendf(&s, "\n# Window: %s\n", w->name);
-
-        if (wi > 0) {
-            /* Create new window */
+    ScriptState st = script_state(p);
+    if (progressive) {
+        if (first > 0) {
+            /* Leave the startup window's place in the window list */
             append_tmux_base(&s, p);
-            str_append(&s, " new-window -t ");
+            str_append(&s, " move-window -s ");
+            append_window_target(&s, p, first_win_name);
+            str_append(&s, " -t ");
             append_session_target(&s, p);
-            str_append(&s, " -n ");
-            append_shell_word(&s, w->name);
-            if (wr && wr[0]) {
-                str_append(&s, " -c ");
-                append_shell_word(&s, wr);
-            }
-            str_append(&s, "\n");
-        }
-
-        /* Synchronize panes "before" — set sync before sending commands */
-        if (w->synchronize && strcmp(w->synchronize, "before") == 0) {
-            append_tmux_base(&s, p);
-            str_append(&s, " set-window-option -t ");
-            append_window_target(&s, p, w->name);
-            str_append(&s, " synchronize-panes on\n");
-        }
-
-        /* Create panes (first pane already exists with the window) */
-        for (int pi = 0; pi < w->pane_count; pi++) {
-            if (pi > 0) {
-                append_tmux_base(&s, p);
-                str_append(&s, " splitw -t ");
-                append_window_target(&s, p, w->name);
-                if (wr && wr[0]) {
-                    str_append(&s, " -c ");
-                    append_shell_word(&s, wr);
-                }
-                str_append(&s, "\n");
-                append_select_tiled_layout(&s, p, w->name);
-            }
-
-            /* Pane title */
-            if (p->enable_pane_titles && w->panes[pi].title) {
-                append_tmux_base(&s, p);
-                str_append(&s, " select-pane -t ");
-                append_pane_target(&s, p, w->name, pi);
-                str_append(&s, " -T ");
-                append_pane_title_arg(&s, w->panes[pi].title);
-                str_append(&s, "\n");
-            }
-
-            /* pre_window commands */
-            if (p->pre_window && p->pre_window[0]) {
-                append_send_keys_raw(&s, p, w->name, pi, p->pre_window);
-            }
-
-            /* Window-level pre command */
-            if (w->pre && w->pre[0]) {
-                append_send_keys_raw(&s, p, w->name, pi, w->pre);
-            }
-
-            /* Pane commands */
-            Pane *pn = &w->panes[pi];
-            for (int ci = 0; ci < pn->command_count; ci++) {
-                append_send_keys_raw(&s, p, w->name, pi, pn->commands[ci]);
-            }
-        }
-
-        /* Set layout after all panes are created */
-        if (w->layout && w->layout[0]) {
-            append_tmux_base(&s, p);
-            str_append(&s, " select-layout -t ");
-            append_window_target(&s, p, w->name);
-            str_append_char(&s, ' ');
-            append_shell_word(&s, w->layout);
-            str_append(&s, "\n");
-        }
-
-        int focus_index = focused_pane_index(w);
-        if (focus_index >= 0) {
-            append_tmux_base(&s, p);
-            str_append(&s, " select-pane -t ");
-            append_pane_target(&s, p, w->name, focus_index);
-            str_append(&s, "\n");
-        }
-
-        /* Synchronize panes "after" — set sync after sending commands */
-        if (w->synchronize && strcmp(w->synchronize, "after") == 0) {
-            append_tmux_base(&s, p);
-            str_append(&s, " set-window-option -t ");
-            append_window_target(&s, p, w->name);
-            str_append(&s, " synchronize-panes on\n");
+            str_appendf(&s, ":$((base_index + %d))\n", first);
         }
+        append_window(&s, p, first, WINDOW_EXISTS, &st);
+    }
+    int workers = !progressive && p->jobs > 1 && p->window_count > 1;
+    if (workers) {
+        /* The session and first window are built first, the rest at once */
+        append_window(&s, p, 0, WINDOW_EXISTS, &st);
+        append_window_workers(&s, p, 0, &st);
+    }
+    for (int wi = 0; !progressive && !workers && wi < p->window_count; wi++) {
+        append_window(&s, p, wi, wi > 0 ? WINDOW_NEW : WINDOW_EXISTS, &st);
     }
 
+    /* Windows changed by our own new-window calls must not start lazy ones,
+     * so the hook goes in once they all exist */
+    if (st.lazy_count > 0) append_lazy_hook(&s, p);
+
     /* Enable pane titles globally if configured */
     if (p->enable_pane_titles) {
         str_append(&s, "\n# Pane titles\n");
@@ -340,13 +1277,21 @@ char *script_generate_start(const Project *p) {
         str_append(&s, "\n");
     }
 
+    if (progressive) {
+        append_background_build(&s, p, first);
+    } else {
+        append_pool_refill(&s, p);
+    }
+
     /* End of "session doesn't exist" block */
     if (p->on_project_restart && p->on_project_restart[0]) {
         str_append(&s, "\nelse\n\n");
-        str_appendf(&s, "%s\n\n", p->on_project_restart);
+        append_hook(&s, p, HOOK_PROJECT_RESTART, p->on_project_restart, "");
+        str_append(&s, "\n");
     }
 
     str_append(&s, "\nfi\n\n");
+    append_hook_join(&s, p, "");
 
     /* Attach or switch */
     if (p->attach) {
@@ -368,7 +1313,8 @@ char *script_generate_start(const Project *p) {
 
     /* on_project_exit hook */
     if (p->on_project_exit && p->on_project_exit[0]) {
-        str_appendf(&s, "\n%s\n", p->on_project_exit);
+        str_append(&s, "\n");
+        append_exit_hook(&s, p, "");
     }
 
     char *result = strdup(str_cstr(&s));
@@ -376,14 +1322,82 @@ char *script_generate_start(const Project *p) {
     return result;
 }
 
+char *script_generate_prewarm(const Project *p) {
+    Str s = str_with_capacity(1024);
+
+    str_append(&s, "#!/usr/bin/env bash\n");
+    str_append(&s, "set -euo pipefail\n\n");
+    append_pool_fill_helper(&s, p);
+    str_appendf(&s, "mux_pool_fill %d\n", p->prewarm);
+
+    char *result = strdup(str_cstr(&s));
+    str_free(&s);
+    return result;
+}
+
+char *script_generate_layout_save(const Project *p) {
+    Str s = str_with_capacity(1024);
+
+    str_append(&s, "#!/usr/bin/env bash\n");
+    str_append(&s, "set -euo pipefail\n\n");
+    str_append(&s, "# Every window's pane count, layout and name in one list-windows\n");
+    str_append(&s, "if ! mux_layouts=$(");
+    append_tmux_base(&s, p);
+    str_append(&s, " list-windows -t ");
+    append_session_target(&s, p);
+    str_append(&s, " -F '#{window_panes} #{window_layout} #{window_name}' 2>/dev/null); then\n");
+    Str msg = str_new();
+    str_appendf(&msg, "mux: no tmux session %s to save layouts from", p->name);
+    str_append(&s, "  echo ");
+    append_shell_word(&s, str_cstr(&msg));
+    str_append(&s, " >&2\n  exit 1\nfi\n");
+
+    const char *slash = strrchr(p->layout_cache, '/');
+    if (slash && slash != p->layout_cache) {
+        char *dir = strndup(p->layout_cache, (size_t)(slash - p->layout_cache));
+        str_append(&s, "mkdir -p ");
+        append_shell_word(&s, dir);
+        str_append(&s, "\n");
+        free(dir);
+    }
+    str_append(&s, "printf '%s\\n' \"$mux_layouts\" > ");
+    append_shell_word(&s, p->layout_cache);
+    str_clear(&msg);
+    str_appendf(&msg, "Saved window layouts to %s", p->layout_cache);
+    str_append(&s, "\necho ");
+    append_shell_word(&s, str_cstr(&msg));
+    str_append(&s, "\n");
+    str_free(&msg);
+
+    char *result = strdup(str_cstr(&s));
+    str_free(&s);
+    return result;
+}
+
 char *script_generate_stop(const Project *p) {
     Str s = str_with_capacity(512);
 
     str_append(&s, "#!/usr/bin/env bash\n\n");
+    append_hook_helpers(&s, p);
 
     /* on_project_stop hook */
     if (p->on_project_stop && p->on_project_stop[0]) {
-        str_appendf(&s, "%s\n\n", p->on_project_stop);
+        append_hook(&s, p, HOOK_PROJECT_STOP, p->on_project_stop, "");
+        str_append(&s, "\n");
+    }
+
+    /* Lazy windows never selected still have their scripts */
+    int lazy = 0;
+    for (int wi = 0; wi < p->window_count; wi++) lazy |= window_starts_lazily(p, wi);
+    if (lazy) {
+        append_tmux_base(&s, p);
+        str_append(&s, " list-windows -t ");
+        append_session_target(&s, p);
+        str_append(&s, " -F '#{@mux_lazy}' 2>/dev/null | while IFS= read -r mux_lazy; do\n");
+        str_append(&s, "  [ -n \"$mux_lazy\" ] || continue\n");
+        str_append(&s, "  rm -f \"$mux_lazy\"\n");
+        str_append(&s, "  rmdir \"${mux_lazy%/*}\" 2>/dev/null || true\n");
+        str_append(&s, "done\n");
     }
 
     /* Kill session */
@@ -391,6 +1405,18 @@ char *script_generate_stop(const Project *p) {
     str_append(&s, " kill-session -t ");
     append_session_target(&s, p);
     str_append(&s, "\n");
+    append_hook_join(&s, p, "");
+
+    char *result = strdup(str_cstr(&s));
+    str_free(&s);
+    return result;
+}
+
+char *script_generate_kill_server(const Project *p) {
+    Str s = str_with_capacity(128);
+
+    append_tmux_base(&s, p);
+    str_append(&s, " kill-server 2>/dev/null || true\n");
 
     char *result = strdup(str_cstr(&s));
     str_free(&s);
@@ -418,6 +1444,44 @@ static void append_herdr_capture_value(Str *s, const char *var_name, const char
     str_append(s, ")\n");
 }
 
+static int first_pane(const LayoutCell *cell) {
+    while (cell->kind != LAYOUT_PANE) cell = &cell->children[0];
+    return cell->pane;
+}
+
+static void append_herdr_split(Str *s, int wi, int from, int to, const char *direction,
+                               double ratio, const char *cwd) {
+    str_appendf(s,
+                "split_json_%d_%d=$(\"$herdr_cmd\" pane split \"$pane_%d_%d\" --direction %s "
+                "--ratio %.6f --focus",
+                wi, to, wi, from, direction, ratio);
+    append_herdr_cwd_arg(s, cwd);
+    str_append(s, ")\n");
+    char json_var[64], pane_var[64];
+    snprintf(json_var, sizeof(json_var), "split_json_%d_%d", wi, to);
+    snprintf(pane_var, sizeof(pane_var), "pane_%d_%d", wi, to);
+    append_herdr_capture_value(s, pane_var, json_var, "pane_id");
+}
+
+/* Split the pane holding a cell into its children's panes, one split per
+ * child after the first, each leaving the split pane that child's share of
+ * what is left, then split each child the same way. Each child's share
+ * includes the border after it. */
+static void append_herdr_splits(Str *s, int wi, const LayoutCell *cell, const char *cwd) {
+    int cols = cell->kind == LAYOUT_COLUMNS;
+    int rest = (cols ? cell->sx : cell->sy) + 1;
+    for (int i = 0; i + 1 < cell->child_count; i++) {
+        const LayoutCell *c = &cell->children[i];
+        int len = (cols ? c->sx : c->sy) + 1;
+        append_herdr_split(s, wi, first_pane(c), first_pane(&cell->children[i + 1]),
+                           cols ? "right" : "down", (double)len / rest, cwd);
+        rest -= len;
+    }
+    for (int i = 0; i < cell->child_count; i++) {
+        append_herdr_splits(s, wi, &cell->children[i], cwd);
+    }
+}
+
 static void append_herdr_send_command(Str *s, const char *pane_var, const char *cmd) {
     str_append(s, "\"$herdr_cmd\" pane send-text \"$");
     str_append(s, pane_var);
@@ -429,6 +1493,96 @@ static void append_herdr_send_command(Str *s, const char *pane_var, const char *
     str_append(s, "\" enter\n");
 }
 
+/* Emit the helpers every Herdr script uses, then make sure python3 and the
+ * Herdr server are there. */
+static void append_herdr_helpers(Str *s) {
+    str_append(s, "mux_herdr_server_running() {\n");
+    str_append(s, "  case $(\"$herdr_cmd\" status server 2>/dev/null || true) in\n");
+    str_append(s, "    *'status: running'*) return 0 ;;\n");
+    str_append(s, "    *) return 1 ;;\n");
+    str_append(s, "  esac\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_herdr_ensure_server() {\n");
+    str_append(s, "  if mux_herdr_server_running; then\n");
+    str_append(s, "    return 0\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  \"$herdr_cmd\" server >/dev/null 2>&1 &\n");
+    str_append(s, "  for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 "
+                   "21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 "
+                   "41 42 43 44 45 46 47 48 49 50; do\n");
+    str_append(s, "    if mux_herdr_server_running; then\n");
+    str_append(s, "      return 0\n");
+    str_append(s, "    fi\n");
+    str_append(s, "    sleep 0.1\n");
+    str_append(s, "  done\n");
+    str_append(s, "  echo \"mux: failed to start Herdr server\" >&2\n");
+    str_append(s, "  exit 1\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_herdr_need_python() {\n");
+    str_append(s, "  if ! command -v python3 >/dev/null 2>&1; then\n");
+    str_append(s, "    echo \"mux: herdr backend requires python3 for Herdr JSON parsing\" >&2\n");
+    str_append(s, "    exit 1\n");
+    str_append(s, "  fi\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_herdr_json_value() {\n");
+    str_append(s, "  python3 -c 'import json, sys\n");
+    str_append(s, "key = sys.argv[1]\n");
+    str_append(s, "try:\n");
+    str_append(s, "    doc = json.load(sys.stdin)\n");
+    str_append(s, "except Exception as exc:\n");
+    str_append(s, "    print(f\"mux: herdr returned invalid JSON while reading {key}: {exc}\", "
+                   "file=sys.stderr)\n");
+    str_append(s, "    sys.exit(1)\n");
+    str_append(s, "def walk(value):\n");
+    str_append(s, "    if isinstance(value, dict):\n");
+    str_append(s, "        if key in value:\n");
+    str_append(s, "            return value[key]\n");
+    str_append(s, "        for child in value.values():\n");
+    str_append(s, "            found = walk(child)\n");
+    str_append(s, "            if found is not None:\n");
+    str_append(s, "                return found\n");
+    str_append(s, "    elif isinstance(value, list):\n");
+    str_append(s, "        for child in value:\n");
+    str_append(s, "            found = walk(child)\n");
+    str_append(s, "            if found is not None:\n");
+    str_append(s, "                return found\n");
+    str_append(s, "    return None\n");
+    str_append(s, "value = walk(doc)\n");
+    str_append(s, "if value is not None:\n");
+    str_append(s, "    print(value)\n");
+    str_append(s, "else:\n");
+    str_append(s, "    print(f\"mux: herdr JSON response did not include {key}\", "
+                  "file=sys.stderr)\n");
+    str_append(s, "    sys.exit(1)\n");
+    str_append(s, "' \"$1\"\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_herdr_workspace_by_label() {\n");
+    str_append(s, "  \"$herdr_cmd\" workspace list | python3 -c 'import json, sys\n");
+    str_append(s, "label = sys.argv[1]\n");
+    str_append(s, "try:\n");
+    str_append(s, "    doc = json.load(sys.stdin)\n");
+    str_append(s, "except Exception as exc:\n");
+    str_append(s, "    print(f\"mux: herdr returned invalid JSON while reading workspace list: "
+                   "{exc}\", file=sys.stderr)\n");
+    str_append(s, "    sys.exit(1)\n");
+    str_append(s, "for workspace in doc.get(\"result\", {}).get(\"workspaces\", []):\n");
+    str_append(s, "    if workspace.get(\"label\") == label:\n");
+    str_append(s, "        print(workspace.get(\"workspace_id\", \"\"))\n");
+    str_append(s, "        break\n");
+    str_append(s, "' \"$1\"\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_herdr_attach() {\n");
+    str_append(s, "  if [ \"${MUX_HERDR_ATTACH:-1}\" = \"0\" ]; then\n");
+    str_append(s, "    return 0\n");
+    str_append(s, "  fi\n");
+    str_append(s, "  if [ -z \"${HERDR_SESSION:-}\" ] && [ -t 1 ]; then\n");
+    str_append(s, "    \"$herdr_cmd\" session attach default\n");
+    str_append(s, "  fi\n");
+    str_append(s, "}\n\n");
+    str_append(s, "mux_herdr_need_python\n");
+    str_append(s, "mux_herdr_ensure_server\n\n");
+}
+
 char *script_generate_start_herdr(const Project *p) {
     Str s = str_with_capacity(4096);
 
@@ -436,94 +1590,13 @@ char *script_generate_start_herdr(const Project *p) {
     str_append(&s, "# shellcheck disable=SC2016,SC2034\n");
     str_append(&s, "set -euo pipefail\n\n");
     str_append(&s, "herdr_cmd=${MUX_HERDR_COMMAND:-herdr}\n\n");
-    str_append(&s, "mux_herdr_server_running() {\n");
-    str_append(&s, "  case $(\"$herdr_cmd\" status server 2>/dev/null || true) in\n");
-    str_append(&s, "    *'status: running'*) return 0 ;;\n");
-    str_append(&s, "    *) return 1 ;;\n");
-    str_append(&s, "  esac\n");
-    str_append(&s, "}\n\n");
-    str_append(&s, "mux_herdr_ensure_server() {\n");
-    str_append(&s, "  if mux_herdr_server_running; then\n");
-    str_append(&s, "    return 0\n");
-    str_append(&s, "  fi\n");
-    str_append(&s, "  \"$herdr_cmd\" server >/dev/null 2>&1 &\n");
-    str_append(&s, "  for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 "
-                   "21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 "
-                   "41 42 43 44 45 46 47 48 49 50; do\n");
-    str_append(&s, "    if mux_herdr_server_running; then\n");
-    str_append(&s, "      return 0\n");
-    str_append(&s, "    fi\n");
-    str_append(&s, "    sleep 0.1\n");
-    str_append(&s, "  done\n");
-    str_append(&s, "  echo \"mux: failed to start Herdr server\" >&2\n");
-    str_append(&s, "  exit 1\n");
-    str_append(&s, "}\n\n");
-    str_append(&s, "mux_herdr_need_python() {\n");
-    str_append(&s, "  if ! command -v python3 >/dev/null 2>&1; then\n");
-    str_append(&s, "    echo \"mux: herdr backend requires python3 for Herdr JSON parsing\" >&2\n");
-    str_append(&s, "    exit 1\n");
-    str_append(&s, "  fi\n");
-    str_append(&s, "}\n\n");
-    str_append(&s, "mux_herdr_json_value() {\n");
-    str_append(&s, "  python3 -c 'import json, sys\n");
-    str_append(&s, "key = sys.argv[1]\n");
-    str_append(&s, "try:\n");
-    str_append(&s, "    doc = json.load(sys.stdin)\n");
-    str_append(&s, "except Exception as exc:\n");
-    str_append(&s, "    print(f\"mux: herdr returned invalid JSON while reading {key}: {exc}\", "
-                   "file=sys.stderr)\n");
-    str_append(&s, "    sys.exit(1)\n");
-    str_append(&s, "def walk(value):\n");
-    str_append(&s, "    if isinstance(value, dict):\n");
-    str_append(&s, "        if key in value:\n");
-    str_append(&s, "            return value[key]\n");
-    str_append(&s, "        for child in value.values():\n");
-    str_append(&s, "            found = walk(child)\n");
-    str_append(&s, "            if found is not None:\n");
-    str_append(&s, "                return found\n");
-    str_append(&s, "    elif isinstance(value, list):\n");
-    str_append(&s, "        for child in value:\n");
-    str_append(&s, "            found = walk(child)\n");
-    str_append(&s, "            if found is not None:\n");
-    str_append(&s, "                return found\n");
-    str_append(&s, "    return None\n");
-    str_append(&s, "value = walk(doc)\n");
-    str_append(&s, "if value is not None:\n");
-    str_append(&s, "    print(value)\n");
-    str_append(&s, "else:\n");
-    str_append(&s,
-               "    print(f\"mux: herdr JSON response did not include {key}\", file=sys.stderr)\n");
-    str_append(&s, "    sys.exit(1)\n");
-    str_append(&s, "' \"$1\"\n");
-    str_append(&s, "}\n\n");
-    str_append(&s, "mux_herdr_workspace_by_label() {\n");
-    str_append(&s, "  \"$herdr_cmd\" workspace list | python3 -c 'import json, sys\n");
-    str_append(&s, "label = sys.argv[1]\n");
-    str_append(&s, "try:\n");
-    str_append(&s, "    doc = json.load(sys.stdin)\n");
-    str_append(&s, "except Exception as exc:\n");
-    str_append(&s, "    print(f\"mux: herdr returned invalid JSON while reading workspace list: "
-                   "{exc}\", file=sys.stderr)\n");
-    str_append(&s, "    sys.exit(1)\n");
-    str_append(&s, "for workspace in doc.get(\"result\", {}).get(\"workspaces\", []):\n");
-    str_append(&s, "    if workspace.get(\"label\") == label:\n");
-    str_append(&s, "        print(workspace.get(\"workspace_id\", \"\"))\n");
-    str_append(&s, "        break\n");
-    str_append(&s, "' \"$1\"\n");
-    str_append(&s, "}\n\n");
-    str_append(&s, "mux_herdr_attach() {\n");
-    str_append(&s, "  if [ \"${MUX_HERDR_ATTACH:-1}\" = \"0\" ]; then\n");
-    str_append(&s, "    return 0\n");
-    str_append(&s, "  fi\n");
-    str_append(&s, "  if [ -z \"${HERDR_SESSION:-}\" ] && [ -t 1 ]; then\n");
-    str_append(&s, "    \"$herdr_cmd\" session attach default\n");
-    str_append(&s, "  fi\n");
-    str_append(&s, "}\n\n");
-    str_append(&s, "mux_herdr_need_python\n");
-    str_append(&s, "mux_herdr_ensure_server\n\n");
+    append_hook_helpers(&s, p);
+    append_wait_helpers(&s, p, 1);
+    append_wait_dir(&s, p);
+    append_herdr_helpers(&s);
 
     if (p->on_project_start && p->on_project_start[0]) {
-        str_appendf(&s, "%s\n", p->on_project_start);
+        append_hook(&s, p, HOOK_PROJECT_START, p->on_project_start, "");
     }
 
     str_append(&s, "workspace_id=$(mux_herdr_workspace_by_label ");
@@ -531,15 +1604,17 @@ char *script_generate_start_herdr(const Project *p) {
     str_append(&s, ")\n");
     str_append(&s, "if [ -n \"$workspace_id\" ]; then\n");
     str_append(&s, "  \"$herdr_cmd\" workspace focus \"$workspace_id\" >/dev/null\n");
+    append_hook_join(&s, p, "  ");
     str_append(&s, "  mux_herdr_attach\n");
     if (p->on_project_exit && p->on_project_exit[0]) {
-        str_appendf(&s, "  %s\n", p->on_project_exit);
+        append_exit_hook(&s, p, "  ");
     }
     str_append(&s, "  exit 0\n");
     str_append(&s, "fi\n\n");
 
     if (p->on_project_first_start && p->on_project_first_start[0]) {
-        str_appendf(&s, "%s\n\n", p->on_project_first_start);
+        append_hook(&s, p, HOOK_PROJECT_FIRST_START, p->on_project_first_start, "");
+        str_append(&s, "\n");
     }
 
     const char *first_win_name = (p->window_count > 0) ? p->windows[0].name : "main";
@@ -553,9 +1628,10 @@ char *script_generate_start_herdr(const Project *p) {
     append_herdr_capture_value(&s, "tab_0", "workspace_json", "tab_id");
     append_herdr_capture_value(&s, "pane_0_0", "workspace_json", "pane_id");
     str_append(&s, "\"$herdr_cmd\" tab rename \"$tab_0\" ");
-    append_shell_word(&s, first_win_name);
+    append_name_word(&s, first_win_name);
     str_append(&s, " >/dev/null\n\n");
 
+    ScriptState st = script_state(p);
     for (int wi = 0; wi < p->window_count; wi++) {
         Window *w = &p->windows[wi];
         const char *wr = window_root(p, w);
@@ -579,24 +1655,22 @@ char *script_generate_start_herdr(const Project *p) {
             append_herdr_capture_value(&s, pane_var, json_var, "pane_id");
         }
 
-        const char *direction = herdr_split_direction(w);
+        /* Make every pane first, splitting along the layout's tree when there
+         * is one and otherwise in a chain of same-direction splits */
+        Arena layout = arena_new();
+        LayoutCell *tree = w->pane_count > 1 ? plan_window_layout_tree(&layout, w) : NULL;
+        if (tree) {
+            append_herdr_splits(&s, wi, tree, wr);
+        }
+        for (int pi = 1; !tree && pi < w->pane_count; pi++) {
+            append_herdr_split(&s, wi, pi - 1, pi, herdr_split_direction(w),
+                               1.0 / (double)(w->pane_count - pi + 1), wr);
+        }
+        arena_free(&layout);
+
         for (int pi = 0; pi < w->pane_count; pi++) {
             char pane_var[64];
             snprintf(pane_var, sizeof(pane_var), "pane_%d_%d", wi, pi);
-            if (pi > 0) {
-                char prev_pane_var[64];
-                snprintf(prev_pane_var, sizeof(prev_pane_var), "pane_%d_%d", wi, pi - 1);
-                double split_ratio = 1.0 / (double)(w->pane_count - pi + 1);
-                str_appendf(&s,
-                            "split_json_%d_%d=$(\"$herdr_cmd\" pane split \"$%s\" --direction %s "
-                            "--ratio %.6f --focus",
-                            wi, pi, prev_pane_var, direction, split_ratio);
-                append_herdr_cwd_arg(&s, wr);
-                str_append(&s, ")\n");
-                char json_var[64];
-                snprintf(json_var, sizeof(json_var), "split_json_%d_%d", wi, pi);
-                append_herdr_capture_value(&s, pane_var, json_var, "pane_id");
-            }
 
             Pane *pn = &w->panes[pi];
             if (pn->title && pn->title[0]) {
@@ -606,18 +1680,28 @@ char *script_generate_start_herdr(const Project *p) {
                 append_shell_word(&s, pn->title);
                 str_append(&s, " >/dev/null\n");
             }
-            if (p->pre_window && p->pre_window[0]) {
-                append_herdr_send_command(&s, pane_var, p->pre_window);
-            }
-            if (w->pre && w->pre[0]) {
-                append_herdr_send_command(&s, pane_var, w->pre);
-            }
-            for (int ci = 0; ci < pn->command_count; ci++) {
-                append_herdr_send_command(&s, pane_var, pn->commands[ci]);
+            /* Herdr has no pipe-pane, so output gates do not hold commands back */
+            PaneJob job = append_pane_job_begin(&s, p, &st, wi, pi, 1);
+            Arena a = arena_new();
+            const char *exec_cmd = plan_exec_command(&a, p, w, pn);
+            if (exec_cmd) {
+                /* Herdr panes always start a shell, so the shell hands over to
+                 * the command */
+                Str line = str_new();
+                str_append(&line, "exec \"$SHELL\" -c ");
+                append_shell_word(&line, exec_cmd);
+                append_herdr_send_command(&s, pane_var, str_cstr(&line));
+                str_free(&line);
+            } else {
+                const char **lines;
+                int n = plan_pane_lines(&a, p, w, pn, &lines);
+                for (int li = 0; li < n; li++) append_herdr_send_command(&s, pane_var, lines[li]);
             }
+            arena_free(&a);
+            append_pane_job_end(&s, p, &st, wi, pi, 1, job);
         }
 
-        int focus_index = focused_pane_index(w);
+        int focus_index = plan_focused_pane(w);
         if (focus_index >= 0) {
             str_append(&s, "\"$herdr_cmd\" pane focus \"$");
             str_appendf(&s, "pane_%d_%d", wi, focus_index);
@@ -648,10 +1732,12 @@ char *script_generate_start_herdr(const Project *p) {
         str_appendf(&s, "\"$herdr_cmd\" pane focus \"$pane_0_%d\" >/dev/null\n", p->startup_pane);
     }
 
+    append_hook_join(&s, p, "");
     str_append(&s, "mux_herdr_attach\n");
 
     if (p->on_project_exit && p->on_project_exit[0]) {
-        str_appendf(&s, "\n%s\n", p->on_project_exit);
+        str_append(&s, "\n");
+        append_exit_hook(&s, p, "");
     }
 
     char *result = strdup(str_cstr(&s));
@@ -665,8 +1751,10 @@ char *script_generate_stop_herdr(const Project *p) {
     str_append(&s, "#!/usr/bin/env bash\n");
     str_append(&s, "set -euo pipefail\n\n");
     str_append(&s, "herdr_cmd=${MUX_HERDR_COMMAND:-herdr}\n\n");
+    append_hook_helpers(&s, p);
     if (p->on_project_stop && p->on_project_stop[0]) {
-        str_appendf(&s, "%s\n\n", p->on_project_stop);
+        append_hook(&s, p, HOOK_PROJECT_STOP, p->on_project_stop, "");
+        str_append(&s, "\n");
     }
     str_append(&s, "if ! command -v python3 >/dev/null 2>&1; then\n");
     str_append(&s, "  echo \"mux: herdr backend requires python3 for Herdr JSON parsing\" >&2\n");
@@ -689,6 +1777,7 @@ char *script_generate_stop_herdr(const Project *p) {
     str_append(&s, "  [ -n \"$workspace_id\" ] || continue\n");
     str_append(&s, "  \"$herdr_cmd\" workspace close \"$workspace_id\" >/dev/null\n");
     str_append(&s, "done\n");
+    append_hook_join(&s, p, "");
 
     char *result = strdup(str_cstr(&s));
     str_free(&s);
@@ -8,14 +8,29 @@
 char *script_generate_start(const Project *p);
 
 /* Generate a bash script to start a Herdr workspace for the given project.
- * Experimental: tmux layouts are approximated with Herdr pane splits.
+ * Experimental: tmux layouts are rebuilt as a tree of Herdr pane splits.
  * Returns a malloc'd string (caller must free). */
 char *script_generate_start_herdr(const Project *p);
 
+/* Generate a bash script that fills the pool of warm windows that starts of
+ * this project claim, up to p->prewarm, on the project's tmux server.
+ * Returns a malloc'd string (caller must free). */
+char *script_generate_prewarm(const Project *p);
+
+/* Generate a bash script that saves the layout of every window in the
+ * project's running session to p->layout_cache, for later starts to apply.
+ * Returns a malloc'd string (caller must free). */
+char *script_generate_layout_save(const Project *p);
+
 /* Generate a bash script to stop (kill) a tmux session.
  * Returns a malloc'd string (caller must free). */
 char *script_generate_stop(const Project *p);
 
+/* Generate a bash script that kills the project's whole tmux server, for
+ * servers of its own such as mux bench's. Returns a malloc'd string (caller
+ * must free). */
+char *script_generate_kill_server(const Project *p);
+
 /* Generate a bash script to stop (close) a Herdr workspace by project label.
  * Returns a malloc'd string (caller must free). */
 char *script_generate_stop_herdr(const Project *p);
@@ -0,0 +1,98 @@
+#include "stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STATS_MAX_PHASES 64
+#define STATS_MAX_DEPTH 16
+
+StatsCounts stats_counts;
+size_t stats_arena_live;
+size_t stats_arena_peak;
+
+typedef struct {
+    const char *name;
+    int depth;
+    StatsCounts start;
+    StatsCounts counts; /* since start, once closed */
+} StatsPhase;
+
+static struct {
+    bool on;
+    StatsPhase phases[STATS_MAX_PHASES];
+    int count;
+    int open[STATS_MAX_DEPTH];
+    int depth;
+} stats;
+
+void stats_start_from_env(void) {
+    const char *env = getenv("MUX_STATS");
+    stats.on = env && env[0] && strcmp(env, "0") != 0;
+}
+
+bool stats_enabled(void) {
+    return stats.on;
+}
+
+void stats_begin(const char *name) {
+    if (!stats.on) return;
+    /* Past the limits a phase is dropped, but still closed in turn */
+    if (stats.depth < STATS_MAX_DEPTH) {
+        int i = -1;
+        if (stats.count < STATS_MAX_PHASES) {
+            i = stats.count++;
+            stats.phases[i] =
+                (StatsPhase){.name = name, .depth = stats.depth, .start = stats_counts};
+        }
+        stats.open[stats.depth] = i;
+    }
+    stats.depth++;
+}
+
+void stats_end(void) {
+    if (!stats.on || stats.depth == 0) return;
+    stats.depth--;
+    if (stats.depth < STATS_MAX_DEPTH && stats.open[stats.depth] >= 0) {
+        StatsPhase *ph = &stats.phases[stats.open[stats.depth]];
+        ph->counts = stats_since(&ph->start);
+    }
+}
+
+StatsCounts stats_since(const StatsCounts *before) {
+    StatsCounts c = stats_counts;
+    c.arena_requested -= before->arena_requested;
+    c.arena_used -= before->arena_used;
+    c.arena_blocks -= before->arena_blocks;
+    c.arena_block_bytes -= before->arena_block_bytes;
+    c.arena_wasted -= before->arena_wasted;
+    c.str_grows -= before->str_grows;
+    c.str_copied -= before->str_copied;
+    return c;
+}
+
+static void format_row(Str *out, const char *name, int depth, const StatsCounts *c) {
+    str_appendf(out, "%*s%-*s %10zu %10zu %7zu %11zu %9zu %7zu %10zu\n", depth * 2, "",
+                28 - depth * 2, name, c->arena_requested, c->arena_used, c->arena_blocks,
+                c->arena_block_bytes, c->arena_wasted, c->str_grows, c->str_copied);
+}
+
+void stats_format(Str *out, const StatsCounts *total) {
+    str_appendf(out, "%-28s %10s %10s %7s %11s %9s %7s %10s\n", "mux stats (bytes)", "requested",
+                "used", "blocks", "block bytes", "wasted", "grows", "copied");
+    for (int i = 0; i < stats.count; i++) {
+        format_row(out, stats.phases[i].name, stats.phases[i].depth, &stats.phases[i].counts);
+    }
+    format_row(out, "total", 0, total);
+    str_appendf(out, "arena peak: %zu bytes in blocks\n", stats_arena_peak);
+}
+
+void stats_report(void) {
+    if (!stats.on) return;
+    /* Leave out the table's own buffer */
+    StatsCounts total = stats_counts;
+    Str out = str_new();
+    stats_format(&out, &total);
+    fputs(str_cstr(&out), stderr);
+    str_free(&out);
+}
@@ -0,0 +1,48 @@
+#ifndef MUX_STATS_H
+#define MUX_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "str.h"
+
+/* Allocation counts for MUX_STATS=1: what the arenas and Str buffers ask
+ * for and waste, broken down by the phases trace_begin() opens. */
+
+typedef struct {
+    size_t arena_requested;   /* bytes asked of arena_alloc() */
+    size_t arena_used;        /* the same rounded up to the alignment */
+    size_t arena_blocks;      /* blocks allocated */
+    size_t arena_block_bytes; /* their size */
+    size_t arena_wasted;      /* left at the end of a block when a request did not fit */
+    size_t str_grows;         /* Str buffers allocated or reallocated */
+    size_t str_copied;        /* bytes a reallocation may have had to move */
+} StatsCounts;
+
+/* The running totals. arena.c and str.c bump them on every allocation, which
+ * costs less than asking whether anyone is looking. */
+extern StatsCounts stats_counts;
+
+/* Block bytes allocated and not yet freed, and the most there have been */
+extern size_t stats_arena_live;
+extern size_t stats_arena_peak;
+
+/* Turn on the per-phase breakdown when MUX_STATS is set to other than 0. */
+void stats_start_from_env(void);
+
+bool stats_enabled(void);
+
+/* Open and close a phase; trace_begin() and trace_end() call these. */
+void stats_begin(const char *name);
+void stats_end(void);
+
+/* The counts since before, each field after minus before. */
+StatsCounts stats_since(const StatsCounts *before);
+
+/* Append the phases, then total and the arena peak, as a table. */
+void stats_format(Str *out, const StatsCounts *total);
+
+/* Write the table to stderr if stats are on. */
+void stats_report(void);
+
+#endif
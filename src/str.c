@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "stats.h"
+
 #define STR_INITIAL_CAP 64
 
 static void str_grow(Str *s, size_t needed) {
@@ -15,6 +17,8 @@ static void str_grow(Str *s, size_t needed) {
     while (new_cap < s->len + needed + 1) {
         new_cap = new_cap < STR_INITIAL_CAP ? STR_INITIAL_CAP : new_cap * 2;
     }
+    stats_counts.str_grows++;
+    stats_counts.str_copied += s->data ? s->len + 1 : 0;
     s->data = realloc(s->data, new_cap);
     if (!s->data) {
         fprintf(stderr, "mux: out of memory\n");
@@ -32,6 +36,7 @@ Str str_new(void) {
 
 Str str_with_capacity(size_t cap) {
     Str s = {0};
+    stats_counts.str_grows++;
     s.data = malloc(cap + 1);
     if (!s.data) {
         fprintf(stderr, "mux: out of memory\n");
@@ -91,6 +96,21 @@ void str_append_char(Str *s, char c) {
     s->data[s->len] = '\0';
 }
 
+void str_append_json(Str *s, const char *text) {
+    str_append_char(s, '"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            str_append_char(s, '\\');
+            str_append_char(s, (char)*c);
+        } else if (*c < 0x20) {
+            str_appendf(s, "\\u%04x", *c);
+        } else {
+            str_append_char(s, (char)*c);
+        }
+    }
+    str_append_char(s, '"');
+}
+
 void str_clear(Str *s) {
     s->len = 0;
     if (s->data) {
@@ -16,6 +16,8 @@ void str_append(Str *s, const char *text);
 void str_appendn(Str *s, const char *text, size_t n);
 void str_appendf(Str *s, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 void str_append_char(Str *s, char c);
+/* Append text as a quoted JSON string. */
+void str_append_json(Str *s, const char *text);
 void str_clear(Str *s);
 const char *str_cstr(const Str *s);
 
@@ -0,0 +1,306 @@
+#include "trace.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "stats.h"
+
+#define TRACE_MAX_PHASES 64
+#define TRACE_MAX_DEPTH 16
+#define TRACE_MAX_THREADS 256
+#define TRACE_COMMAND_MAX 512
+
+/* The line the script writes before anything else, to time bash startup */
+#define TRACE_SCRIPT_START "mux-script-start"
+
+typedef struct {
+    const char *name;
+    long long start; /* microseconds since trace_start() */
+    long long end;   /* -1 while open */
+} TracePhase;
+
+static struct {
+    bool on;
+    long long mono0; /* CLOCK_MONOTONIC at trace_start(), in microseconds */
+    long long real0; /* CLOCK_REALTIME at the same moment, for the script's spans */
+    TracePhase phases[TRACE_MAX_PHASES];
+    int count;
+    int open[TRACE_MAX_DEPTH];
+    int depth;
+} trace;
+
+static long long clock_us(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static long long trace_now(void) {
+    return clock_us(CLOCK_MONOTONIC) - trace.mono0;
+}
+
+void trace_start(void) {
+    trace.on = true;
+    trace.count = 0;
+    trace.depth = 0;
+    trace.mono0 = clock_us(CLOCK_MONOTONIC);
+    trace.real0 = clock_us(CLOCK_REALTIME);
+}
+
+bool trace_enabled(void) {
+    return trace.on;
+}
+
+void trace_begin(const char *name) {
+    stats_begin(name);
+    if (!trace.on) return;
+    /* Past the limits a phase is dropped, but still closed in turn */
+    if (trace.depth < TRACE_MAX_DEPTH) {
+        int i = -1;
+        if (trace.count < TRACE_MAX_PHASES) {
+            i = trace.count++;
+            trace.phases[i] = (TracePhase){name, trace_now(), -1};
+        }
+        trace.open[trace.depth] = i;
+    }
+    trace.depth++;
+}
+
+void trace_end(void) {
+    stats_end();
+    if (!trace.on || trace.depth == 0) return;
+    trace.depth--;
+    if (trace.depth < TRACE_MAX_DEPTH && trace.open[trace.depth] >= 0) {
+        trace.phases[trace.open[trace.depth]].end = trace_now();
+    }
+}
+
+static bool program_is_word(const char *program) {
+    if (!program || !program[0] || program[0] == '-') return false;
+    for (const char *c = program; *c; c++) {
+        if ((*c >= 'A' && *c <= 'Z') || (*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9')) {
+            continue;
+        }
+        if (!strchr("_./+-", *c)) return false;
+    }
+    return true;
+}
+
+void trace_append_wrappers(Str *s, const char *const *programs, int count) {
+    /* EPOCHREALTIME needs bash 5; older shells leave the times empty and
+     * their lines are skipped */
+    str_append(s, "mux_trace_run() {\n");
+    str_append(s, "  local mux_t0=${EPOCHREALTIME:-} mux_rc=0 mux_args\n");
+    str_append(s, "  command \"$@\" || mux_rc=$?\n");
+    str_append(s, "  mux_args=\"$*\"\n");
+    str_append(s, "  mux_args=${mux_args//[$'\\t\\n']/ }\n");
+    str_append(s, "  printf '%s\\t%s\\t%s\\t%s\\t%s\\n' \"$mux_t0\" \"${EPOCHREALTIME:-}\" "
+                  "\"$BASHPID\" \"$mux_rc\" \\\n");
+    str_appendf(s, "    \"${mux_args:0:%d}\" >>\"${MUX_TRACE_EVENTS:-/dev/null}\"\n",
+                TRACE_COMMAND_MAX);
+    str_append(s, "  return \"$mux_rc\"\n");
+    str_append(s, "}\n");
+    for (int i = 0; i < count; i++) {
+        if (!program_is_word(programs[i])) continue;
+        str_appendf(s, "%s() { mux_trace_run %s \"$@\"; }\n", programs[i], programs[i]);
+    }
+    str_append(s, "printf '%s\\t%s\\t%s\\t0\\t" TRACE_SCRIPT_START "\\n' \"${EPOCHREALTIME:-}\" "
+                  "\"${EPOCHREALTIME:-}\" \"$BASHPID\" >>\"${MUX_TRACE_EVENTS:-/dev/null}\"\n");
+}
+
+/* Parse bash's EPOCHREALTIME, seconds and six digits of microseconds with
+ * the locale's decimal separator, into microseconds. */
+static int parse_epoch(const char *s, long long *us) {
+    char *end = NULL;
+    long long sec = strtoll(s, &end, 10);
+    if (end == s || (*end != '.' && *end != ',')) return -1;
+    const char *frac = end + 1;
+    long long micro = strtoll(frac, &end, 10);
+    if (end - frac != 6) return -1;
+    *us = sec * 1000000 + micro;
+    return 0;
+}
+
+/* tmux's global options are skipped; Herdr commands are a noun and a verb. */
+void trace_command_name(Str *out, const char *command) {
+    const char *word = command;
+    size_t len = strcspn(word, " ");
+    const char *base = word;
+    for (const char *c = word; c < word + len; c++) {
+        if (*c == '/') base = c + 1;
+    }
+    str_appendn(out, base, (size_t)(word + len - base));
+    int words = strstr(base, "herdr") == base ? 2 : 1;
+
+    bool skip_value = false;
+    for (word += len; *word && words > 0; word += len) {
+        word += strspn(word, " ");
+        len = strcspn(word, " ");
+        if (len == 0) break;
+        if (skip_value) {
+            skip_value = false;
+        } else if (word[0] == '-') {
+            skip_value = len == 2 && strchr("LSfcT", word[1]);
+        } else {
+            str_append_char(out, ' ');
+            str_appendn(out, word, len);
+            words--;
+        }
+    }
+}
+
+static void append_event(Str *out, const char *name, const char *cat, long long ts,
+                         long long dur, long tid) {
+    str_append(out, ",\n{\"name\": ");
+    str_append_json(out, name);
+    str_appendf(out, ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, "
+                     "\"pid\": %ld, \"tid\": %ld",
+                cat, ts, dur < 0 ? 0 : dur, (long)getpid(), tid);
+}
+
+static void append_thread_name(Str *out, long tid, const char *name) {
+    str_appendf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %ld, "
+                     "\"tid\": %ld, \"args\": {\"name\": \"%s\"}}",
+                (long)getpid(), tid, name);
+}
+
+/* Start of the innermost phase open at ts, or ts */
+static long long phase_start_at(long long ts) {
+    const TracePhase *inner = NULL;
+    for (int i = 0; i < trace.count; i++) {
+        const TracePhase *ph = &trace.phases[i];
+        if (ph->start <= ts && (ph->end < 0 || ph->end >= ts) &&
+            (!inner || ph->start >= inner->start)) {
+            inner = ph;
+        }
+    }
+    return inner ? inner->start : ts;
+}
+
+int trace_read_commands(Arena *a, const char *events_path, TraceCommand **commands,
+                        int *skipped) {
+    *commands = NULL;
+    *skipped = 0;
+    FILE *f = events_path ? fopen(events_path, "r") : NULL;
+    if (!f) return 0;
+
+    int count = 0, cap = 0;
+    /* The script cuts commands to TRACE_COMMAND_MAX characters, not bytes */
+    char line[TRACE_COMMAND_MAX * 4 + 128];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *fields[5];
+        char *rest = line;
+        int n = 0;
+        for (; n < 4; n++) {
+            fields[n] = rest;
+            rest = strchr(rest, '\t');
+            if (!rest) break;
+            *rest++ = '\0';
+        }
+        if (n < 4) continue;
+        fields[4] = rest;
+
+        TraceCommand c;
+        if (parse_epoch(fields[0], &c.start) != 0 || parse_epoch(fields[1], &c.end) != 0) {
+            (*skipped)++;
+            continue;
+        }
+        c.tid = strtol(fields[2], NULL, 10);
+        c.status = atoi(fields[3]);
+        c.command = strcmp(fields[4], TRACE_SCRIPT_START) == 0 ? NULL : arena_strdup(a, fields[4]);
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            TraceCommand *grown = arena_alloc(a, sizeof(TraceCommand) * (size_t)cap);
+            if (count > 0) memcpy(grown, *commands, sizeof(TraceCommand) * (size_t)count);
+            *commands = grown;
+        }
+        (*commands)[count++] = c;
+    }
+    fclose(f);
+    return count;
+}
+
+static void append_commands(Str *out, const char *events_path) {
+    Arena a = arena_new();
+    TraceCommand *commands;
+    int skipped;
+    int count = trace_read_commands(&a, events_path, &commands, &skipped);
+
+    long threads[TRACE_MAX_THREADS];
+    int thread_count = 0;
+    Str name = str_new();
+    for (int i = 0; i < count; i++) {
+        const TraceCommand *c = &commands[i];
+        long long start = c->start - trace.real0;
+        int seen = 0;
+        while (seen < thread_count && threads[seen] != c->tid) seen++;
+        if (seen == thread_count && thread_count < TRACE_MAX_THREADS) {
+            threads[thread_count++] = c->tid;
+            /* The script writes first; command substitutions and
+             * background jobs run in subshells of it */
+            char label[32] = "script";
+            if (thread_count > 1) snprintf(label, sizeof(label), "subshell %ld", c->tid);
+            append_thread_name(out, c->tid, label);
+        }
+
+        if (!c->command) {
+            long long from = phase_start_at(start);
+            append_event(out, "bash startup", "bash", from, start - from, c->tid);
+            str_append(out, "}");
+            continue;
+        }
+        str_clear(&name);
+        trace_command_name(&name, c->command);
+        append_event(out, str_cstr(&name), "command", start, c->end - c->start, c->tid);
+        str_append(out, ", \"args\": {\"command\": ");
+        str_append_json(out, c->command);
+        str_appendf(out, ", \"status\": %d}}", c->status);
+    }
+    str_free(&name);
+    arena_free(&a);
+    if (skipped > 0) {
+        fprintf(stderr, "mux: %d command spans had no times; tracing commands needs bash 5\n",
+                skipped);
+    }
+}
+
+void trace_format_json(Str *out, const char *events_path) {
+    long pid = (long)getpid();
+    long long now = trace_now();
+    str_appendf(out, "{\"traceEvents\": [\n{\"name\": \"process_name\", \"ph\": \"M\", "
+                     "\"pid\": %ld, \"tid\": %ld, \"args\": {\"name\": \"mux\"}}",
+                pid, pid);
+    append_thread_name(out, pid, "mux");
+    for (int i = 0; i < trace.count; i++) {
+        const TracePhase *ph = &trace.phases[i];
+        long long end = ph->end < 0 ? now : ph->end;
+        append_event(out, ph->name, "mux", ph->start, end - ph->start, pid);
+        str_append(out, "}");
+    }
+    append_commands(out, events_path);
+    str_append(out, "\n], \"displayTimeUnit\": \"ms\"}\n");
+}
+
+int trace_write(const char *path, const char *events_path) {
+    Str out = str_new();
+    trace_format_json(&out, events_path);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "mux: cannot write trace %s: %s\n", path, strerror(errno));
+        str_free(&out);
+        return -1;
+    }
+    fputs(str_cstr(&out), f);
+    int failed = fclose(f) != 0;
+    str_free(&out);
+    if (failed) {
+        fprintf(stderr, "mux: cannot write trace %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef MUX_TRACE_H
+#define MUX_TRACE_H
+
+#include <stdbool.h>
+
+#include "arena.h"
+#include "str.h"
+
+/* Tracing for `mux start --trace FILE`: mux's own phases are timed with
+ * CLOCK_MONOTONIC, the start script records a span for every tmux or Herdr
+ * command it runs, and both are written to FILE as Chrome trace-event JSON,
+ * which Perfetto and chrome://tracing open. */
+
+/* Start recording. Until then trace_begin() and trace_end() do nothing. */
+void trace_start(void);
+
+bool trace_enabled(void);
+
+/* Open a phase named name, which must outlive the trace. Phases nest, and
+ * trace_end() closes the innermost open one. MUX_STATS counts allocations
+ * by the same phases, traced or not. */
+void trace_begin(const char *name);
+void trace_end(void);
+
+/* Append bash functions that stand in for each of programs, run it and add
+ * a line for the call to the file named by $MUX_TRACE_EVENTS. Programs that
+ * are not plain command words are left alone. */
+void trace_append_wrappers(Str *s, const char *const *programs, int count);
+
+/* A command the wrapped script ran, as read back from $MUX_TRACE_EVENTS. */
+typedef struct {
+    long long start; /* microseconds since the Unix epoch */
+    long long end;
+    long tid;      /* $BASHPID of the shell that ran it */
+    int status;    /* exit status */
+    char *command; /* the command line, or NULL for the line the script writes as it starts */
+} TraceCommand;
+
+/* Read the commands a wrapped script wrote to events_path. Lines without
+ * times, which bash before 5 writes, are counted in *skipped. Returns the
+ * number of commands. */
+int trace_read_commands(Arena *a, const char *events_path, TraceCommand **commands,
+                        int *skipped);
+
+/* Append a command's span name: the program's base name and subcommand,
+ * such as "tmux splitw". */
+void trace_command_name(Str *out, const char *command);
+
+/* Append the trace as JSON: the phases, then the command spans read from
+ * events_path, which may be NULL. */
+void trace_format_json(Str *out, const char *events_path);
+
+/* Write the trace to path. Returns 0, or -1 after reporting the error. */
+int trace_write(const char *path, const char *events_path);
+
+#endif
@@ -0,0 +1,386 @@
+#include "wait.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <poll.h>
+#include <regex.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "arena.h"
+#include "shell.h"
+#include "str.h"
+
+#define WAIT_RETRY_MS 50
+#define WAIT_CONNECT_MS 1000
+#define WAIT_LINE_MAX 65536
+
+long long wait_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Clamp the time left before deadline to a poll() timeout. */
+static int remaining_ms(long long deadline, long long cap) {
+    long long left = deadline - wait_now_ms();
+    if (left < 0) return 0;
+    if (cap > 0 && left > cap) return (int)cap;
+    return left > INT_MAX ? INT_MAX : (int)left;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+/* Attempt one non-blocking connect, giving up at the deadline. */
+static int try_connect(const struct addrinfo *ai, long long deadline) {
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) return -1;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+    if (rc != 0 && errno == EINPROGRESS) {
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        rc = -1;
+        if (poll(&pfd, 1, remaining_ms(deadline, WAIT_CONNECT_MS)) == 1) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) rc = 0;
+        }
+    }
+    close(fd);
+    return rc == 0 ? 0 : -1;
+}
+
+int wait_tcp(const char *address, long long deadline) {
+    char host[256] = "localhost";
+    const char *port = address;
+    const char *colon = strrchr(address, ':');
+    if (colon) {
+        size_t len = (size_t)(colon - address);
+        if (len >= 2 && address[0] == '[' && address[len - 1] == ']') {
+            address++;
+            len -= 2;
+        }
+        if (len >= sizeof(host)) return -1;
+        if (len > 0) {
+            memcpy(host, address, len);
+            host[len] = '\0';
+        }
+        port = colon + 1;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    for (;;) {
+        struct addrinfo *res = NULL;
+        if (getaddrinfo(host, port, &hints, &res) == 0) {
+            for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+                if (try_connect(ai, deadline) == 0) {
+                    freeaddrinfo(res);
+                    return 0;
+                }
+            }
+            freeaddrinfo(res);
+        }
+        int left = remaining_ms(deadline, WAIT_RETRY_MS);
+        if (left <= 0) return -1;
+        sleep_ms(left);
+    }
+}
+
+#ifdef __linux__
+/* Watch the deepest existing directory on the way to path, so that creating
+ * any missing parent wakes the waiter up. */
+static void watch_nearest_dir(int fd, const char *path) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (;;) {
+        char *slash = strrchr(dir, '/');
+        if (!slash) {
+            snprintf(dir, sizeof(dir), ".");
+        } else if (slash == dir) {
+            dir[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+        if (access(dir, F_OK) == 0 || strcmp(dir, ".") == 0 || strcmp(dir, "/") == 0) break;
+    }
+    inotify_add_watch(fd, dir, IN_CREATE | IN_MOVED_TO | IN_ATTRIB);
+}
+#endif
+
+int wait_file(const char *path, long long deadline) {
+    int fd = -1;
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    for (;;) {
+        if (access(path, F_OK) == 0) break;
+        int left = remaining_ms(deadline, 0);
+        if (left <= 0) {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+#ifdef __linux__
+        if (fd >= 0) {
+            watch_nearest_dir(fd, path);
+            if (access(path, F_OK) == 0) break; /* created before the watch */
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, left) > 0) {
+                char events[4096];
+                while (read(fd, events, sizeof(events)) > 0) {
+                }
+            }
+            continue;
+        }
+#endif
+        sleep_ms(left < WAIT_RETRY_MS ? left : WAIT_RETRY_MS);
+    }
+    if (fd >= 0) close(fd);
+    return 0;
+}
+
+int wait_signal(const char *tmux, const char *channel, long long deadline) {
+    /* tmux latches a signal nobody waits for only until one waiter takes it */
+    Str script = str_new();
+    str_appendf(&script, "%s wait-for \"$1\" && %s wait-for -S \"$1\"", tmux, tmux);
+    int done[2];
+    if (pipe(done) != 0) {
+        str_free(&script);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        close(done[0]);
+        execl("/bin/sh", "sh", "-c", str_cstr(&script), "sh", channel, (char *)NULL);
+        _exit(127);
+    }
+    str_free(&script);
+    close(done[1]);
+    if (pid < 0) {
+        close(done[0]);
+        return -1;
+    }
+
+    /* The pipe closes once the waiter and its tmux client have exited */
+    for (;;) {
+        int left = remaining_ms(deadline, 0);
+        struct pollfd pfd = {done[0], POLLIN, 0};
+        int rc = left > 0 ? poll(&pfd, 1, left) : 0;
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) {
+            kill(-pid, SIGTERM);
+            kill(pid, SIGTERM);
+        }
+        break;
+    }
+    close(done[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+typedef enum { OUT_TEXT, OUT_ESC, OUT_CSI, OUT_OSC } OutputState;
+
+/* True when line shows the pane echoing cmd as it was typed. An unfinished
+ * line may end with just the start of the command. */
+static bool echoes_command(const char *line, size_t len, const char *cmd, bool partial) {
+    size_t cmd_len = strlen(cmd);
+    for (size_t i = 0; cmd_len > 0 && i < len; i++) {
+        size_t n = len - i < cmd_len ? len - i : cmd_len;
+        if (memcmp(line + i, cmd, n) == 0 && (n == cmd_len || partial)) return true;
+    }
+    return false;
+}
+
+/* Test the current line against every pattern that has not matched yet.
+ * Returns the number of patterns still pending. */
+static int match_line(const Str *line, const OutputWatch *watch, regex_t *res, bool *matched,
+                      bool partial) {
+    for (int i = 0; i < watch->ignore_count; i++) {
+        if (echoes_command(line->data, line->len, watch->ignore[i], partial)) return -1;
+    }
+
+    int pending = 0;
+    for (int i = 0; i < watch->count; i++) {
+        if (!matched[i] && regexec(&res[i], str_cstr(line), 0, NULL, 0) == 0) {
+            matched[i] = true;
+            int mfd = open(watch->marks[i], O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+            if (mfd >= 0) close(mfd);
+        }
+        if (!matched[i]) pending++;
+    }
+    return pending;
+}
+
+int wait_output(int fd, const OutputWatch *watch, long long deadline) {
+    int count = watch->count;
+    regex_t *res = calloc((size_t)count, sizeof(regex_t));
+    bool *matched = calloc((size_t)count, sizeof(bool));
+    int compiled = 0;
+    for (; compiled < count; compiled++) {
+        if (regcomp(&res[compiled], watch->patterns[compiled], REG_EXTENDED | REG_NOSUB) != 0) {
+            fprintf(stderr, "mux: wait-for: invalid output pattern '%s'\n",
+                    watch->patterns[compiled]);
+            break;
+        }
+    }
+
+    Str line = str_new();
+    OutputState state = OUT_TEXT;
+    int pending = compiled == count ? count : -1;
+    while (pending > 0) {
+        int left = remaining_ms(deadline, 0);
+        if (left <= 0) break;
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int rc = poll(&pfd, 1, left);
+        if (rc < 0 && errno != EINTR) break;
+        if (rc <= 0) continue;
+
+        char buf[4096];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) break; /* pane closed */
+
+        for (ssize_t i = 0; i < n && pending > 0; i++) {
+            char c = buf[i];
+            switch (state) {
+            case OUT_ESC:
+                state = c == '[' ? OUT_CSI : c == ']' ? OUT_OSC : OUT_TEXT;
+                continue;
+            case OUT_CSI:
+                if (c >= 0x40 && c <= 0x7e) state = OUT_TEXT;
+                continue;
+            case OUT_OSC:
+                if (c == '\a') state = OUT_TEXT;
+                if (c == '\033') state = OUT_ESC;
+                continue;
+            case OUT_TEXT:
+                break;
+            }
+            if (c == '\033') {
+                state = OUT_ESC;
+            } else if (c == '\n') {
+                int left_after = match_line(&line, watch, res, matched, false);
+                if (left_after >= 0) pending = left_after;
+                str_clear(&line);
+            } else if (c != '\r' && c != '\0') {
+                if (line.len >= WAIT_LINE_MAX) str_clear(&line);
+                str_append_char(&line, c);
+            }
+        }
+        /* Prompts such as "ready> " never end their line */
+        if (pending > 0 && line.len > 0) {
+            int left_after = match_line(&line, watch, res, matched, true);
+            if (left_after >= 0) pending = left_after;
+        }
+    }
+
+    str_free(&line);
+    for (int i = 0; i < compiled; i++) regfree(&res[i]);
+    free(res);
+    free(matched);
+    return pending == 0 ? 0 : -1;
+}
+
+static const char *const WAIT_USAGE =
+    "usage: mux wait-for [--timeout SECONDS] (--tcp [HOST:]PORT | --file PATH |\n"
+    "                    --signal CHANNEL | --output REGEX --mark PATH)...\n"
+    "                    [--ignore COMMAND]...\n";
+
+int wait_command(int argc, char **argv) {
+    Arena arena = arena_new();
+    OutputWatch watch = {
+        .patterns = arena_alloc(&arena, sizeof(char *) * (size_t)(argc + 1)),
+        .marks = arena_alloc(&arena, sizeof(char *) * (size_t)(argc + 1)),
+        .ignore = arena_alloc(&arena, sizeof(char *) * (size_t)(argc + 1)),
+    };
+    long long start = wait_now_ms();
+    long long deadline = start + 60 * 1000;
+    long long output_deadline = start;
+    int status = 0;
+
+    /* Conditions are checked in order; each keeps the deadline in force when
+     * it was given, so the slowest one bounds the whole wait. */
+    for (int i = 0; i < argc && status == 0; i++) {
+        const char *opt = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!val) {
+            status = 2;
+            break;
+        }
+        i++;
+        if (strcmp(opt, "--timeout") == 0) {
+            char *end = NULL;
+            long seconds = strtol(val, &end, 10);
+            if (*end != '\0' || seconds <= 0) {
+                status = 2;
+                break;
+            }
+            deadline = start + seconds * 1000;
+        } else if (strcmp(opt, "--tcp") == 0) {
+            if (wait_tcp(val, deadline) != 0) {
+                fprintf(stderr, "mux: wait-for: tcp %s not ready\n", val);
+                status = 1;
+            }
+        } else if (strcmp(opt, "--file") == 0) {
+            if (wait_file(path_expand(&arena, val), deadline) != 0) {
+                fprintf(stderr, "mux: wait-for: file %s not found\n", val);
+                status = 1;
+            }
+        } else if (strcmp(opt, "--signal") == 0) {
+            const char *tmux = getenv("MUX_TMUX");
+            if (wait_signal(tmux && tmux[0] ? tmux : "tmux", val, deadline) != 0) {
+                fprintf(stderr, "mux: wait-for: signal %s not sent\n", val);
+                status = 1;
+            }
+        } else if (strcmp(opt, "--output") == 0) {
+            watch.patterns[watch.count] = val;
+            watch.marks[watch.count] = NULL;
+            if (deadline > output_deadline) output_deadline = deadline;
+            watch.count++;
+        } else if (strcmp(opt, "--mark") == 0 && watch.count > 0) {
+            watch.marks[watch.count - 1] = path_expand(&arena, val);
+        } else if (strcmp(opt, "--ignore") == 0) {
+            watch.ignore[watch.ignore_count++] = val;
+        } else {
+            status = 2;
+        }
+    }
+    for (int i = 0; status == 0 && i < watch.count; i++) {
+        if (!watch.marks[i]) status = 2;
+    }
+
+    if (status == 2) {
+        fputs(WAIT_USAGE, stderr);
+    } else if (status == 0 && watch.count > 0 &&
+               wait_output(STDIN_FILENO, &watch, output_deadline) != 0) {
+        status = 1;
+    }
+
+    arena_free(&arena);
+    return status;
+}
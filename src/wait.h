@@ -0,0 +1,42 @@
+#ifndef MUX_WAIT_H
+#define MUX_WAIT_H
+
+/* Readiness gates behind the hidden `mux wait-for` command used by generated
+ * scripts. Each wait returns 0 once its condition holds and -1 when the
+ * deadline, a wait_now_ms() timestamp, passes first. */
+
+/* Milliseconds on a monotonic clock. */
+long long wait_now_ms(void);
+
+/* Wait until [host:]port accepts a TCP connection. A bare port means localhost. */
+int wait_tcp(const char *address, long long deadline);
+
+/* Wait until path exists. Uses inotify on Linux and stat polling elsewhere. */
+int wait_file(const char *path, long long deadline);
+
+/* Wait until a tmux wait-for channel is signalled, then signal it again so
+ * that every later waiter passes too. tmux is the shell command that runs
+ * tmux on the project's server, such as "tmux -L work". */
+int wait_signal(const char *tmux, const char *channel, long long deadline);
+
+typedef struct {
+    const char **patterns; /* POSIX extended regexes */
+    const char **marks;    /* created as soon as the matching pattern matches */
+    int count;
+    const char **ignore; /* commands typed into the pane, whose echo never matches */
+    int ignore_count;
+} OutputWatch;
+
+/* Read pane output from fd until every pattern has matched a line, creating
+ * its mark file as it does. Terminal escape sequences are stripped before
+ * matching. */
+int wait_output(int fd, const OutputWatch *watch, long long deadline);
+
+/* Entry point for `mux wait-for [--timeout SECONDS] (--tcp ADDR | --file PATH |
+ * --signal CHANNEL | --output REGEX --mark PATH)... [--ignore COMMAND]...`.
+ * Each --timeout applies to the conditions after it. Signals go through the
+ * tmux command in $MUX_TMUX, or plain tmux. Returns a process exit status:
+ * 0 ready, 1 timed out, 2 usage. */
+int wait_command(int argc, char **argv);
+
+#endif
@@ -0,0 +1,153 @@
+#include "arena.h"
+#include "bench.h"
+#include "config.h"
+#include "greatest.h"
+#include "project.h"
+#include "str.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *BENCH_CONFIG = "name: benched\n"
+                                  "pre_window: nvm use\n"
+                                  "on_project_start: ./seed\n"
+                                  "windows:\n"
+                                  "  - editor:\n"
+                                  "      panes:\n"
+                                  "        - vim\n"
+                                  "        - web:\n"
+                                  "            - make watch\n"
+                                  "          ready:\n"
+                                  "            output: listening\n"
+                                  "  - logs: tail -f log\n";
+
+static char tmpdir[64];
+
+static void make_tmpdir(void) {
+    snprintf(tmpdir, sizeof(tmpdir), "/tmp/mux-bench-test-XXXXXX");
+    if (!mkdtemp(tmpdir)) tmpdir[0] = '\0';
+}
+
+static void remove_tmpdir(void) {
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmpdir);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", tmpdir);
+}
+
+TEST test_bench_prepare(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, config_parse_string(&a, BENCH_CONFIG, strlen(BENCH_CONFIG), &p, NULL, 0));
+    char socket[] = "mux-bench-1";
+    bench_prepare(&p, socket, false);
+    ASSERT_STR_EQ("mux-bench-1", p.socket_name);
+    ASSERT_FALSE(p.attach);
+    ASSERT_STR_EQ("nvm use", p.pre_window);
+    ASSERT_EQ(1, p.windows[0].panes[1].ready_count);
+
+    bench_prepare(&p, socket, true);
+    ASSERT_EQ(NULL, p.pre_window);
+    ASSERT_EQ(NULL, p.on_project_start);
+    ASSERT_EQ(0, p.windows[0].panes[0].command_count);
+    ASSERT_EQ(0, p.windows[0].panes[1].ready_count);
+    ASSERT_EQ(2, p.windows[0].pane_count);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_bench_percentile(void) {
+    double values[] = {9, 1, 5, 3, 7, 2, 8, 4, 10, 6};
+    ASSERT_EQ(5.0, bench_percentile(values, 10, 0.5));
+    ASSERT_EQ(9.0, bench_percentile(values, 10, 0.9));
+    ASSERT_EQ(10.0, bench_percentile(values, 10, 0.99));
+    ASSERT_EQ(1.0, bench_percentile(values, 10, 0.0));
+    ASSERT_EQ(10.0, bench_percentile(values, 10, 1.0));
+    /* Left unsorted */
+    ASSERT_EQ(9.0, values[0]);
+    ASSERT_EQ(4.0, bench_percentile(values + 7, 1, 0.5));
+    PASS();
+}
+
+TEST test_bench_format(void) {
+    Project p;
+    project_init(&p);
+    p.name = "benched";
+    double session[] = {10, 20, 30}, panes[] = {40, 50, 60}, stop[] = {5, 6, 7};
+    BenchResult r = {.runs = 3, .socket = "mux-bench-1", .stubbed = true};
+    r.ms[BENCH_SESSION] = session;
+    r.ms[BENCH_PANES] = panes;
+    r.ms[BENCH_STOP] = stop;
+
+    Str out = str_new();
+    bench_format_table(&r, &p, &out);
+    const char *table = str_cstr(&out);
+    ASSERT(strstr(table, "Bench of benched: 3 runs on tmux -L mux-bench-1, pane commands "
+                         "stubbed\n") != NULL);
+    ASSERT(strstr(table, "time to all panes (ms)     50.00     60.00     60.00     40.00     "
+                         "60.00\n") != NULL);
+
+    str_clear(&out);
+    bench_format_json(&r, &p, &out);
+    ASSERT(strstr(str_cstr(&out), "\"stop_ms\": {\"p50\": 6.000, \"p90\": 7.000, \"p99\": 7.000, "
+                                  "\"min\": 5.000, \"max\": 7.000, \"samples\": [5.000, 6.000, "
+                                  "7.000]}}\n") != NULL);
+    str_free(&out);
+    PASS();
+}
+
+TEST test_bench_run_times_each_start(void) {
+    make_tmpdir();
+    /* A stand-in tmux: no session exists yet, and every command works */
+    char tmux[128];
+    snprintf(tmux, sizeof(tmux), "%s/tmux", tmpdir);
+    FILE *f = fopen(tmux, "w");
+    ASSERT(f != NULL);
+    fputs("#!/bin/sh\n"
+          "for arg; do\n"
+          "  case $arg in\n"
+          "    has-session) exit 1 ;;\n"
+          "    show-option) echo 0; exit 0 ;;\n"
+          "  esac\n"
+          "done\n",
+          f);
+    fclose(f);
+    ASSERT_EQ(0, chmod(tmux, 0755));
+
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, config_parse_string(&a, BENCH_CONFIG, strlen(BENCH_CONFIG), &p, NULL, 0));
+    p.tmux_command = tmux;
+    char socket[] = "mux-bench-test";
+    bench_prepare(&p, socket, true);
+    BenchResult r = {0};
+    ASSERT_EQ(0, bench_run(&a, &p, 3, &r));
+    ASSERT_EQ(3, r.runs);
+    ASSERT_STR_EQ("mux-bench-test", r.socket);
+    for (int i = 0; i < r.runs; i++) {
+        ASSERT(r.ms[BENCH_SESSION][i] > 0);
+        ASSERT(r.ms[BENCH_PANES][i] >= r.ms[BENCH_SESSION][i]);
+        ASSERT(r.ms[BENCH_STOP][i] > 0);
+    }
+    ASSERT_EQ(NULL, getenv("MUX_TRACE_EVENTS"));
+    arena_free(&a);
+    remove_tmpdir();
+    PASS();
+}
+
+SUITE(bench_suite) {
+    RUN_TEST(test_bench_prepare);
+    RUN_TEST(test_bench_percentile);
+    RUN_TEST(test_bench_format);
+    RUN_TEST(test_bench_run_times_each_start);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(bench_suite);
+    GREATEST_MAIN_END();
+}
@@ -1,7 +1,11 @@
 #include "cli.h"
 #include "greatest.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 TEST test_cli_no_args(void) {
     char *argv[] = {"mux"};
@@ -80,6 +84,82 @@ TEST test_cli_stop(void) {
     PASS();
 }
 
+TEST test_cli_prewarm(void) {
+    char *argv[] = {"mux", "prewarm", "work"};
+    CliArgs args;
+    cli_parse(3, argv, &args);
+    ASSERT_EQ(CMD_PREWARM, args.command);
+    ASSERT_STR_EQ("work", args.project_name);
+    PASS();
+}
+
+TEST test_cli_layout_save(void) {
+    char *argv[] = {"mux", "layout", "save", "work"};
+    CliArgs args;
+    ASSERT_EQ(0, cli_parse(4, argv, &args));
+    ASSERT_EQ(CMD_LAYOUT, args.command);
+    ASSERT_STR_EQ("save", args.layout_action);
+    ASSERT_STR_EQ("work", args.project_name);
+
+    char *config[] = {"mux", "layout", "save", "-p", "work.yml"};
+    ASSERT_EQ(0, cli_parse(5, config, &args));
+    ASSERT_STR_EQ("save", args.layout_action);
+    ASSERT_STR_EQ("work.yml", args.project_config);
+    PASS();
+}
+
+TEST test_cli_plan_cost(void) {
+    char *argv[] = {"mux", "plan", "--cost", "--json", "--calibrate", "tmux=1.5", "work"};
+    CliArgs args;
+    ASSERT_EQ(0, cli_parse(7, argv, &args));
+    ASSERT_EQ(CMD_PLAN, args.command);
+    ASSERT(args.cost);
+    ASSERT(args.json);
+    ASSERT_STR_EQ("tmux=1.5", args.calibrate);
+    ASSERT_STR_EQ("work", args.project_name);
+    PASS();
+}
+
+TEST test_cli_trace(void) {
+    char *argv[] = {"mux", "start", "--trace", "start.json", "work"};
+    CliArgs args;
+    ASSERT_EQ(0, cli_parse(5, argv, &args));
+    ASSERT_EQ(CMD_START, args.command);
+    ASSERT_STR_EQ("start.json", args.trace);
+    ASSERT_STR_EQ("work", args.project_name);
+    PASS();
+}
+
+TEST test_cli_bench(void) {
+    char *argv[] = {"mux", "bench", "--runs", "25", "--stub", "work"};
+    CliArgs args;
+    ASSERT_EQ(0, cli_parse(6, argv, &args));
+    ASSERT_EQ(CMD_BENCH, args.command);
+    ASSERT_EQ(25, args.runs);
+    ASSERT(args.stub);
+    ASSERT_STR_EQ("work", args.project_name);
+
+    char *bad[] = {"mux", "bench", "--runs", "0", "work"};
+    ASSERT_EQ(-1, cli_parse(5, bad, &args));
+    PASS();
+}
+
+TEST test_cli_jobs(void) {
+    char *argv[] = {"mux", "start", "--jobs", "8", "work"};
+    CliArgs args;
+    ASSERT_EQ(0, cli_parse(5, argv, &args));
+    ASSERT_EQ(8, args.jobs);
+    ASSERT_STR_EQ("work", args.project_name);
+
+    char *none[] = {"mux", "start", "work"};
+    ASSERT_EQ(0, cli_parse(3, none, &args));
+    ASSERT_EQ(0, args.jobs);
+
+    char *bad[] = {"mux", "start", "-j", "0", "work"};
+    ASSERT_EQ(-1, cli_parse(5, bad, &args));
+    PASS();
+}
+
 TEST test_cli_debug(void) {
     char *argv[] = {"mux", "debug", "work"};
     CliArgs args;
@@ -240,6 +320,136 @@ TEST test_cli_backend_flag(void) {
     PASS();
 }
 
+TEST test_cli_wait_for_keeps_raw_arguments(void) {
+    char *argv[] = {"mux", "wait-for", "--timeout", "5", "--tcp", "5432"};
+    CliArgs args;
+    cli_parse(6, argv, &args);
+    ASSERT_EQ(CMD_WAIT_FOR, args.command);
+    ASSERT_EQ(4, args.setting_count);
+    ASSERT_STR_EQ("--timeout", args.settings[0]);
+    ASSERT_STR_EQ("5432", args.settings[3]);
+    ASSERT_EQ(NULL, args.project_name);
+    PASS();
+}
+
+TEST test_cli_priority_keeps_raw_arguments(void) {
+    char *argv[] = {"mux", "priority", "--nice", "-5", "4242"};
+    CliArgs args;
+    cli_parse(5, argv, &args);
+    ASSERT_EQ(CMD_PRIORITY, args.command);
+    ASSERT_EQ(3, args.setting_count);
+    ASSERT_STR_EQ("-5", args.settings[1]);
+    ASSERT_STR_EQ("4242", args.settings[2]);
+    PASS();
+}
+
+/* mux local runs against a stand-in tmux that logs each call's arguments:
+ * no session exists yet, options read as 0 and every command works. */
+static const char *LOCAL_CONFIG = "name: here\n"
+                                  "windows:\n"
+                                  "  - editor: {panes: [vim, guard]}\n"
+                                  "  - logs: tail -f log\n"
+                                  "  - shell: bash\n";
+
+static char local_dir[64];
+
+static int write_file(const char *path, const char *content, mode_t mode) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fputs(content, f);
+    fclose(f);
+    return chmod(path, mode);
+}
+
+/* Run mux local with flags in a directory holding LOCAL_CONFIG, and return
+ * the tmux calls it made, or NULL */
+static char *run_local(const char *mux, const char *flags) {
+    char path[128], cmd[1024];
+    snprintf(path, sizeof(path), "%s/tmux.log", local_dir);
+    if (write_file(path, "", 0644) != 0) return NULL;
+    snprintf(cmd, sizeof(cmd),
+             "cd '%s' && env -u TMUX -u TMUX_PANE -u MUX_BACKEND PATH='%s/bin':\"$PATH\" "
+             "HOME='%s' XDG_STATE_HOME='%s/state' '%s' local %s > /dev/null 2>&1",
+             local_dir, local_dir, local_dir, local_dir, mux, flags);
+    if (system(cmd) != 0) return NULL;
+
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    static char log[65536];
+    size_t n = fread(log, 1, sizeof(log) - 1, f);
+    fclose(f);
+    log[n] = '\0';
+    return log;
+}
+
+TEST test_cli_local_builds_windows_in_parallel(const char *mux) {
+    char *log = run_local(mux, "");
+    ASSERT(log != NULL);
+    ASSERT(strstr(log, "new-window -t here -n logs") != NULL);
+    ASSERT(strstr(log, "new-window -d") == NULL);
+
+    /* --jobs builds the windows after the first at their own indexes */
+    log = run_local(mux, "--jobs 2");
+    ASSERT(log != NULL);
+    ASSERT(strstr(log, "new-window -d -t here:1 -n logs") != NULL);
+    ASSERT(strstr(log, "new-window -d -t here:2 -n shell") != NULL);
+    PASS();
+}
+
+TEST test_cli_local_applies_saved_layouts(const char *mux) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/state/mux/layouts", local_dir);
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "mkdir -p '%s'", path);
+    ASSERT_EQ(0, system(cmd));
+    snprintf(path, sizeof(path), "%s/state/mux/layouts/here", local_dir);
+    ASSERT_EQ(0, write_file(path, "2 b25d,80x24,0,0{20x24,0,0,1,59x24,21,0,2} editor\n", 0644));
+
+    char *log = run_local(mux, "");
+    unlink(path);
+    ASSERT(log != NULL);
+    ASSERT(strstr(log, "select-layout -t here:editor b25d,80x24,0,0{20x24,0,0,1,59x24,21,0,2}\n") !=
+           NULL);
+    PASS();
+}
+
+SUITE(cli_local_suite) {
+    /* Meson points MUX_BIN at the mux it built */
+    const char *mux = getenv("MUX_BIN");
+    if (!mux || !mux[0] || access(mux, X_OK) != 0) {
+        fprintf(stderr, "MUX_BIN is not set to a mux binary; skipping mux local\n");
+        return;
+    }
+    snprintf(local_dir, sizeof(local_dir), "/tmp/mux-local-test-XXXXXX");
+    char path[128];
+    int ready = mkdtemp(local_dir) != NULL;
+    snprintf(path, sizeof(path), "%s/bin", local_dir);
+    ready = ready && mkdir(path, 0755) == 0;
+    snprintf(path, sizeof(path), "%s/bin/tmux", local_dir);
+    ready = ready && write_file(path,
+                                "#!/bin/sh\n"
+                                "echo \"$*\" >> ./tmux.log\n"
+                                "for arg; do\n"
+                                "  case $arg in\n"
+                                "    has-session) exit 1 ;;\n"
+                                "    show-option) echo 0; exit 0 ;;\n"
+                                "  esac\n"
+                                "done\n",
+                                0755) == 0;
+    snprintf(path, sizeof(path), "%s/.tmuxinator.yml", local_dir);
+    ready = ready && write_file(path, LOCAL_CONFIG, 0644) == 0;
+    if (!ready) {
+        fprintf(stderr, "could not set up %s\n", local_dir);
+        exit(1);
+    }
+    RUN_TESTp(test_cli_local_builds_windows_in_parallel, mux);
+    RUN_TESTp(test_cli_local_applies_saved_layouts, mux);
+
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", local_dir);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", local_dir);
+}
+
 SUITE(cli_suite) {
     RUN_TEST(test_cli_no_args);
     RUN_TEST(test_cli_version);
@@ -250,6 +460,12 @@ SUITE(cli_suite) {
     RUN_TEST(test_cli_start_shortcut);
     RUN_TEST(test_cli_implicit_start);
     RUN_TEST(test_cli_stop);
+    RUN_TEST(test_cli_prewarm);
+    RUN_TEST(test_cli_layout_save);
+    RUN_TEST(test_cli_plan_cost);
+    RUN_TEST(test_cli_trace);
+    RUN_TEST(test_cli_bench);
+    RUN_TEST(test_cli_jobs);
     RUN_TEST(test_cli_debug);
     RUN_TEST(test_cli_new);
     RUN_TEST(test_cli_edit);
@@ -266,6 +482,8 @@ SUITE(cli_suite) {
     RUN_TEST(test_cli_name_override);
     RUN_TEST(test_cli_append_flag);
     RUN_TEST(test_cli_backend_flag);
+    RUN_TEST(test_cli_wait_for_keeps_raw_arguments);
+    RUN_TEST(test_cli_priority_keeps_raw_arguments);
 }
 
 GREATEST_MAIN_DEFS();
@@ -273,5 +491,6 @@ GREATEST_MAIN_DEFS();
 int main(int argc, char **argv) {
     GREATEST_MAIN_BEGIN();
     RUN_SUITE(cli_suite);
+    RUN_SUITE(cli_local_suite);
     GREATEST_MAIN_END();
 }
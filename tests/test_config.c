@@ -53,6 +53,17 @@ static const char *HOOKS_ARRAY_CONFIG = "name: hooks\n"
                                         "windows:\n"
                                         "  - main: echo hi\n";
 
+static const char *MEMO_HOOK_CONFIG = "name: memo\n"
+                                      "on_project_first_start:\n"
+                                      "  run:\n"
+                                      "    - bundle install\n"
+                                      "    - npm ci\n"
+                                      "  inputs:\n"
+                                      "    - Gemfile.lock\n"
+                                      "    - package-lock.json\n"
+                                      "windows:\n"
+                                      "  - main: echo hi\n";
+
 static const char *WINDOW_ROOT_CONFIG = "name: roots\n"
                                         "root: ~/default\n"
                                         "windows:\n"
@@ -159,6 +170,471 @@ TEST test_config_hooks_array(void) {
     PASS();
 }
 
+TEST test_config_hook_with_inputs(void) {
+    Arena a = arena_new();
+    Project p;
+    int ret = config_parse_string(&a, MEMO_HOOK_CONFIG, strlen(MEMO_HOOK_CONFIG), &p, NULL, 0);
+    ASSERT_EQ(0, ret);
+    ASSERT_STR_EQ("bundle install; npm ci", p.on_project_first_start);
+    ASSERT_EQ(2, p.hooks[HOOK_PROJECT_FIRST_START].input_count);
+    ASSERT_STR_EQ("Gemfile.lock", p.hooks[HOOK_PROJECT_FIRST_START].inputs[0]);
+    ASSERT_STR_EQ("package-lock.json", p.hooks[HOOK_PROJECT_FIRST_START].inputs[1]);
+    ASSERT_EQ(0, p.hooks[HOOK_PROJECT_START].input_count);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_hook_modes(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: modes\n"
+                       "on_project_start:\n"
+                       "  run: make deps\n"
+                       "  timeout: 2m\n"
+                       "on_project_first_start:\n"
+                       "  run: ./warm-cache\n"
+                       "  mode: background\n"
+                       "on_project_exit:\n"
+                       "  run: ./report\n"
+                       "  mode: parallel\n"
+                       "  timeout: 30\n"
+                       "windows:\n"
+                       "  - main: echo hi\n";
+    int ret = config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0);
+    ASSERT_EQ(0, ret);
+    ASSERT_STR_EQ("make deps", p.on_project_start);
+    /* A timeout without a mode implies a supervised synchronous hook */
+    ASSERT_EQ(HOOK_MODE_SYNC, p.hooks[HOOK_PROJECT_START].mode);
+    ASSERT_EQ(120, p.hooks[HOOK_PROJECT_START].timeout);
+    ASSERT_EQ(HOOK_MODE_BACKGROUND, p.hooks[HOOK_PROJECT_FIRST_START].mode);
+    ASSERT_EQ(0, p.hooks[HOOK_PROJECT_FIRST_START].timeout);
+    ASSERT_EQ(HOOK_MODE_PARALLEL, p.hooks[HOOK_PROJECT_EXIT].mode);
+    ASSERT_EQ(30, p.hooks[HOOK_PROJECT_EXIT].timeout);
+    ASSERT_EQ(HOOK_MODE_INLINE, p.hooks[HOOK_PROJECT_STOP].mode);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_hook_rejects_unknown_mode(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: modes\n"
+                       "on_project_start:\n"
+                       "  run: make deps\n"
+                       "  mode: eventually\n";
+    ASSERT_EQ(-1, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_wait_for(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: gates\n"
+                       "windows:\n"
+                       "  - db: postgres\n"
+                       "  - app:\n"
+                       "      wait_for:\n"
+                       "        - {tcp: 5432, timeout: 2m}\n"
+                       "        - {output: /ready to accept/}\n"
+                       "      panes:\n"
+                       "        - rails s\n"
+                       "        - worker:\n"
+                       "            - sidekiq\n"
+                       "          wait_for: {file: tmp/pids/server.pid, output: Listening, "
+                       "from: app.0}\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+
+    Window *app = &p.windows[1];
+    ASSERT_EQ(2, app->wait_count);
+    ASSERT_EQ(WAIT_TCP, app->waits[0].kind);
+    ASSERT_STR_EQ("5432", app->waits[0].target);
+    ASSERT_EQ(120, app->waits[0].timeout);
+    /* Slashes are stripped and the previous window is watched by default */
+    ASSERT_EQ(WAIT_OUTPUT, app->waits[1].kind);
+    ASSERT_STR_EQ("ready to accept", app->waits[1].target);
+    ASSERT_EQ(60, app->waits[1].timeout);
+    ASSERT_EQ(0, app->waits[1].source_window);
+    ASSERT_EQ(0, app->waits[1].source_pane);
+
+    /* Pane options sit alongside the pane title */
+    Pane *worker = &app->panes[1];
+    ASSERT_STR_EQ("worker", worker->title);
+    ASSERT_EQ(1, worker->command_count);
+    ASSERT_STR_EQ("sidekiq", worker->commands[0]);
+    ASSERT_EQ(2, worker->wait_count);
+    ASSERT_EQ(WAIT_FILE, worker->waits[0].kind);
+    ASSERT_EQ(WAIT_OUTPUT, worker->waits[1].kind);
+    ASSERT_EQ(1, worker->waits[1].source_window);
+    ASSERT_EQ(0, worker->waits[1].source_pane);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_wait_for_rejects_bad_gates(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *unknown = "name: gates\n"
+                          "windows:\n"
+                          "  - app:\n"
+                          "      wait_for: {http: localhost}\n";
+    const char *pattern = "name: gates\n"
+                          "windows:\n"
+                          "  - db: postgres\n"
+                          "  - app:\n"
+                          "      wait_for: {output: \"(unclosed\"}\n";
+    const char *no_source = "name: gates\n"
+                            "windows:\n"
+                            "  - app:\n"
+                            "      wait_for: {output: ready}\n";
+    const char *own_output = "name: gates\n"
+                             "windows:\n"
+                             "  - app:\n"
+                             "      panes:\n"
+                             "        - server:\n"
+                             "            - rails s\n"
+                             "          wait_for: {output: ready, from: server}\n";
+    ASSERT_EQ(-1, config_parse_string(&a, unknown, strlen(unknown), &p, NULL, 0));
+    ASSERT_EQ(-1, config_parse_string(&a, pattern, strlen(pattern), &p, NULL, 0));
+    ASSERT_EQ(-1, config_parse_string(&a, no_source, strlen(no_source), &p, NULL, 0));
+    ASSERT_EQ(-1, config_parse_string(&a, own_output, strlen(own_output), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_depends_on_and_ready(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: services\n"
+                       "max_parallel: 3\n"
+                       "windows:\n"
+                       "  - db:\n"
+                       "      ready: {output: /ready to accept/}\n"
+                       "      panes: [postgres]\n"
+                       "  - app:\n"
+                       "      depends_on: db\n"
+                       "      panes:\n"
+                       "        - server:\n"
+                       "            - rails s\n"
+                       "          ready: {tcp: 3000}\n"
+                       "        - worker:\n"
+                       "            - sidekiq\n"
+                       "          depends_on: [server]\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    ASSERT_EQ(3, p.max_parallel);
+
+    /* A ready output condition watches the pane it belongs to */
+    Window *db = &p.windows[0];
+    ASSERT_EQ(1, db->ready_count);
+    ASSERT_EQ(WAIT_OUTPUT, db->ready[0].kind);
+    ASSERT_EQ(0, db->ready[0].source_window);
+    ASSERT_EQ(0, db->ready[0].source_pane);
+
+    Window *app = &p.windows[1];
+    ASSERT_EQ(1, app->depends_on_count);
+    ASSERT_STR_EQ("db", app->depends_on[0]);
+    ASSERT_EQ(1, app->panes[0].ready_count);
+    ASSERT_EQ(WAIT_TCP, app->panes[0].ready[0].kind);
+    ASSERT_STR_EQ("worker", app->panes[1].title);
+    ASSERT_EQ(1, app->panes[1].command_count);
+    ASSERT_EQ(1, app->panes[1].depends_on_count);
+    ASSERT_STR_EQ("server", app->panes[1].depends_on[0]);
+
+    const char *negative = "name: services\n"
+                           "max_parallel: -1\n"
+                           "windows:\n"
+                           "  - db: postgres\n";
+    ASSERT_EQ(-1, config_parse_string(&a, negative, strlen(negative), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_priority(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: build\n"
+                       "windows:\n"
+                       "  - watchers:\n"
+                       "      nice: 10\n"
+                       "      ionice: idle\n"
+                       "      cpu_affinity: [0, 2-3]\n"
+                       "      panes:\n"
+                       "        - webpack --watch\n"
+                       "        - tests:\n"
+                       "            - jest --watch\n"
+                       "          nice: 5\n"
+                       "          cpu_affinity: \"1\"\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+
+    Window *w = &p.windows[0];
+    ASSERT(w->priority.has_nice);
+    ASSERT_EQ(10, w->priority.nice);
+    ASSERT_STR_EQ("idle", w->priority.ionice);
+    ASSERT_STR_EQ("0,2-3", w->priority.cpu_affinity);
+
+    /* Pane settings override the window's one by one */
+    Pane *tests = &w->panes[1];
+    ASSERT_STR_EQ("tests", tests->title);
+    Priority prio = project_pane_priority(w, tests);
+    ASSERT_EQ(5, prio.nice);
+    ASSERT_STR_EQ("idle", prio.ionice);
+    ASSERT_STR_EQ("1", prio.cpu_affinity);
+
+    const char *bad_nice = "name: build\n"
+                           "windows:\n"
+                           "  - w:\n"
+                           "      nice: 20\n";
+    const char *bad_ionice = "name: build\n"
+                             "windows:\n"
+                             "  - w:\n"
+                             "      ionice: low\n";
+    const char *bad_cpus = "name: build\n"
+                           "windows:\n"
+                           "  - w:\n"
+                           "      cpu_affinity: 3-1\n";
+    ASSERT_EQ(-1, config_parse_string(&a, bad_nice, strlen(bad_nice), &p, NULL, 0));
+    ASSERT_EQ(-1, config_parse_string(&a, bad_ionice, strlen(bad_ionice), &p, NULL, 0));
+    ASSERT_EQ(-1, config_parse_string(&a, bad_cpus, strlen(bad_cpus), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_lazy_windows(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: big\n"
+                       "windows:\n"
+                       "  - editor: vim\n"
+                       "  - logs:\n"
+                       "      lazy: true\n"
+                       "      panes: [tail -f log/development.log]\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    ASSERT_FALSE(p.windows[0].lazy);
+    ASSERT(p.windows[1].lazy);
+
+    /* Nothing can wait on a window that may never start */
+    const char *gated = "name: big\n"
+                        "windows:\n"
+                        "  - logs:\n"
+                        "      lazy: true\n"
+                        "      wait_for: {tcp: 5432}\n";
+    const char *dependent = "name: big\n"
+                            "windows:\n"
+                            "  - db:\n"
+                            "      lazy: true\n"
+                            "      panes: [postgres]\n"
+                            "  - app:\n"
+                            "      depends_on: db\n"
+                            "      panes: [rails s]\n";
+    ASSERT_EQ(-1, config_parse_string(&a, gated, strlen(gated), &p, NULL, 0));
+    ASSERT_EQ(-1, config_parse_string(&a, dependent, strlen(dependent), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_progressive(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: big\n"
+                       "progressive: true\n"
+                       "windows:\n"
+                       "  - editor: vim\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    ASSERT(p.progressive);
+    ASSERT_EQ(0, config_parse_string(&a, "name: small\n", 12, &p, NULL, 0));
+    ASSERT_FALSE(p.progressive);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_exec_panes(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: big\n"
+                       "windows:\n"
+                       "  - logs:\n"
+                       "      exec: true\n"
+                       "      panes: [tail -f a.log, tail -f b.log]\n"
+                       "  - app:\n"
+                       "      panes:\n"
+                       "        - vim\n"
+                       "        - server: [rails s]\n"
+                       "          exec: true\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    ASSERT(p.windows[0].panes[0].exec);
+    ASSERT(p.windows[0].panes[1].exec);
+    ASSERT_FALSE(p.windows[1].panes[0].exec);
+    ASSERT(p.windows[1].panes[1].exec);
+    ASSERT_STR_EQ("server", p.windows[1].panes[1].title);
+
+    /* The command starts with the pane, so it cannot wait */
+    const char *gated = "name: big\n"
+                        "windows:\n"
+                        "  - app:\n"
+                        "      exec: true\n"
+                        "      wait_for: {tcp: 5432}\n"
+                        "      panes: [rails s]\n";
+    ASSERT_EQ(-1, config_parse_string(&a, gated, strlen(gated), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_layout_spec(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: big\n"
+                       "windows:\n"
+                       "  - code:\n"
+                       "      layout:\n"
+                       "        columns:\n"
+                       "          - 2\n"
+                       "          - {size: 1, rows: [1, 1]}\n"
+                       "      panes: [vim, guard, top]\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    const LayoutCell *spec = p.windows[0].layout_spec;
+    ASSERT(spec != NULL);
+    ASSERT_EQ(NULL, p.windows[0].layout);
+    ASSERT_EQ(LAYOUT_COLUMNS, spec->kind);
+    ASSERT_EQ(2, spec->children[0].weight);
+    ASSERT_EQ(LAYOUT_ROWS, spec->children[1].kind);
+    ASSERT_EQ(3, layout_pane_count(spec));
+
+    /* One pane per leaf */
+    const char *count = "name: big\n"
+                        "windows:\n"
+                        "  - code:\n"
+                        "      layout: {rows: [1, 1]}\n"
+                        "      panes: [vim, guard, top]\n";
+    ASSERT_EQ(-1, config_parse_string(&a, count, strlen(count), &p, NULL, 0));
+    const char *single = "name: big\n"
+                         "windows:\n"
+                         "  - code:\n"
+                         "      layout: {rows: [1]}\n"
+                         "      panes: [vim]\n";
+    ASSERT_EQ(-1, config_parse_string(&a, single, strlen(single), &p, NULL, 0));
+    const char *size = "name: big\n"
+                       "windows:\n"
+                       "  - code:\n"
+                       "      layout: {rows: [1, 0]}\n"
+                       "      panes: [vim, top]\n";
+    ASSERT_EQ(-1, config_parse_string(&a, size, strlen(size), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_signals(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: big\n"
+                       "windows:\n"
+                       "  - db:\n"
+                       "      panes:\n"
+                       "        - migrate: [rake db:migrate]\n"
+                       "          signal: [migrated, db.ready]\n"
+                       "  - app:\n"
+                       "      wait_for: {signal: migrated, timeout: 30s}\n"
+                       "      panes: [rails s]\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    ASSERT_EQ(2, p.windows[0].panes[0].signal_count);
+    ASSERT_STR_EQ("db.ready", p.windows[0].panes[0].signals[1]);
+    ASSERT_EQ(WAIT_SIGNAL, p.windows[1].waits[0].kind);
+    ASSERT_STR_EQ("migrated", p.windows[1].waits[0].target);
+    ASSERT_EQ(30, p.windows[1].waits[0].timeout);
+
+    /* Nobody sends it */
+    const char *unsent = "name: big\n"
+                         "windows:\n"
+                         "  - app:\n"
+                         "      wait_for: {signal: migrated}\n"
+                         "      panes: [rails s]\n";
+    ASSERT_EQ(-1, config_parse_string(&a, unsent, strlen(unsent), &p, NULL, 0));
+    /* The window would hold back the pane that sends it */
+    const char *own = "name: big\n"
+                      "windows:\n"
+                      "  - db:\n"
+                      "      wait_for: {signal: migrated}\n"
+                      "      panes:\n"
+                      "        - migrate: [rake db:migrate]\n"
+                      "          signal: migrated\n";
+    ASSERT_EQ(-1, config_parse_string(&a, own, strlen(own), &p, NULL, 0));
+    const char *twice = "name: big\n"
+                        "windows:\n"
+                        "  - db:\n"
+                        "      panes:\n"
+                        "        - a: [true]\n"
+                        "          signal: done\n"
+                        "        - b: [true]\n"
+                        "          signal: done\n";
+    ASSERT_EQ(-1, config_parse_string(&a, twice, strlen(twice), &p, NULL, 0));
+    const char *bad = "name: big\n"
+                      "windows:\n"
+                      "  - db:\n"
+                      "      panes:\n"
+                      "        - a: [true]\n"
+                      "          signal: 'db ready'\n";
+    ASSERT_EQ(-1, config_parse_string(&a, bad, strlen(bad), &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
+/* A pane of one key is titled by it, even when the title is also the name
+ * of a pane option */
+TEST test_config_single_key_panes_are_titled(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *yaml = "name: titled\n"
+                       "windows:\n"
+                       "  - work:\n"
+                       "      panes:\n"
+                       "        - signal: ./run.sh\n"
+                       "        - nice: htop\n"
+                       "        - exec: make\n"
+                       "        - wait_for: [sleep 1, ls]\n"
+                       "        - depends_on: npm test\n";
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    Window *w = &p.windows[0];
+    ASSERT_EQ(5, w->pane_count);
+    ASSERT_STR_EQ("signal", w->panes[0].title);
+    ASSERT_STR_EQ("./run.sh", w->panes[0].commands[0]);
+    ASSERT_EQ(0, w->panes[0].signal_count);
+    ASSERT_STR_EQ("nice", w->panes[1].title);
+    ASSERT_STR_EQ("htop", w->panes[1].commands[0]);
+    ASSERT_FALSE(w->panes[1].priority.has_nice);
+    ASSERT_STR_EQ("exec", w->panes[2].title);
+    ASSERT_STR_EQ("make", w->panes[2].commands[0]);
+    ASSERT_FALSE(w->panes[2].exec);
+    ASSERT_STR_EQ("wait_for", w->panes[3].title);
+    ASSERT_EQ(2, w->panes[3].command_count);
+    ASSERT_EQ(0, w->panes[3].wait_count);
+    ASSERT_STR_EQ("depends_on", w->panes[4].title);
+    ASSERT_EQ(0, w->panes[4].depends_on_count);
+
+    /* Beside a title they are options again */
+    const char *both = "name: titled\n"
+                       "windows:\n"
+                       "  - work:\n"
+                       "      panes:\n"
+                       "        - build: make\n"
+                       "          nice: 10\n";
+    ASSERT_EQ(0, config_parse_string(&a, both, strlen(both), &p, NULL, 0));
+    ASSERT_STR_EQ("build", p.windows[0].panes[0].title);
+    ASSERT(p.windows[0].panes[0].priority.has_nice);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_config_prewarm(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, config_parse_string(&a, "name: big\nprewarm: 4\n", 22, &p, NULL, 0));
+    ASSERT_EQ(4, p.prewarm);
+    ASSERT_EQ(0, config_parse_string(&a, "name: small\n", 12, &p, NULL, 0));
+    ASSERT_EQ(0, p.prewarm);
+    ASSERT_EQ(-1, config_parse_string(&a, "name: big\nprewarm: lots\n", 25, &p, NULL, 0));
+    arena_free(&a);
+    PASS();
+}
+
 TEST test_config_window_root(void) {
     Arena a = arena_new();
     Project p;
@@ -450,6 +926,20 @@ SUITE(config_suite) {
     RUN_TEST(test_config_panes);
     RUN_TEST(test_config_deprecated);
     RUN_TEST(test_config_hooks_array);
+    RUN_TEST(test_config_hook_with_inputs);
+    RUN_TEST(test_config_hook_modes);
+    RUN_TEST(test_config_hook_rejects_unknown_mode);
+    RUN_TEST(test_config_wait_for);
+    RUN_TEST(test_config_wait_for_rejects_bad_gates);
+    RUN_TEST(test_config_depends_on_and_ready);
+    RUN_TEST(test_config_priority);
+    RUN_TEST(test_config_lazy_windows);
+    RUN_TEST(test_config_progressive);
+    RUN_TEST(test_config_prewarm);
+    RUN_TEST(test_config_exec_panes);
+    RUN_TEST(test_config_signals);
+    RUN_TEST(test_config_single_key_panes_are_titled);
+    RUN_TEST(test_config_layout_spec);
     RUN_TEST(test_config_window_root);
     RUN_TEST(test_config_empty_panes);
     RUN_TEST(test_config_synchronize);
@@ -0,0 +1,157 @@
+#include "arena.h"
+#include "config.h"
+#include "cost.h"
+#include "greatest.h"
+#include "project.h"
+#include "str.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *COST_CONFIG = "name: costed\n"
+                                 "root: /src\n"
+                                 "pre_window: nvm use\n"
+                                 "attach: false\n"
+                                 "windows:\n"
+                                 "  - editor:\n"
+                                 "      layout: even-horizontal\n"
+                                 "      panes:\n"
+                                 "        - vim\n"
+                                 "        - make watch\n"
+                                 "  - logs: tail -f log\n";
+
+static int estimate(Arena *a, Project *p, CostReport *r, const char *config) {
+    if (config_parse_string(a, config, strlen(config), p, NULL, 0) != 0) return -1;
+    cost_estimate(a, p, r);
+    return 0;
+}
+
+TEST test_cost_start_counts(void) {
+    Arena a = arena_new();
+    Project p;
+    CostReport r;
+    ASSERT_EQ(0, estimate(&a, &p, &r, COST_CONFIG));
+    ASSERT_EQ(2, r.windows);
+    ASSERT_EQ(3, r.panes);
+    ASSERT_EQ(NULL, r.unsupported);
+
+    /* start-server, base indices and has-session; new-session and the base
+     * indices again; six send-keys, a split, a layout, a window and focus */
+    const Cost *start = &r.backends[COST_START];
+    ASSERT_EQ(17, start->spawns[COST_TMUX]);
+    ASSERT_EQ(17, cost_spawns(start));
+    ASSERT_EQ(17, start->round_trips);
+    ASSERT_EQ(6, start->sends);
+    ASSERT_EQ(2, start->relayouts);
+    ASSERT_EQ(3, start->shells);
+    ASSERT_EQ(3, start->pre_window);
+    ASSERT(start->bytes > 0);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_cost_reports_what_the_plan_leaves_out(void) {
+    Arena a = arena_new();
+    Project p;
+    CostReport r;
+    const char *lazy = "name: lazy\n"
+                       "windows:\n"
+                       "  - main: vim\n"
+                       "  - later:\n"
+                       "      lazy: true\n"
+                       "      panes: [top]\n";
+    ASSERT_EQ(0, estimate(&a, &p, &r, lazy));
+    ASSERT_STR_EQ("lazy windows", r.unsupported);
+    ASSERT(cost_spawns(&r.backends[COST_START]) > 0);
+
+    Str out = str_new();
+    cost_format_table(&r, &p, NULL, &out);
+    ASSERT(strstr(str_cstr(&out), "The plan leaves out lazy windows; counts are a floor.\n") !=
+           NULL);
+    str_free(&out);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_cost_herdr_counts(void) {
+    Arena a = arena_new();
+    Project p;
+    CostReport r;
+    ASSERT_EQ(0, estimate(&a, &p, &r, COST_CONFIG));
+
+    const Cost *herdr = &r.backends[COST_HERDR];
+    ASSERT_EQ(21, herdr->spawns[COST_HERDR_CLI]);
+    ASSERT_EQ(7, herdr->spawns[COST_PYTHON]);
+    ASSERT_EQ(0, herdr->spawns[COST_TMUX]);
+    ASSERT_EQ(21, herdr->round_trips);
+    ASSERT_EQ(6, herdr->sends);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_cost_calibration(void) {
+    CostCalibration cal;
+    ASSERT_EQ(0, cost_parse_calibration("tmux=1.5,python3=20", &cal));
+    ASSERT(cal.set);
+    ASSERT_EQ(1.5, cal.ms[COST_TMUX]);
+    ASSERT_EQ(20.0, cal.ms[COST_PYTHON]);
+    ASSERT_EQ(0.0, cal.ms[COST_HERDR_CLI]);
+
+    Cost c = {0};
+    c.spawns[COST_TMUX] = 4;
+    c.spawns[COST_PYTHON] = 1;
+    ASSERT_EQ(26.0, cost_ms(&c, &cal));
+
+    ASSERT_EQ(-1, cost_parse_calibration("tmux", &cal));
+    ASSERT_EQ(-1, cost_parse_calibration("screen=2", &cal));
+    ASSERT_EQ(-1, cost_parse_calibration("tmux=-1", &cal));
+    ASSERT_EQ(-1, cost_parse_calibration("tmux=fast", &cal));
+    PASS();
+}
+
+TEST test_cost_format(void) {
+    Arena a = arena_new();
+    Project p;
+    CostReport r;
+    ASSERT_EQ(0, estimate(&a, &p, &r, COST_CONFIG));
+    CostCalibration cal;
+    ASSERT_EQ(0, cost_parse_calibration("tmux=2", &cal));
+
+    Str out = str_new();
+    cost_format_table(&r, &p, &cal, &out);
+    const char *table = str_cstr(&out);
+    ASSERT(strncmp(table, "Start cost of costed: 2 windows, 3 panes\n", 41) == 0);
+    ASSERT(strstr(table, "                     start     herdr\n") != NULL);
+    ASSERT(strstr(table, "spawns                  17        28\n") != NULL);
+    ASSERT(strstr(table, "estimated ms          34.0       0.0\n") != NULL);
+
+    str_clear(&out);
+    cost_format_json(&r, &p, NULL, &out);
+    const char *json = str_cstr(&out);
+    ASSERT(strncmp(json, "{\"project\": \"costed\", \"windows\": 2, \"panes\": 3, ", 48) == 0);
+    ASSERT(strstr(json, "\"start\": {\"spawns\": 17, \"spawns_by_program\": {\"tmux\": 17, ") !=
+           NULL);
+    ASSERT(strstr(json, "estimated_ms") == NULL);
+    str_free(&out);
+    arena_free(&a);
+    PASS();
+}
+
+SUITE(cost_suite) {
+    RUN_TEST(test_cost_start_counts);
+    RUN_TEST(test_cost_reports_what_the_plan_leaves_out);
+    RUN_TEST(test_cost_herdr_counts);
+    RUN_TEST(test_cost_calibration);
+    RUN_TEST(test_cost_format);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    /* The script sizes depend on the window size these set */
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
+    RUN_SUITE(cost_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,206 @@
+#include "arena.h"
+#include "config.h"
+#include "greatest.h"
+#include "hook.h"
+#include "project.h"
+#include "script.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char tmpdir[64];
+
+static void write_file(const char *name, const char *content) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", tmpdir, name);
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    fputs(content, f);
+    fclose(f);
+}
+
+static void make_tmpdir(void) {
+    snprintf(tmpdir, sizeof(tmpdir), "/tmp/mux-hook-test-XXXXXX");
+    if (!mkdtemp(tmpdir)) tmpdir[0] = '\0';
+}
+
+static void remove_tmpdir(void) {
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmpdir);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", tmpdir);
+}
+
+TEST test_hook_digest_tracks_content(void) {
+    Arena a = arena_new();
+    make_tmpdir();
+    char *inputs[] = {"Gemfile.lock"};
+
+    write_file("Gemfile.lock", "rails 7.1\n");
+    char *first = hook_digest(&a, tmpdir, inputs, 1);
+    char *again = hook_digest(&a, tmpdir, inputs, 1);
+    write_file("Gemfile.lock", "rails 7.2\n");
+    char *changed = hook_digest(&a, tmpdir, inputs, 1);
+
+    ASSERT_EQ(16, (int)strlen(first));
+    ASSERT_STR_EQ(first, again);
+    ASSERT(strcmp(first, changed) != 0);
+    remove_tmpdir();
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_hook_digest_notices_created_inputs(void) {
+    Arena a = arena_new();
+    make_tmpdir();
+    char *inputs[] = {"package-lock.json"};
+
+    char *missing = hook_digest(&a, tmpdir, inputs, 1);
+    write_file("package-lock.json", "{}\n");
+    char *present = hook_digest(&a, tmpdir, inputs, 1);
+
+    ASSERT(strcmp(missing, present) != 0);
+    remove_tmpdir();
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_hook_digest_expands_globs(void) {
+    Arena a = arena_new();
+    make_tmpdir();
+    char *inputs[] = {"*.lock"};
+
+    write_file("a.lock", "a\n");
+    char *one = hook_digest(&a, tmpdir, inputs, 1);
+    write_file("b.lock", "b\n");
+    char *two = hook_digest(&a, tmpdir, inputs, 1);
+
+    ASSERT(strcmp(one, two) != 0);
+    remove_tmpdir();
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_hook_stamp_path_sanitizes_project_name(void) {
+    Arena a = arena_new();
+    char *path = hook_stamp_path(&a, "/state", "team's/work", HOOK_PROJECT_FIRST_START);
+    ASSERT_STR_EQ("/state/stamps/team_s_work.on_project_first_start", path);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_hook_resolve_compares_stamp(void) {
+    Arena a = arena_new();
+    make_tmpdir();
+    write_file("Gemfile.lock", "rails 7.1\n");
+
+    char yaml[512];
+    snprintf(yaml, sizeof(yaml),
+             "name: memo\n"
+             "root: %s\n"
+             "on_project_first_start:\n"
+             "  run: bundle install\n"
+             "  inputs: Gemfile.lock\n"
+             "windows:\n"
+             "  - main: echo hi\n",
+             tmpdir);
+    Project p;
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+
+    hook_resolve(&a, &p, tmpdir);
+    HookOptions *h = &p.hooks[HOOK_PROJECT_FIRST_START];
+    ASSERT(h->digest != NULL);
+    ASSERT(!h->up_to_date);
+    ASSERT(p.hooks[HOOK_PROJECT_START].digest == NULL);
+
+    char stamps[128];
+    snprintf(stamps, sizeof(stamps), "%s/stamps", tmpdir);
+    mkdir(stamps, 0755);
+    FILE *f = fopen(h->stamp_path, "w");
+    ASSERT(f != NULL);
+    fprintf(f, "%s\n", h->digest);
+    fclose(f);
+
+    hook_resolve(&a, &p, tmpdir);
+    ASSERT(p.hooks[HOOK_PROJECT_FIRST_START].up_to_date);
+
+    write_file("Gemfile.lock", "rails 7.2\n");
+    hook_resolve(&a, &p, tmpdir);
+    ASSERT(!p.hooks[HOOK_PROJECT_FIRST_START].up_to_date);
+
+    remove_tmpdir();
+    arena_free(&a);
+    PASS();
+}
+
+/* bundle install rewrites Gemfile.lock, so the stamp must be the digest of
+ * what the hook left behind, or the hook would run again on every start. */
+TEST test_hook_stamps_inputs_the_hook_rewrote(void) {
+    /* Meson points MUX_BIN at the mux it built */
+    const char *mux = getenv("MUX_BIN");
+    if (!mux || access(mux, X_OK) != 0) {
+        SKIPm("MUX_BIN is not set to a mux binary");
+    }
+    Arena a = arena_new();
+    make_tmpdir();
+    write_file("Gemfile.lock", "rails 7.1\n");
+
+    char yaml[512];
+    snprintf(yaml, sizeof(yaml),
+             "name: memo\n"
+             "root: %s\n"
+             "on_project_first_start:\n"
+             "  run: echo rails 7.2 > Gemfile.lock\n"
+             "  inputs: Gemfile.lock\n"
+             "windows:\n"
+             "  - main: echo hi\n",
+             tmpdir);
+    Project p;
+    ASSERT_EQ(0, config_parse_string(&a, yaml, strlen(yaml), &p, NULL, 0));
+    hook_resolve(&a, &p, tmpdir);
+    ASSERT(!p.hooks[HOOK_PROJECT_FIRST_START].up_to_date);
+
+    /* Run just the hook and its stamp out of the start script */
+    char *script = script_generate_start(&p);
+    char *hook = strstr(script, "echo rails 7.2 > Gemfile.lock\n");
+    ASSERT(hook != NULL);
+    char *end = strchr(strchr(hook, '\n') + 1, '\n');
+    ASSERT(end != NULL);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/hook.sh", tmpdir);
+    FILE *f = fopen(path, "w");
+    ASSERT(f != NULL);
+    fprintf(f, "set -eu\ncd '%s'\n%.*s", tmpdir, (int)(end + 1 - hook), hook);
+    fclose(f);
+    free(script);
+
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "sh '%s'", path);
+    ASSERT_EQ(0, system(cmd));
+
+    hook_resolve(&a, &p, tmpdir);
+    ASSERT(p.hooks[HOOK_PROJECT_FIRST_START].up_to_date);
+
+    remove_tmpdir();
+    arena_free(&a);
+    PASS();
+}
+
+SUITE(hook_suite) {
+    RUN_TEST(test_hook_digest_tracks_content);
+    RUN_TEST(test_hook_digest_notices_created_inputs);
+    RUN_TEST(test_hook_digest_expands_globs);
+    RUN_TEST(test_hook_stamp_path_sanitizes_project_name);
+    RUN_TEST(test_hook_resolve_compares_stamp);
+    RUN_TEST(test_hook_stamps_inputs_the_hook_rewrote);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(hook_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,109 @@
+#include "greatest.h"
+#include "layout.h"
+
+static char *format(Arena *a, const LayoutCell *root) {
+    Str s = str_new();
+    layout_format(root, &s);
+    char *out = arena_strdup(a, str_cstr(&s));
+    str_free(&s);
+    return out;
+}
+
+TEST test_layout_checksum(void) {
+    ASSERT_EQ(0x562d, layout_checksum("120x40,0,0[120x19,0,0,1,120x20,0,20,2]"));
+    ASSERT_EQ(0, layout_checksum(""));
+    PASS();
+}
+
+TEST test_layout_presets_match_tmux(void) {
+    Arena a = arena_new();
+    ASSERT_STR_EQ("56f7,120x40,0,0[120x19,0,0{59x19,0,0,0,60x19,60,0,1},120x20,0,20,2]",
+                  format(&a, layout_preset(&a, "tiled", 3, 120, 40)));
+    ASSERT_STR_EQ("1e7f,120x40,0,0{80x40,0,0,0,39x40,81,0[39x19,81,0,1,39x20,81,20,2]}",
+                  format(&a, layout_preset(&a, "main-vertical", 3, 120, 40)));
+    ASSERT_STR_EQ("56ab,120x40,0,0[120x24,0,0,0,120x15,0,25,1]",
+                  format(&a, layout_preset(&a, "main-horizontal", 2, 120, 40)));
+    ASSERT_STR_EQ("08ef,10x5,0,0{2x5,0,0,0,2x5,3,0,1,4x5,6,0,2}",
+                  format(&a, layout_preset(&a, "even-horizontal", 3, 10, 5)));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_layout_preset_rejects_unknown_or_crowded(void) {
+    Arena a = arena_new();
+    ASSERT_EQ(NULL, layout_preset(&a, "spiral", 3, 120, 40));
+    ASSERT_EQ(NULL, layout_preset(&a, "even-vertical", 30, 80, 24));
+    ASSERT(layout_preset(&a, "even-vertical", 12, 80, 24) != NULL);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_layout_fit_shares_by_weight(void) {
+    Arena a = arena_new();
+    LayoutCell right[2] = {{.kind = LAYOUT_PANE, .weight = 1}, {.kind = LAYOUT_PANE, .weight = 1}};
+    LayoutCell columns[2] = {
+        {.kind = LAYOUT_PANE, .weight = 2},
+        {.kind = LAYOUT_ROWS, .weight = 1, .children = right, .child_count = 2},
+    };
+    LayoutCell spec = {.kind = LAYOUT_COLUMNS, .weight = 1, .children = columns, .child_count = 2};
+
+    LayoutCell *root = layout_fit(&a, &spec, 121, 41);
+    ASSERT(root != NULL);
+    ASSERT_EQ(3, layout_pane_count(root));
+    ASSERT_EQ(80, root->children[0].sx);
+    ASSERT_EQ(40, root->children[1].sx);
+    ASSERT_EQ(81, root->children[1].x);
+    ASSERT_EQ(2, root->children[1].children[1].pane);
+    ASSERT_STR_EQ("121x41,0,0{80x41,0,0,0,40x41,81,0[40x20,81,0,1,40x20,81,21,2]}",
+                  format(&a, root) + 5);
+
+    /* The spec itself is left untouched */
+    ASSERT_EQ(0, spec.sx);
+    ASSERT_EQ(NULL, layout_fit(&a, &spec, 2, 10));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_layout_parse_reads_tmux_strings(void) {
+    Arena a = arena_new();
+    const char *saved = "6339,120x40,0,0{80x40,0,0,5,39x40,81,0[39x12,81,0,6,39x12,81,13,7,"
+                        "39x14,81,26,8]}";
+    LayoutCell *root = layout_parse(&a, saved);
+    ASSERT(root != NULL);
+    ASSERT_EQ(LAYOUT_COLUMNS, root->kind);
+    ASSERT_EQ(4, layout_pane_count(root));
+    ASSERT_EQ(LAYOUT_ROWS, root->children[1].kind);
+    ASSERT_EQ(26, root->children[1].children[2].y);
+    /* Panes are numbered in tree order, whatever IDs the string had */
+    ASSERT_EQ(3, root->children[1].children[2].pane);
+    ASSERT_STR_EQ("120x40,0,0{80x40,0,0,0,39x40,81,0[39x12,81,0,1,39x12,81,13,2,39x14,81,26,3]}",
+                  format(&a, root) + 5);
+
+    /* Without a checksum, and without pane IDs */
+    root = layout_parse(&a, "80x24,0,0[80x12,0,0,80x11,0,13]");
+    ASSERT(root != NULL);
+    ASSERT_EQ(2, layout_pane_count(root));
+    ASSERT_EQ(13, root->children[1].y);
+
+    ASSERT_EQ(NULL, layout_parse(&a, "0000,80x24,0,0,1"));
+    ASSERT_EQ(NULL, layout_parse(&a, "80x24,0,0{40x24,0,0,1"));
+    ASSERT_EQ(NULL, layout_parse(&a, "main-vertical"));
+    arena_free(&a);
+    PASS();
+}
+
+SUITE(layout_suite) {
+    RUN_TEST(test_layout_checksum);
+    RUN_TEST(test_layout_presets_match_tmux);
+    RUN_TEST(test_layout_preset_rejects_unknown_or_crowded);
+    RUN_TEST(test_layout_fit_shares_by_weight);
+    RUN_TEST(test_layout_parse_reads_tmux_strings);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(layout_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,107 @@
+#include "greatest.h"
+#include "lazy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char tmpdir[64];
+
+static void make_tmpdir(void) {
+    snprintf(tmpdir, sizeof(tmpdir), "/tmp/mux-lazy-test-XXXXXX");
+    if (!mkdtemp(tmpdir)) tmpdir[0] = '\0';
+}
+
+static void remove_tmpdir(void) {
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmpdir);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", tmpdir);
+}
+
+static void write_script(const char *path, const char *body) {
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    fputs(body, f);
+    fclose(f);
+}
+
+static int count_lines(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int lines = 0;
+    for (int c; (c = fgetc(f)) != EOF;) lines += c == '\n';
+    fclose(f);
+    return lines;
+}
+
+TEST test_lazy_run_starts_once(void) {
+    make_tmpdir();
+    char script[128], log[128], body[256];
+    snprintf(script, sizeof(script), "%s/1.sh", tmpdir);
+    snprintf(log, sizeof(log), "%s/log", tmpdir);
+    snprintf(body, sizeof(body), "echo started >> '%s'\necho noise\n", log);
+    write_script(script, body);
+
+    ASSERT_EQ(0, lazy_run(script));
+    ASSERT_EQ(1, count_lines(log));
+    ASSERT(access(script, F_OK) != 0);
+
+    /* Selecting the window again finds nothing left to run */
+    ASSERT_EQ(0, lazy_run(script));
+    ASSERT_EQ(1, count_lines(log));
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_lazy_run_removes_the_last_script_dir(void) {
+    make_tmpdir();
+    char dir[128], first[160], second[160];
+    snprintf(dir, sizeof(dir), "%s/mux-lazy.run", tmpdir);
+    ASSERT_EQ(0, mkdir(dir, 0700));
+    snprintf(first, sizeof(first), "%s/1.sh", dir);
+    snprintf(second, sizeof(second), "%s/2.sh", dir);
+    write_script(first, "true\n");
+    write_script(second, "true\n");
+
+    ASSERT_EQ(0, lazy_run(first));
+    ASSERT_EQ(0, access(dir, F_OK));
+    ASSERT_EQ(0, lazy_run(second));
+    ASSERT(access(dir, F_OK) != 0);
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_lazy_run_reports_failure(void) {
+    make_tmpdir();
+    char script[128];
+    snprintf(script, sizeof(script), "%s/2.sh", tmpdir);
+    write_script(script, "exit 3\n");
+
+    ASSERT_EQ(-1, lazy_run(script));
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_lazy_command_usage(void) {
+    char *two[] = {"@1", "@2"};
+    ASSERT_EQ(2, lazy_command(0, NULL));
+    ASSERT_EQ(2, lazy_command(2, two));
+    PASS();
+}
+
+SUITE(lazy_suite) {
+    RUN_TEST(test_lazy_run_starts_once);
+    RUN_TEST(test_lazy_run_removes_the_last_script_dir);
+    RUN_TEST(test_lazy_run_reports_failure);
+    RUN_TEST(test_lazy_command_usage);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(lazy_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,271 @@
+#include "arena.h"
+#include "config.h"
+#include "greatest.h"
+#include "plan.h"
+#include "project.h"
+#include "script.h"
+#include "str.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char *PLAN_CONFIG = "name: planned\n"
+                                 "root: /src\n"
+                                 "pre_window: nvm use\n"
+                                 "attach: false\n"
+                                 "windows:\n"
+                                 "  - editor:\n"
+                                 "      layout: even-horizontal\n"
+                                 "      focused_pane: 1\n"
+                                 "      panes:\n"
+                                 "        - code: vim\n"
+                                 "        - make watch\n"
+                                 "  - logs: tail -f log\n";
+
+static Plan *build(Arena *a, Project *p, const char *config) {
+    if (config_parse_string(a, config, strlen(config), p, NULL, 0) != 0) return NULL;
+    return plan_build(a, p);
+}
+
+static int count_kind(const Plan *plan, PlanOpKind kind) {
+    int n = 0;
+    for (int i = 0; i < plan->count; i++) n += plan->ops[i].kind == kind;
+    return n;
+}
+
+TEST test_plan_build_orders_operations(void) {
+    Arena a = arena_new();
+    Project p;
+    Plan *plan = build(&a, &p, PLAN_CONFIG);
+    ASSERT(plan != NULL);
+    ASSERT_EQ(NULL, plan->unsupported);
+
+    PlanOpKind kinds[] = {
+        PLAN_CREATE_SESSION, PLAN_SET_TITLE, PLAN_SEND, PLAN_SEND, PLAN_SPLIT,
+        PLAN_SEND,           PLAN_SEND,      PLAN_LAYOUT, PLAN_FOCUS, PLAN_CREATE_WINDOW,
+        PLAN_SEND,           PLAN_SEND,      PLAN_FOCUS,
+    };
+    ASSERT_EQ((int)(sizeof(kinds) / sizeof(kinds[0])), plan->count);
+    for (int i = 0; i < plan->count; i++) ASSERT_EQ(kinds[i], plan->ops[i].kind);
+
+    const PlanOp *split = &plan->ops[4];
+    ASSERT_EQ(1, split->pane);
+    ASSERT_EQ(50, split->percent);
+    ASSERT(split->horizontal);
+    ASSERT_STR_EQ("/src", split->cwd);
+    ASSERT_EQ(1, split->dep_count);
+    ASSERT_EQ(0, split->deps[0]);
+
+    /* pre_window goes first, and each line follows the one before */
+    ASSERT_STR_EQ("nvm use", plan->ops[2].lines[0]);
+    ASSERT_STR_EQ("vim", plan->ops[3].lines[0]);
+    ASSERT_EQ(2, plan->ops[3].deps[0]);
+
+    /* The startup window is selected once every window exists */
+    const PlanOp *focus = &plan->ops[12];
+    ASSERT_EQ(0, focus->window);
+    ASSERT_EQ(-1, focus->pane);
+    ASSERT_EQ(2, focus->dep_count);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_plan_coalesce_merges_sends(void) {
+    Arena a = arena_new();
+    Project p;
+    Plan *plan = build(&a, &p, PLAN_CONFIG);
+    plan_coalesce(&a, plan);
+
+    ASSERT_EQ(10, plan->count);
+    ASSERT_EQ(3, count_kind(plan, PLAN_SEND));
+    const PlanOp *send = &plan->ops[2];
+    ASSERT_EQ(PLAN_SEND, send->kind);
+    ASSERT_EQ(2, send->line_count);
+    ASSERT_STR_EQ("nvm use", send->lines[0]);
+    ASSERT_STR_EQ("vim", send->lines[1]);
+    ASSERT_EQ(1, send->dep_count);
+    ASSERT_EQ(0, send->deps[0]);
+
+    /* Dependencies on merged sends point at what they were merged into */
+    ASSERT_EQ(PLAN_SPLIT, plan->ops[3].kind);
+    ASSERT_EQ(PLAN_LAYOUT, plan->ops[5].kind);
+    ASSERT_EQ(3, plan->ops[5].deps[0]);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_plan_dedupe_drops_redundant_focus(void) {
+    Arena a = arena_new();
+    Project p;
+    Plan *plan = build(&a, &p, PLAN_CONFIG);
+    plan_dedupe(&a, plan);
+
+    /* Pane 1 is active after the split; the window focus is still needed
+     * since new-window selected logs */
+    ASSERT_EQ(1, count_kind(plan, PLAN_FOCUS));
+    ASSERT_EQ(PLAN_FOCUS, plan->ops[plan->count - 1].kind);
+
+    const char *single = "name: one\n"
+                         "windows:\n"
+                         "  - main:\n"
+                         "      focused_pane: 0\n"
+                         "      panes: [a, b]\n"
+                         "  - side: c\n"
+                         "startup_window: side\n";
+    plan = build(&a, &p, single);
+    plan_dedupe(&a, plan);
+    ASSERT_EQ(1, count_kind(plan, PLAN_FOCUS));
+    ASSERT_EQ(0, plan->ops[plan->count - 2].pane);
+    /* Whatever followed the dropped focus follows what it followed */
+    const PlanOp *attach = &plan->ops[plan->count - 1];
+    ASSERT_EQ(PLAN_ATTACH, attach->kind);
+    for (int k = 0; k < attach->dep_count; k++) ASSERT(attach->deps[k] < plan->count - 1);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_plan_schedule_levels(void) {
+    Arena a = arena_new();
+    Project p;
+    Plan *plan = build(&a, &p, PLAN_CONFIG);
+    plan_coalesce(&a, plan);
+    plan_dedupe(&a, plan);
+
+    ASSERT_EQ(3, plan_schedule(plan));
+    ASSERT_EQ(0, plan->ops[0].level);
+    /* The first pane's send, its split and the second window go together */
+    ASSERT_EQ(1, plan->ops[2].level);
+    ASSERT_EQ(1, plan->ops[3].level);
+    ASSERT_EQ(PLAN_CREATE_WINDOW, plan->ops[6].kind);
+    ASSERT_EQ(1, plan->ops[6].level);
+    for (int i = 0; i < plan->count; i++) {
+        for (int k = 0; k < plan->ops[i].dep_count; k++) {
+            ASSERT(plan->ops[plan->ops[i].deps[k]].level < plan->ops[i].level);
+        }
+    }
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_plan_hooks_and_unsupported(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: hooked\n"
+                         "on_project_start: echo one\n"
+                         "on_project_first_start:\n"
+                         "  run: ./seed\n"
+                         "  mode: parallel\n"
+                         "on_project_exit: echo bye\n"
+                         "windows:\n"
+                         "  - main: echo hi\n";
+    Plan *plan = build(&a, &p, config);
+    ASSERT_EQ(PLAN_HOOK, plan->ops[0].kind);
+    ASSERT_EQ(HOOK_PROJECT_FIRST_START, plan->ops[1].hook);
+    /* A parallel hook does not hold the session back */
+    ASSERT_EQ(PLAN_CREATE_SESSION, plan->ops[2].kind);
+    ASSERT_EQ(1, plan->ops[2].dep_count);
+    ASSERT_EQ(0, plan->ops[2].deps[0]);
+    /* on_project_exit runs once attach returns */
+    const PlanOp *exit_hook = &plan->ops[plan->count - 1];
+    ASSERT_EQ(HOOK_PROJECT_EXIT, exit_hook->hook);
+    ASSERT_EQ(1, exit_hook->dep_count);
+    ASSERT_EQ(PLAN_ATTACH, plan->ops[exit_hook->deps[0]].kind);
+
+    const char *lazy = "name: lazy\n"
+                       "windows:\n"
+                       "  - main: vim\n"
+                       "  - later:\n"
+                       "      lazy: true\n"
+                       "      panes: [top]\n";
+    plan = build(&a, &p, lazy);
+    ASSERT_STR_EQ("lazy windows", plan->unsupported);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_plan_dump(void) {
+    Arena a = arena_new();
+    Project p;
+    Plan *plan = build(&a, &p, PLAN_CONFIG);
+    plan_coalesce(&a, plan);
+    plan_dedupe(&a, plan);
+    plan_schedule(plan);
+
+    Str out = str_new();
+    plan_dump(plan, &p, &out);
+    const char *dump = str_cstr(&out);
+    ASSERT(strncmp(dump, "plan: 9 operations in 3 levels\n", 31) == 0);
+    ASSERT(strstr(dump, "  0 [L0] create-session planned:editor.0 cwd=/src\n") != NULL);
+    ASSERT(strstr(dump, "  2 [L1] send planned:editor.0 \"nvm use\" \"vim\" <- 0\n") != NULL);
+    ASSERT(strstr(dump, "  3 [L1] split planned:editor.1 -h 50% cwd=/src <- 0\n") != NULL);
+    ASSERT(strstr(dump, "  8 [L2] focus planned:editor <- 3,6\n") != NULL);
+    str_free(&out);
+    arena_free(&a);
+    PASS();
+}
+
+/* The plan splits a window as the start script does, tiling on the way
+ * when the panes run out of room */
+TEST test_plan_splits_match_the_start_script(void) {
+    Arena a = arena_new();
+    Project p;
+    Str config = str_new();
+    str_append(&config, "name: big\nwindows:\n  - work:\n      panes:\n");
+    for (int i = 0; i < 150; i++) str_append(&config, "        - top\n");
+    setenv("MUX_TMUX_COLUMNS", "80", 1);
+    setenv("MUX_TMUX_LINES", "24", 1);
+    Plan *plan = build(&a, &p, str_cstr(&config));
+    char *script = plan ? script_generate_start(&p) : NULL;
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
+    str_free(&config);
+    ASSERT(script != NULL);
+    ASSERT_EQ(149, count_kind(plan, PLAN_SPLIT));
+
+    const char *at = script;
+    int tiles = 0;
+    for (int i = 0; i < plan->count; i++) {
+        const PlanOp *op = &plan->ops[i];
+        char want[64];
+        if (op->kind == PLAN_SPLIT) {
+            snprintf(want, sizeof(want), "splitw -t big:work %s -p %d\n",
+                     op->horizontal ? "-h" : "-v", op->percent);
+        } else if (op->kind == PLAN_LAYOUT && strcmp(op->text, "tiled") == 0) {
+            snprintf(want, sizeof(want), "select-layout -t big:work tiled\n");
+            tiles++;
+        } else {
+            continue;
+        }
+        const char *split = strstr(at, "tmux splitw");
+        const char *layout = strstr(at, "tmux select-layout");
+        const char *next = split && (!layout || split < layout) ? split : layout;
+        ASSERT(next != NULL);
+        ASSERT_STRN_EQ(want, next + strlen("tmux "), strlen(want));
+        at = next + 1;
+    }
+    ASSERT(tiles > 0);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+SUITE(plan_suite) {
+    RUN_TEST(test_plan_build_orders_operations);
+    RUN_TEST(test_plan_coalesce_merges_sends);
+    RUN_TEST(test_plan_dedupe_drops_redundant_focus);
+    RUN_TEST(test_plan_schedule_levels);
+    RUN_TEST(test_plan_hooks_and_unsupported);
+    RUN_TEST(test_plan_dump);
+    RUN_TEST(test_plan_splits_match_the_start_script);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    /* Layouts are worked out for the window size these set */
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
+    RUN_SUITE(plan_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,123 @@
+#include "greatest.h"
+#include "priority.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+TEST test_priority_parse_ionice(void) {
+    IoniceClass cls = IONICE_NONE;
+    int level = -1;
+
+    ASSERT_EQ(0, priority_parse_ionice("idle", &cls, &level));
+    ASSERT_EQ(IONICE_IDLE, cls);
+    ASSERT_EQ(0, priority_parse_ionice("best-effort", &cls, &level));
+    ASSERT_EQ(IONICE_BEST_EFFORT, cls);
+    ASSERT_EQ(4, level);
+    ASSERT_EQ(0, priority_parse_ionice("realtime:2", &cls, &level));
+    ASSERT_EQ(IONICE_REALTIME, cls);
+    ASSERT_EQ(2, level);
+    ASSERT_EQ(0, priority_parse_ionice("7", &cls, &level));
+    ASSERT_EQ(IONICE_BEST_EFFORT, cls);
+    ASSERT_EQ(7, level);
+
+    ASSERT_EQ(-1, priority_parse_ionice("idle:3", &cls, &level));
+    ASSERT_EQ(-1, priority_parse_ionice("best-effort:8", &cls, &level));
+    ASSERT_EQ(-1, priority_parse_ionice("low", &cls, &level));
+    ASSERT_EQ(-1, priority_parse_ionice("", &cls, &level));
+    PASS();
+}
+
+TEST test_priority_parse_cpus(void) {
+    int cpus[16];
+
+    ASSERT_EQ(6, priority_parse_cpus("8,0-3,2,10", cpus, 16));
+    ASSERT_EQ(0, cpus[0]);
+    ASSERT_EQ(3, cpus[3]);
+    ASSERT_EQ(8, cpus[4]);
+    ASSERT_EQ(10, cpus[5]);
+    ASSERT_EQ(1, priority_parse_cpus("5", cpus, 16));
+
+    ASSERT_EQ(-1, priority_parse_cpus("3-1", cpus, 16));
+    ASSERT_EQ(-1, priority_parse_cpus("0,,1", cpus, 16));
+    ASSERT_EQ(-1, priority_parse_cpus("0-", cpus, 16));
+    ASSERT_EQ(-1, priority_parse_cpus("16", cpus, 16));
+    ASSERT_EQ(-1, priority_parse_cpus("a", cpus, 16));
+    PASS();
+}
+
+TEST test_priority_command_applies_to_process_tree(void) {
+    /* A shell-like parent with a child already running */
+    int ready[2];
+    ASSERT_EQ(0, pipe(ready));
+    pid_t parent = fork();
+    if (parent == 0) {
+        pid_t child = fork();
+        if (child == 0) {
+            pause();
+            _exit(0);
+        }
+        if (write(ready[1], &child, sizeof(child)) != sizeof(child)) _exit(1);
+        waitpid(child, NULL, 0);
+        _exit(0);
+    }
+    pid_t child = 0;
+    ASSERT_EQ((ssize_t)sizeof(child), read(ready[0], &child, sizeof(child)));
+    close(ready[0]);
+    close(ready[1]);
+
+    char pid_arg[32];
+    snprintf(pid_arg, sizeof(pid_arg), "%d", (int)parent);
+    char *argv[] = {"--nice", "7", "--cpus", "0", pid_arg};
+    ASSERT_EQ(0, priority_command(5, argv));
+
+    errno = 0;
+    ASSERT_EQ(7, getpriority(PRIO_PROCESS, (id_t)parent));
+    ASSERT_EQ(7, getpriority(PRIO_PROCESS, (id_t)child));
+#ifdef __linux__
+    cpu_set_t mask;
+    ASSERT_EQ(0, sched_getaffinity(child, sizeof(mask), &mask));
+    ASSERT_EQ(1, CPU_COUNT(&mask));
+    ASSERT(CPU_ISSET(0, &mask));
+#endif
+
+    kill(child, SIGTERM);
+    waitpid(parent, NULL, 0);
+    PASS();
+}
+
+TEST test_priority_command_usage(void) {
+    char *no_pid[] = {"--nice", "5"};
+    char *bad_nice[] = {"--nice", "40", "123"};
+    char *bad_pid[] = {"--nice", "5", "shell"};
+    char *unknown[] = {"--weight", "5", "123"};
+
+    ASSERT_EQ(2, priority_command(2, no_pid));
+    ASSERT_EQ(2, priority_command(3, bad_nice));
+    ASSERT_EQ(2, priority_command(3, bad_pid));
+    ASSERT_EQ(2, priority_command(3, unknown));
+    PASS();
+}
+
+SUITE(priority_suite) {
+    RUN_TEST(test_priority_parse_ionice);
+    RUN_TEST(test_priority_parse_cpus);
+    RUN_TEST(test_priority_command_applies_to_process_tree);
+    RUN_TEST(test_priority_command_usage);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(priority_suite);
+    GREATEST_MAIN_END();
+}
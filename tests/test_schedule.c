@@ -0,0 +1,172 @@
+#include "arena.h"
+#include "config.h"
+#include "greatest.h"
+#include "project.h"
+#include "schedule.h"
+
+#include <string.h>
+
+static int parse(Arena *a, const char *yaml, Project *p) {
+    return config_parse_string(a, yaml, strlen(yaml), p, NULL, 0);
+}
+
+static int has_after(const Pane *pane, int node) {
+    for (int i = 0; i < pane->after_count; i++) {
+        if (pane->after[i] == node) return 1;
+    }
+    return 0;
+}
+
+TEST test_schedule_inactive_without_dependencies(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, parse(&a,
+                       "name: plain\n"
+                       "windows:\n"
+                       "  - db: postgres\n"
+                       "  - app: rails s\n",
+                       &p));
+    ASSERT_FALSE(schedule_active(&p));
+    ASSERT_EQ(0, p.windows[1].panes[0].after_count);
+    ASSERT_EQ(-1, p.windows[1].panes[0].turn_after);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_schedule_resolves_window_and_pane_dependencies(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, parse(&a,
+                       "name: services\n"
+                       "windows:\n"
+                       "  - db:\n"
+                       "      panes:\n"
+                       "        - postgres\n"
+                       "        - redis-server\n"
+                       "  - app:\n"
+                       "      depends_on: db\n"
+                       "      panes:\n"
+                       "        - server:\n"
+                       "            - rails s\n"
+                       "        - worker:\n"
+                       "            - sidekiq\n"
+                       "          depends_on: [server, db.1]\n",
+                       &p));
+    ASSERT(schedule_active(&p));
+    ASSERT_EQ(3, schedule_node_id(&p, 1, 1));
+
+    /* A window dependency covers every pane of both windows */
+    Pane *server = &p.windows[1].panes[0];
+    ASSERT_EQ(2, server->after_count);
+    ASSERT(has_after(server, 0));
+    ASSERT(has_after(server, 1));
+
+    /* Pane references by title and by window.pane index, without duplicates */
+    Pane *worker = &p.windows[1].panes[1];
+    ASSERT_EQ(3, worker->after_count);
+    ASSERT(has_after(worker, 2));
+    ASSERT(has_after(worker, 1));
+    ASSERT_EQ(0, p.windows[0].panes[0].after_count);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_schedule_rejects_cycles_and_unknown_names(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(-1, parse(&a,
+                        "name: loop\n"
+                        "windows:\n"
+                        "  - api:\n"
+                        "      depends_on: auth\n"
+                        "      panes: [./api]\n"
+                        "  - auth:\n"
+                        "      depends_on: [db]\n"
+                        "      panes: [./auth]\n"
+                        "  - db:\n"
+                        "      depends_on: api\n"
+                        "      panes: [postgres]\n",
+                        &p));
+    ASSERT_EQ(-1, parse(&a,
+                        "name: self\n"
+                        "windows:\n"
+                        "  - api:\n"
+                        "      depends_on: api\n"
+                        "      panes: [./api]\n",
+                        &p));
+    ASSERT_EQ(-1, parse(&a,
+                        "name: typo\n"
+                        "windows:\n"
+                        "  - api:\n"
+                        "      depends_on: postgress\n"
+                        "      panes: [./api]\n",
+                        &p));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_schedule_max_parallel_chains_in_dependency_order(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, parse(&a,
+                       "name: fleet\n"
+                       "max_parallel: 2\n"
+                       "windows:\n"
+                       "  - gateway:\n"
+                       "      depends_on: [users, orders]\n"
+                       "      panes: [./gateway]\n"
+                       "  - users: ./users\n"
+                       "  - orders: ./orders\n"
+                       "  - billing: ./billing\n"
+                       "  - search: ./search\n",
+                       &p));
+    ASSERT_EQ(2, p.max_parallel);
+
+    /* Order: users(1) orders(2) gateway(0) billing(3) search(4); each pane
+     * takes its turn after the one max_parallel places before it */
+    ASSERT_EQ(-1, p.windows[1].panes[0].turn_after);
+    ASSERT_EQ(-1, p.windows[2].panes[0].turn_after);
+    ASSERT_EQ(1, p.windows[0].panes[0].turn_after);
+    ASSERT_EQ(2, p.windows[3].panes[0].turn_after);
+    ASSERT_EQ(0, p.windows[4].panes[0].turn_after);
+    /* Turns are kept apart from real dependencies */
+    ASSERT_EQ(2, p.windows[0].panes[0].after_count);
+    ASSERT_EQ(0, p.windows[3].panes[0].after_count);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_schedule_max_parallel_skips_lazy_windows(void) {
+    Arena a = arena_new();
+    Project p;
+    ASSERT_EQ(0, parse(&a,
+                       "name: fleet\n"
+                       "max_parallel: 1\n"
+                       "windows:\n"
+                       "  - users: ./users\n"
+                       "  - logs:\n"
+                       "      lazy: true\n"
+                       "      panes: [tail -f log]\n"
+                       "  - orders: ./orders\n",
+                       &p));
+    ASSERT_EQ(-1, p.windows[1].panes[0].turn_after);
+    ASSERT_EQ(0, p.windows[2].panes[0].turn_after);
+    arena_free(&a);
+    PASS();
+}
+
+SUITE(schedule_suite) {
+    RUN_TEST(test_schedule_inactive_without_dependencies);
+    RUN_TEST(test_schedule_resolves_window_and_pane_dependencies);
+    RUN_TEST(test_schedule_rejects_cycles_and_unknown_names);
+    RUN_TEST(test_schedule_max_parallel_chains_in_dependency_order);
+    RUN_TEST(test_schedule_max_parallel_skips_lazy_windows);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(schedule_suite);
+    GREATEST_MAIN_END();
+}
@@ -2,10 +2,13 @@
 #include "config.h"
 #include "greatest.h"
 #include "project.h"
+#include "schedule.h"
 #include "script.h"
+#include "str.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 static const char *SIMPLE_CONFIG = "name: test\n"
                                    "root: ~/projects/test\n"
@@ -62,6 +65,25 @@ TEST test_script_start_contains_windows(void) {
     PASS();
 }
 
+TEST test_script_quotes_tilde_window_names(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: tilde\n"
+                         "root: ~/\n"
+                         "windows:\n"
+                         "  - ~: echo first\n"
+                         "  - ~logs: tail -f log\n";
+    config_parse_string(&a, config, strlen(config), &p, NULL, 0);
+
+    /* Bash would expand them to home directories, which tmux then can't find */
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "-n '~' -c ~/") != NULL);
+    ASSERT(strstr(script, "-n '~logs' -c ~/") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
 TEST test_script_start_contains_attach(void) {
     Arena a = arena_new();
     Project p;
@@ -89,6 +111,505 @@ TEST test_script_start_hooks(void) {
     PASS();
 }
 
+TEST test_script_memoised_hook_records_stamp(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: memo\n"
+                         "on_project_first_start:\n"
+                         "  run: bundle install\n"
+                         "  inputs: Gemfile.lock\n"
+                         "windows:\n"
+                         "  - main: echo hi\n";
+    config_parse_string(&a, config, strlen(config), &p, NULL, 0);
+    HookOptions *h = &p.hooks[HOOK_PROJECT_FIRST_START];
+    h->digest = "0123456789abcdef";
+    h->stamp_path = "/state/stamps/memo.on_project_first_start";
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "# on_project_first_start runs: inputs changed (0123456789abcdef)\n"
+                          "bundle install\n"
+                          "mkdir -p /state/stamps && \"${MUX_BIN:-mux}\" hook-digest '' "
+                          "Gemfile.lock > /state/stamps/memo.on_project_first_start\n") != NULL);
+    free(script);
+
+    h->up_to_date = true;
+    script = script_generate_start(&p);
+    ASSERT(strstr(script, "bundle install") == NULL);
+    ASSERT(strstr(script, "# on_project_first_start skipped: inputs unchanged") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_supervised_hooks(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: modes\n"
+                         "on_project_start:\n"
+                         "  run: make deps\n"
+                         "  mode: sync\n"
+                         "  timeout: 20\n"
+                         "  inputs: Makefile\n"
+                         "on_project_first_start:\n"
+                         "  run: ./seed-db\n"
+                         "  mode: parallel\n"
+                         "on_project_restart:\n"
+                         "  run: git fetch\n"
+                         "  mode: background\n"
+                         "windows:\n"
+                         "  - main: echo hi\n";
+    config_parse_string(&a, config, strlen(config), &p, NULL, 0);
+    p.hooks[HOOK_PROJECT_RESTART].log_path = "/state/logs/modes.on_project_restart.log";
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_hook() {") != NULL);
+    ASSERT(strstr(script, "mux_hook on_project_start 20 '' 'make deps'\n") != NULL);
+    ASSERT(strstr(script, "( mux_hook on_project_first_start 0 '' ./seed-db ) &\n"
+                          "mux_hook_pids=\"$mux_hook_pids $!\"\n") != NULL);
+    ASSERT(strstr(script, "( mux_hook on_project_restart 0 "
+                          "/state/logs/modes.on_project_restart.log 'git fetch' ) "
+                          "</dev/null >/dev/null "
+                          "2>>/state/logs/modes.on_project_restart.log &\n") != NULL);
+    /* Parallel hooks are joined before attaching */
+    const char *join = strstr(script, "mux_hook_join\n");
+    ASSERT(join != NULL);
+    ASSERT(join < strstr(script, "attach-session"));
+    /* A timeout stops the hook's whole process group */
+    ASSERT(strstr(script, "kill -TERM -- \"-$pid\"") != NULL);
+    free(script);
+
+    /* A memoised sync hook stamps on a line of its own, so set -e still
+     * stops the start when the hook fails */
+    HookOptions *h = &p.hooks[HOOK_PROJECT_START];
+    h->digest = "0123456789abcdef";
+    h->stamp_path = "/state/stamps/modes.on_project_start";
+    script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_hook on_project_start 20 '' 'make deps'\n"
+                          "mkdir -p /state/stamps && \"${MUX_BIN:-mux}\" hook-digest '' "
+                          "Makefile > /state/stamps/modes.on_project_start\n") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_readiness_gates(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: gates\n"
+                         "root: /srv/app\n"
+                         "windows:\n"
+                         "  - db: postgres\n"
+                         "  - app:\n"
+                         "      panes:\n"
+                         "        - rails s\n"
+                         "        - worker:\n"
+                         "            - sidekiq\n"
+                         "          wait_for:\n"
+                         "            tcp: 6379\n"
+                         "            file: tmp/pids/server.pid\n"
+                         "            output: /Listening on/\n"
+                         "            from: db\n"
+                         "            timeout: 30\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_gate() {") != NULL);
+    /* The watched pane is piped into mux before its own commands run */
+    const char *watch = strstr(script, "printf -v mux_watch 'exec %q wait-for --timeout 30 "
+                                       "--output %q --mark %q --ignore %q' \"${MUX_BIN:-mux}\" "
+                                       "'Listening on' \"$mux_wait_dir/0\" postgres\n"
+                                       "mux_watch=${mux_watch//%/%%}\n"
+                                       "mux_watch=${mux_watch//\\#/\\#\\#}\n"
+                                       "tmux pipe-pane -o -t gates:db.$((pane_base_index+0)) "
+                                       "\"$mux_watch\"\n");
+    ASSERT(watch != NULL);
+    ASSERT(watch < strstr(script, "\"postgres\" C-m"));
+    /* Gated commands are sent from a background job */
+    ASSERT(strstr(script, "{ if mux_gate app.1 --timeout 30 --tcp 6379 --timeout 30 --file "
+                          "/srv/app/tmp/pids/server.pid --timeout 30 --file "
+                          "\"$mux_wait_dir/0\" && mux_live; then\n"
+                          "tmux send-keys -t gates:app.$((pane_base_index+1)) \"sidekiq\" C-m\n"
+                          "fi; } &\n") != NULL);
+    ASSERT(strstr(script, "tmux send-keys -t gates:app.$((pane_base_index+0)) \"rails s\" C-m\n"
+                          "tmux splitw") != NULL);
+    /* Jobs check the session is this run's, and the run directory goes once
+     * they are done; the tmux server must not hold it open */
+    const char *run =
+        strstr(script, "tmux set-option -t gates @mux_run \"$mux_run\"\n"
+                       "mux_wait_dir=$(mktemp -d \"${TMPDIR:-/tmp}/mux-wait.XXXXXX\")\n"
+                       "exec 8> >(cat >/dev/null; rm -rf -- \"$mux_wait_dir\")\n");
+    ASSERT(run != NULL);
+    ASSERT(run > strstr(script, "new-session"));
+    ASSERT(strstr(script, "mux_live() {") != NULL);
+    free(script);
+
+    /* Herdr cannot watch pane output, but still honours the other gates */
+    script = script_generate_start_herdr(&p);
+    ASSERT(strstr(script, "{ if mux_gate app.1 --timeout 30 --tcp 6379 --timeout 30 --file "
+                          "/srv/app/tmp/pids/server.pid; then\n") != NULL);
+    ASSERT(strstr(script, "pipe-pane") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_depends_on_schedules_panes(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: deps\n"
+                         "windows:\n"
+                         "  - api:\n"
+                         "      depends_on: db\n"
+                         "      panes: [./api]\n"
+                         "  - db:\n"
+                         "      ready: {tcp: 5432, timeout: 10}\n"
+                         "      panes: [postgres]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_after() {") != NULL);
+    ASSERT(strstr(script, "mux_turn") == NULL);
+    /* api waits for db, which starts at once and is up when its port opens */
+    ASSERT(strstr(script, "{ if mux_after api.0 \"$mux_wait_dir/node-1\" && mux_live; then\n"
+                          "tmux send-keys -t deps:api.$((pane_base_index+0)) \"./api\" C-m\n"
+                          "mux_up api.0 \"$mux_wait_dir/node-0\"\n"
+                          "else\n"
+                          "mux_mark down api.0 \"$mux_wait_dir/node-0\"\n"
+                          "fi; } &\n") != NULL);
+    ASSERT(strstr(script, "{\n"
+                          "tmux send-keys -t deps:db.$((pane_base_index+0)) \"postgres\" C-m\n"
+                          "mux_up db.0 \"$mux_wait_dir/node-1\" --timeout 10 --tcp 5432\n"
+                          "} &\n") != NULL);
+    free(script);
+
+    /* max_parallel queues the next pane behind the previous one's start */
+    p.windows[0].depends_on_count = 0;
+    p.max_parallel = 1;
+    ASSERT_EQ(0, schedule_resolve(&a, &p));
+    script = script_generate_start(&p);
+    ASSERT(strstr(script, "{ if mux_turn \"$mux_wait_dir/node-0\" && mux_live; then\n"
+                          "tmux send-keys -t deps:db.") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_pane_priority(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: build\n"
+                         "windows:\n"
+                         "  - editor: vim\n"
+                         "  - watchers:\n"
+                         "      nice: 10\n"
+                         "      cpu_affinity: 2-3\n"
+                         "      panes:\n"
+                         "        - webpack --watch\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    /* Applied to the pane's shell before its command is typed */
+    const char *prio =
+        strstr(script, "\"${MUX_BIN:-mux}\" priority --nice 10 --cpus 2-3 \"$(tmux "
+                       "display-message -p -t build:watchers.$((pane_base_index+0)) "
+                       "'#{pane_pid}')\" || true\n");
+    ASSERT(prio != NULL);
+    ASSERT(prio < strstr(script, "\"webpack --watch\" C-m"));
+    /* The editor pane keeps its default priority */
+    ASSERT_EQ(prio, strstr(script, "\"${MUX_BIN:-mux}\" priority"));
+    ASSERT(strstr(prio + 1, "\"${MUX_BIN:-mux}\" priority") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_lazy_windows(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "startup_window: shell\n"
+                         "windows:\n"
+                         "  - logs:\n"
+                         "      lazy: true\n"
+                         "      panes: [tail -f log]\n"
+                         "  - shell:\n"
+                         "      lazy: true\n"
+                         "      panes: [git status]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    /* The window exists at once; its commands wait in a script */
+    const char *deferred = strstr(script, "cat > \"$mux_lazy_dir/0.sh\" <<'MUX_LAZY'\n");
+    ASSERT(deferred != NULL);
+    ASSERT(deferred > strstr(script, "new-session"));
+    const char *keys =
+        strstr(script, "send-keys -t big:logs.$((pane_base_index+0)) \"tail -f log\"");
+    ASSERT(keys > deferred);
+    ASSERT(keys < strstr(script, "MUX_LAZY\ntmux set-option -w -t big:logs @mux_lazy "
+                                 "\"$mux_lazy_dir/0.sh\"\n"));
+    /* The startup window is selected straight away, so it starts as usual */
+    ASSERT(strstr(script, "1.sh") == NULL);
+    ASSERT(strstr(script, "# Window: shell\n") != NULL);
+    /* The hook goes in after every window has been created */
+    const char *hook = strstr(script, "tmux set-hook -t big session-window-changed "
+                                      "\"run-shell -b '\\\"${MUX_BIN:-mux}\\\" lazy-start "
+                                      "#{window_id}'\"\n");
+    ASSERT(hook > strstr(script, "\"git status\" C-m"));
+    free(script);
+
+    /* Stopping removes the scripts of windows that were never selected */
+    script = script_generate_stop(&p);
+    const char *clean = strstr(script, "tmux list-windows -t big -F '#{@mux_lazy}' 2>/dev/null | "
+                                       "while IFS= read -r mux_lazy; do\n");
+    ASSERT(clean != NULL);
+    ASSERT(clean < strstr(script, "kill-session"));
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_progressive_start(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "progressive: true\n"
+                         "startup_window: shell\n"
+                         "windows:\n"
+                         "  - logs: tail -f log\n"
+                         "  - shell: git status\n"
+                         "  - db: psql\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    /* The session starts with the startup window, kept at its own index */
+    ASSERT(strstr(script, "new-session -d -s big") < strstr(script, "-n shell"));
+    ASSERT(strstr(script, "tmux move-window -s big:shell -t big:$((base_index + 1))\n") != NULL);
+    const char *builder = strstr(script, "(\ntrap 'mux_built $?' EXIT\n");
+    ASSERT(builder > strstr(script, "\"git status\" C-m"));
+    ASSERT(builder > strstr(script, "select-window -t big:shell"));
+    ASSERT(builder > strstr(script, "status-right \"#[reverse] mux: starting 2 more windows"));
+    /* The rest are built detached, in the background */
+    const char *logs = strstr(script, "tmux new-window -d -t big:$((base_index + 0)) -n logs\n");
+    ASSERT(logs > builder);
+    ASSERT(strstr(script, "tmux new-window -d -t big:$((base_index + 2)) -n db\n") > logs);
+    ASSERT(strstr(script, ") </dev/null >/dev/null 2>&1 &\n") > strstr(script, "\"psql\" C-m"));
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_parallel_windows(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "windows:\n"
+                         "  - editor: vim\n"
+                         "  - logs: tail -f log\n"
+                         "  - db: psql\n"
+                         "  - jobs:\n"
+                         "      lazy: true\n"
+                         "      panes: [sidekiq]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+    p.jobs = 8;
+
+    char *script = script_generate_start(&p);
+    /* The first window is built before any worker starts */
+    const char *pool = strstr(script, "# Build the other windows in up to 3 parallel workers\n");
+    ASSERT(pool > strstr(script, "\"vim\" C-m"));
+    ASSERT(strstr(pool, "mux_lazy_dir=$(mktemp") != NULL);
+    ASSERT(strstr(script, "printf '...' >&9\n") > pool);
+    const char *logs = strstr(script, "read -r -n 1 -u 9 _\n(\ntrap 'printf . >&9' EXIT\n\n"
+                                      "# Window: logs\n"
+                                      "tmux new-window -d -t big:$((base_index + 1)) -n logs\n");
+    ASSERT(logs > pool);
+    ASSERT(strstr(logs, "\"tail -f log\" C-m\n) &\nmux_workers+=($!)\n") != NULL);
+    ASSERT(strstr(script, "-n db\n") > logs);
+    /* The join comes before the startup selection and the lazy hook */
+    const char *join = strstr(script, "  wait \"$mux_worker\" || mux_failed=1\n");
+    ASSERT(join > strstr(script, "sidekiq"));
+    ASSERT(strstr(script, "select-window -t big:editor") > join);
+    ASSERT(strstr(script, "session-window-changed") > join);
+    free(script);
+
+    /* One window leaves nothing to build in parallel */
+    p.window_count = 1;
+    script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_workers") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_prewarm_claims_pooled_windows(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "root: /src/big\n"
+                         "prewarm: 2\n"
+                         "windows:\n"
+                         "  - editor: vim\n"
+                         "  - logs: tail -f log\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_claim() {\n") != NULL);
+    /* The session's own first window is swapped for a warm one */
+    const char *first = strstr(script, "mux_claim big:editor editor /src/big -k || true\n");
+    ASSERT(first > strstr(script, "new-session -d -s big"));
+    /* Other windows are only created when the pool is empty */
+    const char *logs = strstr(script, "if ! mux_claim big: logs /src/big; then\n"
+                                      "tmux new-window -t big -n logs -c /src/big\nfi\n");
+    ASSERT(logs > first);
+    const char *refill = strstr(script, "( mux_pool_fill 2 ) </dev/null >/dev/null 2>&1 &\n");
+    ASSERT(refill > strstr(script, "\"tail -f log\" C-m"));
+    free(script);
+
+    script = script_generate_prewarm(&p);
+    ASSERT(strstr(script, "tmux new-window -d -t =_mux_pool: -n mux-pool\n") != NULL);
+    /* A pool made by a refill running at the same time is counted */
+    ASSERT(strstr(script, "  if tmux has-session -t =_mux_pool 2>/dev/null ||\n"
+                          "     ! tmux new-session -d -s _mux_pool -n mux-pool 2>/dev/null; then\n"
+                          "    have=$(tmux list-windows -t =_mux_pool -F . | wc -l)\n"
+                          "  fi\n") != NULL);
+    ASSERT(strstr(script, "\nmux_pool_fill 2\n") != NULL);
+    free(script);
+
+    /* Without prewarm the pool is never consulted */
+    config_parse_string(&a, SIMPLE_CONFIG, strlen(SIMPLE_CONFIG), &p, NULL, 0);
+    script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_claim") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_exec_panes(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "windows:\n"
+                         "  - logs:\n"
+                         "      exec: true\n"
+                         "      pre: cd log\n"
+                         "      panes: [tail -f dev.log]\n"
+                         "  - app:\n"
+                         "      panes:\n"
+                         "        - vim\n"
+                         "        - server: [rails s]\n"
+                         "          exec: true\n"
+                         "  - jobs:\n"
+                         "      lazy: true\n"
+                         "      exec: true\n"
+                         "      panes: [sidekiq]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    /* The command is the pane's process, kept once it exits */
+    ASSERT(strstr(script, "-n logs 'cd log; tail -f dev.log' \\; "
+                          "set-option -p -t big:logs remain-on-exit on\n") != NULL);
+    ASSERT(strstr(script, "tmux splitw -t big:app -h -p 50 'rails s' \\; "
+                          "set-option -p -t big:app remain-on-exit on\n") != NULL);
+    ASSERT(strstr(script, "\"tail -f dev.log\" C-m") == NULL);
+    ASSERT(strstr(script, "\"rails s\" C-m") == NULL);
+    ASSERT(strstr(script, "\"vim\" C-m") != NULL);
+    ASSERT(strstr(script, "set-hook -t big pane-died") != NULL);
+    /* A lazy window runs it when first selected */
+    ASSERT(strstr(script, "tmux new-window -t big -n jobs\n") != NULL);
+    ASSERT(strstr(script, "respawn-pane -k -t big:jobs.$((pane_base_index+0)) sidekiq") >
+           strstr(script, "<<'MUX_LAZY'"));
+    free(script);
+
+    script = script_generate_start_herdr(&p);
+    ASSERT(strstr(script, "pane send-text \"$pane_0_0\" "
+                          "'exec \"$SHELL\" -c '\\''cd log; tail -f dev.log'\\'''") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_signals(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "socket_name: work\n"
+                         "windows:\n"
+                         "  - db:\n"
+                         "      panes:\n"
+                         "        - migrate: [rake db:migrate]\n"
+                         "          signal: migrated\n"
+                         "        - seed: [rake db:seed]\n"
+                         "          exec: true\n"
+                         "          signal: seeded\n"
+                         "  - app:\n"
+                         "      wait_for: [{signal: migrated}, {signal: seeded}]\n"
+                         "      panes: [rails s]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    /* Channels belong to this run and gates reach the project's server */
+    ASSERT(strstr(script, "mux_run=\"$$-$RANDOM\"\nexport MUX_TMUX='tmux -L work'\n") != NULL);
+    /* Typed after the pane's commands, so it fires once they are done */
+    const char *migrate = strstr(script, "\"rake db:migrate\" C-m\n");
+    ASSERT(migrate != NULL);
+    ASSERT(strstr(script, "send-keys -t big:db.$((pane_base_index+0)) "
+                          "\"tmux wait-for -S mux-$mux_run-migrated\" C-m\n") > migrate);
+    ASSERT(strstr(script, "'rake db:seed'\"; tmux wait-for -S mux-$mux_run-seeded\" \\; ") !=
+           NULL);
+    ASSERT(strstr(script, "mux_gate app.0 --timeout 60 --signal \"mux-$mux_run-migrated\" "
+                          "--timeout 60 --signal \"mux-$mux_run-seeded\" && mux_live; "
+                          "then\n") != NULL);
+    free(script);
+
+    /* Herdr has no wait-for channels */
+    script = script_generate_start_herdr(&p);
+    ASSERT(strstr(script, "wait-for -S") == NULL);
+    ASSERT(strstr(script, "--signal") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_pastes_large_payloads(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big\n"
+                         "windows:\n"
+                         "  - db:\n"
+                         "      panes:\n"
+                         "        - |\n"
+                         "          psql <<'SQL'\n"
+                         "          select \"$x\";\n"
+                         "          SQL\n"
+                         "        - ls\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "printf '%s' 'psql <<'\\''SQL'\\''\nselect \"$x\";\nSQL\n' | "
+                          "tmux load-buffer -b \"mux-$$-\"db.0 -\n"
+                          "tmux paste-buffer -d -p -b \"mux-$$-\"db.0 "
+                          "-t big:db.$((pane_base_index+0))\n"
+                          "tmux send-keys -t big:db.$((pane_base_index+0)) C-m\n") != NULL);
+    /* Short one-line commands are still typed */
+    ASSERT(strstr(script, "send-keys -t big:db.$((pane_base_index+1)) \"ls\" C-m\n") != NULL);
+    ASSERT(strstr(script, "db.1 -") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_inline_hooks_have_no_helpers(void) {
+    Arena a = arena_new();
+    Project p;
+    config_parse_string(&a, HOOKS_CONFIG, strlen(HOOKS_CONFIG), &p, NULL, 0);
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "mux_hook") == NULL);
+    ASSERT(strstr(script, "mux_gate") == NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
 TEST test_script_start_multi_pane(void) {
     Arena a = arena_new();
     Project p;
@@ -97,8 +618,8 @@ TEST test_script_start_multi_pane(void) {
     char *script = script_generate_start(&p);
     /* Should have splitw for second and third panes */
     ASSERT(strstr(script, "splitw") != NULL);
-    ASSERT(strstr(script, "select-layout") != NULL);
-    ASSERT(strstr(script, "main-vertical") != NULL);
+    /* tmux sizes the main pane from its main-pane-width option */
+    ASSERT(strstr(script, "select-layout -t multi:work main-vertical\n") != NULL);
     free(script);
     arena_free(&a);
     PASS();
@@ -131,14 +652,164 @@ TEST test_script_start_normalizes_empty_tmux_indices(void) {
     PASS();
 }
 
-TEST test_script_start_tiles_after_splitting_panes(void) {
+TEST test_script_applies_saved_layouts(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: big app\n"
+                         "windows:\n"
+                         "  - code:\n"
+                         "      layout: main-vertical\n"
+                         "      panes: [vim, guard]\n"
+                         "  - logs: {panes: [tail -f a, tail -f b]}\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char state_dir[] = "/tmp/mux-layout-test-XXXXXX";
+    ASSERT(mkdtemp(state_dir) != NULL);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/layouts", state_dir);
+    ASSERT_EQ(0, mkdir(path, 0755));
+    snprintf(path, sizeof(path), "%s/layouts/big_app", state_dir);
+    FILE *f = fopen(path, "w");
+    ASSERT(f != NULL);
+    fputs("2 b25d,80x24,0,0{20x24,0,0,1,59x24,21,0,2} code\n"
+          "3 1e7f,80x24,0,0[80x8,0,0,3,80x7,0,9,4,80x7,0,17,5] logs\n",
+          f);
+    fclose(f);
+
+    project_load_layouts(&a, &p, state_dir);
+    ASSERT_STR_EQ(path, p.layout_cache);
+    ASSERT_STR_EQ("b25d,80x24,0,0{20x24,0,0,1,59x24,21,0,2}", p.windows[0].saved_layout);
+    /* logs has lost a pane since */
+    ASSERT_EQ(NULL, p.windows[1].saved_layout);
+
+    char *script = script_generate_start(&p);
+    ASSERT(strstr(script, "select-layout -t 'big app':code "
+                          "'b25d,80x24,0,0{20x24,0,0,1,59x24,21,0,2}'\n") != NULL);
+    ASSERT(strstr(script, "select-layout -t 'big app':logs 'd62a,") != NULL);
+    free(script);
+
+    script = script_generate_layout_save(&p);
+    ASSERT(strstr(script, "mux_layouts=$(tmux list-windows -t 'big app' "
+                          "-F '#{window_panes} #{window_layout} #{window_name}'") != NULL);
+    ASSERT(strstr(script, "printf '%s\\n' \"$mux_layouts\" > ") != NULL);
+    free(script);
+
+    snprintf(path, sizeof(path), "rm -rf '%s'", state_dir);
+    ASSERT_EQ(0, system(path));
+    arena_free(&a);
+    PASS();
+}
+
+TEST test_script_start_lays_out_panes_once(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: multi\n"
+                         "windows:\n"
+                         "  - work: {panes: [vim, guard, top]}\n"
+                         "  - split:\n"
+                         "      layout: {rows: [3, {columns: [1, 1]}]}\n"
+                         "      panes: [vim, guard, top]\n"
+                         "  - custom:\n"
+                         "      layout: spiral\n"
+                         "      panes: [vim, top]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start(&p);
+    /* Each split leaves the newest pane its share, and the window is tiled once */
+    ASSERT(strstr(script, "tmux splitw -t multi:work -h -p 66\n") != NULL);
+    ASSERT(strstr(script, "tmux splitw -t multi:work -h -p 50\n") != NULL);
+    const char *tiled = "select-layout -t multi:work "
+                        "'56f7,120x40,0,0[120x19,0,0{59x19,0,0,0,60x19,60,0,1},120x20,0,20,2]'";
+    ASSERT(strstr(script, tiled) != NULL);
+    ASSERT(strstr(strstr(script, tiled) + 1, "select-layout -t multi:work") == NULL);
+    ASSERT(strstr(script, " tiled\n") == NULL);
+    /* Split specs share the window by weight; other layouts go to tmux as given */
+    ASSERT(strstr(script, "select-layout -t multi:split '158d,120x40,0,0"
+                          "[120x29,0,0,0,120x10,0,30{59x10,0,30,1,60x10,60,30,2}]'") != NULL);
+    ASSERT(strstr(script, "select-layout -t multi:custom spiral\n") != NULL);
+    free(script);
+
+    /* The layout follows the size the session is created at */
+    setenv("MUX_TMUX_COLUMNS", "40", 1);
+    setenv("MUX_TMUX_LINES", "100", 1);
+    script = script_generate_start(&p);
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
+    ASSERT(strstr(script, "tmux splitw -t multi:work -v -p 66\n") != NULL);
+    ASSERT(strstr(script, "select-layout -t multi:work '") != NULL);
+    ASSERT(strstr(script, ",40x100,0,0[") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
+/* Replay a window's splits the way tmux sizes them, from a sx by sy window.
+ * Returns the number of panes made, which stops short when a pane has no
+ * room left to split. */
+static int replay_splits(const char *script, const char *target, int sx, int sy) {
+    char split[64], tile[64];
+    snprintf(split, sizeof(split), "splitw -t %s ", target);
+    snprintf(tile, sizeof(tile), "select-layout -t %s tiled\n", target);
+    int panes = 1, cw = sx, ch = sy;
+    for (const char *line = script; line && *line; line = strchr(line, '\n')) {
+        if (*line == '\n') line++;
+        const char *end = strchr(line, '\n');
+        const char *at = strstr(line, tile);
+        if (at && (!end || at < end)) {
+            int rows = 1, columns = 1;
+            while (rows * columns < panes) {
+                rows++;
+                if (rows * columns < panes) columns++;
+            }
+            cw = (sx - (columns - 1)) / columns;
+            ch = (sy - (rows - 1)) / rows;
+            continue;
+        }
+        at = strstr(line, split);
+        if (!at || (end && at > end)) continue;
+        char axis;
+        int percent;
+        if (sscanf(at + strlen(split), "-%c -p %d", &axis, &percent) != 2) return panes;
+        int *side = axis == 'h' ? &cw : &ch;
+        if (*side < 3) return panes;
+        int size = *side * percent / 100;
+        if (size > *side - 2) size = *side - 2;
+        *side = size < 1 ? 1 : size;
+        panes++;
+    }
+    return panes;
+}
+
+/* A project with one window of n panes */
+static int parse_dense_window(Arena *a, Project *p, int n) {
+    Str config = str_new();
+    str_append(&config, "name: big\nwindows:\n  - work:\n      panes:\n");
+    for (int i = 0; i < n; i++) str_append(&config, "        - top\n");
+    int rc = config_parse_string(a, str_cstr(&config), config.len, p, NULL, 0);
+    str_free(&config);
+    return rc;
+}
+
+TEST test_script_splits_dense_windows(void) {
     Arena a = arena_new();
     Project p;
-    config_parse_string(&a, MULTI_PANE_CONFIG, strlen(MULTI_PANE_CONFIG), &p, NULL, 0);
 
+    /* Splitting along one side only ran out of room at 43 of 45 panes */
+    ASSERT_EQ(0, parse_dense_window(&a, &p, 45));
     char *script = script_generate_start(&p);
-    ASSERT(strstr(script, "splitw -t multi:work") != NULL);
-    ASSERT(strstr(script, "select-layout -t multi:work tiled") != NULL);
+    ASSERT_EQ(45, replay_splits(script, "big:work", 120, 40));
+    ASSERT(strstr(script, " tiled\n") == NULL);
+    free(script);
+
+    /* More panes than splitting leaves room for are tiled on the way */
+    ASSERT_EQ(0, parse_dense_window(&a, &p, 150));
+    setenv("MUX_TMUX_COLUMNS", "80", 1);
+    setenv("MUX_TMUX_LINES", "24", 1);
+    script = script_generate_start(&p);
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
+    ASSERT_EQ(150, replay_splits(script, "big:work", 80, 24));
+    ASSERT(strstr(script, "tmux select-layout -t big:work tiled\n") != NULL);
     free(script);
     arena_free(&a);
     PASS();
@@ -153,9 +824,10 @@ TEST test_script_herdr_maps_windows_to_workspace_tabs_and_panes(void) {
     ASSERT(script != NULL);
     ASSERT(strstr(script, "workspace create --focus --cwd ~/ --label multi") != NULL);
     ASSERT(strstr(script, "tab rename \"$tab_0\" work") != NULL);
-    ASSERT(strstr(script, "pane split \"$pane_0_0\" --direction right --ratio 0.333333 --focus") !=
+    /* main-vertical: the main pane beside the others, which are stacked */
+    ASSERT(strstr(script, "pane split \"$pane_0_0\" --direction right --ratio 0.669421 --focus") !=
            NULL);
-    ASSERT(strstr(script, "pane split \"$pane_0_1\" --direction right --ratio 0.500000 --focus") !=
+    ASSERT(strstr(script, "pane split \"$pane_0_1\" --direction down --ratio 0.487805 --focus") !=
            NULL);
     ASSERT(strstr(script, "pane send-text \"$pane_0_0\" vim") != NULL);
     ASSERT(strstr(script, "pane send-text \"$pane_0_1\" guard") != NULL);
@@ -165,6 +837,40 @@ TEST test_script_herdr_maps_windows_to_workspace_tabs_and_panes(void) {
     PASS();
 }
 
+TEST test_script_herdr_splits_along_layout_tree(void) {
+    Arena a = arena_new();
+    Project p;
+    const char *config = "name: multi\n"
+                         "windows:\n"
+                         "  - even:\n"
+                         "      layout: even-horizontal\n"
+                         "      panes: [a, b, c]\n"
+                         "  - custom:\n"
+                         "      layout: 8x6,0,0[8x3,0,0{4x3,0,0,1,3x3,5,0,2},8x2,0,4,3]\n"
+                         "      panes: [a, b, c]\n"
+                         "  - odd:\n"
+                         "      layout: spiral\n"
+                         "      panes: [a, b]\n";
+    ASSERT_EQ(0, config_parse_string(&a, config, strlen(config), &p, NULL, 0));
+
+    char *script = script_generate_start_herdr(&p);
+    ASSERT(strstr(script, "pane split \"$pane_0_0\" --direction right --ratio 0.330579") != NULL);
+    ASSERT(strstr(script, "pane split \"$pane_0_1\" --direction right --ratio 0.493827") != NULL);
+    /* The top row is split off first, then its two columns */
+    const char *rows = strstr(script, "split_json_1_2=$(\"$herdr_cmd\" pane split \"$pane_1_0\" "
+                                      "--direction down --ratio 0.571429");
+    const char *cols = strstr(script, "split_json_1_1=$(\"$herdr_cmd\" pane split \"$pane_1_0\" "
+                                      "--direction right --ratio 0.555556");
+    ASSERT(rows != NULL);
+    ASSERT(cols > rows);
+    ASSERT(strstr(script, "pane send-text \"$pane_1_2\" c") > cols);
+    /* Names tmux would have to interpret keep the old chain */
+    ASSERT(strstr(script, "pane split \"$pane_2_0\" --direction down --ratio 0.500000") != NULL);
+    free(script);
+    arena_free(&a);
+    PASS();
+}
+
 TEST test_script_herdr_reports_bad_json_without_python_traceback(void) {
     Arena a = arena_new();
     Project p;
@@ -435,8 +1141,8 @@ TEST test_script_sample_comprehensive(void) {
     /* pre_window command in send-keys */
     ASSERT(strstr(script, "rbenv shell 2.0.0-p247") != NULL);
     /* Window layout */
-    ASSERT(strstr(script, "main-vertical") != NULL);
-    ASSERT(strstr(script, "tiled") != NULL);
+    ASSERT(strstr(script, "select-layout -t sample:editor main-vertical\n") != NULL);
+    ASSERT(strstr(script, "select-layout -t sample:guard '") != NULL);
     /* Multiple windows created */
     ASSERT(strstr(script, "new-window") != NULL);
     /* Pane splits */
@@ -449,13 +1155,30 @@ TEST test_script_sample_comprehensive(void) {
 SUITE(script_suite) {
     RUN_TEST(test_script_start_contains_session);
     RUN_TEST(test_script_start_contains_windows);
+    RUN_TEST(test_script_quotes_tilde_window_names);
     RUN_TEST(test_script_start_contains_attach);
     RUN_TEST(test_script_start_hooks);
+    RUN_TEST(test_script_memoised_hook_records_stamp);
+    RUN_TEST(test_script_supervised_hooks);
+    RUN_TEST(test_script_readiness_gates);
+    RUN_TEST(test_script_depends_on_schedules_panes);
+    RUN_TEST(test_script_pane_priority);
+    RUN_TEST(test_script_lazy_windows);
+    RUN_TEST(test_script_progressive_start);
+    RUN_TEST(test_script_parallel_windows);
+    RUN_TEST(test_script_prewarm_claims_pooled_windows);
+    RUN_TEST(test_script_exec_panes);
+    RUN_TEST(test_script_signals);
+    RUN_TEST(test_script_pastes_large_payloads);
+    RUN_TEST(test_script_inline_hooks_have_no_helpers);
     RUN_TEST(test_script_start_multi_pane);
     RUN_TEST(test_script_start_is_valid_bash);
     RUN_TEST(test_script_start_normalizes_empty_tmux_indices);
-    RUN_TEST(test_script_start_tiles_after_splitting_panes);
+    RUN_TEST(test_script_start_lays_out_panes_once);
+    RUN_TEST(test_script_splits_dense_windows);
+    RUN_TEST(test_script_applies_saved_layouts);
     RUN_TEST(test_script_herdr_maps_windows_to_workspace_tabs_and_panes);
+    RUN_TEST(test_script_herdr_splits_along_layout_tree);
     RUN_TEST(test_script_herdr_reports_bad_json_without_python_traceback);
     RUN_TEST(test_script_herdr_starts_server_when_missing);
     RUN_TEST(test_script_herdr_stop_closes_matching_workspace);
@@ -481,6 +1204,9 @@ GREATEST_MAIN_DEFS();
 
 int main(int argc, char **argv) {
     GREATEST_MAIN_BEGIN();
+    /* Layouts are worked out for the window size these set */
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
     RUN_SUITE(script_suite);
     RUN_SUITE(script_fixture_suite);
     GREATEST_MAIN_END();
@@ -123,6 +123,9 @@ GREATEST_MAIN_DEFS();
 
 int main(int argc, char **argv) {
     GREATEST_MAIN_BEGIN();
+    /* Layouts are worked out for the window size these set */
+    unsetenv("MUX_TMUX_COLUMNS");
+    unsetenv("MUX_TMUX_LINES");
     RUN_SUITE(script_regression_suite);
     GREATEST_MAIN_END();
 }
@@ -0,0 +1,259 @@
+#include "greatest.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Start every fixture with the built mux against stand-ins for tmux, wemux,
+ * herdr, python3 and bash that log each call, and hold each fixture to a
+ * budget of process spawns per backend. When an optimisation lowers a
+ * count, lower its budget with it. */
+
+#define FIXTURE_DIR "tests/fixtures"
+
+typedef struct {
+    const char *fixture;
+    int tmux; /* tmux or wemux calls on the tmux backend */
+    int herdr;
+    int python3; /* on the Herdr backend */
+} SpawnBudget;
+
+static const SpawnBudget budgets[] = {
+    {"detach", 29, 40, 12},
+    {"focused_pane", 26, 24, 9},
+    {"hooks", 10, 7, 4},
+    {"nameless_window", 12, 10, 6},
+    {"noroot", 10, 7, 4},
+    {"nowindows", 9, 5, 4},
+    {"pane_titles", 20, 16, 6},
+    {"sample", 56, 83, 25},
+    {"sample_deprecations", 37, 45, 24},
+    {"sample_emoji_as_name", 10, 7, 4},
+    {"sample_literals_as_window_name", 20, 22, 14},
+    {"sample_number_as_name", 10, 7, 4},
+    {"sample_wemux", 27, 34, 12},
+    {"socket", 10, 7, 4},
+    {"startup", 21, 21, 10},
+    {"synchronize", 27, 25, 12},
+    {"template", 10, 7, 4},
+    {"window_root", 14, 13, 8},
+};
+#define BUDGET_COUNT ((int)(sizeof(budgets) / sizeof(budgets[0])))
+
+typedef struct {
+    int tmux;
+    int herdr;
+    int python3;
+    int bash;
+    int other;
+} SpawnCounts;
+
+/* No session exists yet, options read as 0 and every command works */
+static const char *TMUX_SHIM = "echo %s >> \"$MUX_SPAWN_LOG\"\n"
+                               "for arg; do\n"
+                               "  case $arg in\n"
+                               "    has-session) exit 1 ;;\n"
+                               "    show-option|show-options) echo 0; exit 0 ;;\n"
+                               "    display-message) echo 1; exit 0 ;;\n"
+                               "  esac\n"
+                               "done\n";
+
+/* A running server with no workspaces, and a fresh id for every tab and
+ * pane */
+static const char *HERDR_SHIM =
+    "echo %s >> \"$MUX_SPAWN_LOG\"\n"
+    "n=$(wc -l < \"$MUX_SPAWN_LOG\")\n"
+    "case \"$1 $2\" in\n"
+    "  'status server') echo 'status: running' ;;\n"
+    "  'workspace list') echo '{\"result\": {\"workspaces\": []}}' ;;\n"
+    "  'workspace create') echo '{\"result\": {\"workspace\": {\"workspace_id\": \"w1\", "
+    "\"tab_id\": \"t1\", \"pane_id\": \"p1\"}}}' ;;\n"
+    "  'tab create') echo \"{\\\"result\\\": {\\\"tab\\\": {\\\"tab_id\\\": \\\"t$n\\\", "
+    "\\\"pane_id\\\": \\\"p$n\\\"}}}\" ;;\n"
+    "  'pane split') echo \"{\\\"result\\\": {\\\"pane\\\": {\\\"pane_id\\\": \\\"p$n\\\"}}}\" "
+    ";;\n"
+    "  *) echo '{\"result\": {}}' ;;\n"
+    "esac\n";
+
+/* Reads the JSON on stdin and prints the string value of the key named by
+ * the last argument. The workspace lookup finds nothing. */
+static const char *PYTHON3_SHIM =
+    "echo %s >> \"$MUX_SPAWN_LOG\"\n"
+    "input=$(cat)\n"
+    "case $2 in *workspaces*) exit 0 ;; esac\n"
+    "for key; do :; done\n"
+    "printf '%%s\\n' \"$input\" | sed -n \"s/.*\\\"$key\\\": \\\"\\([^\\\"]*\\)\\\".*/\\1/p\"\n";
+
+static const char *BASH_SHIM = "echo %s >> \"$MUX_SPAWN_LOG\"\n"
+                               "exec '%s' \"$@\"\n";
+
+static char tmpdir[64];
+static char bash_path[4096];
+
+static void make_tmpdir(void) {
+    snprintf(tmpdir, sizeof(tmpdir), "/tmp/mux-spawn-test-XXXXXX");
+    if (!mkdtemp(tmpdir)) tmpdir[0] = '\0';
+}
+
+static void remove_tmpdir(void) {
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmpdir);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", tmpdir);
+}
+
+/* The real bash, found before the shims go first on PATH */
+static int find_bash(void) {
+    const char *path = getenv("PATH");
+    while (path && *path) {
+        const char *end = strchr(path, ':');
+        int len = end ? (int)(end - path) : (int)strlen(path);
+        snprintf(bash_path, sizeof(bash_path), "%.*s/bash", len, path);
+        if (len > 0 && access(bash_path, X_OK) == 0) return 0;
+        path = end ? end + 1 : NULL;
+    }
+    return -1;
+}
+
+static int write_shim(const char *name, const char *body, const char *arg) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", tmpdir, name);
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fputs("#!/bin/sh\n", f);
+    fprintf(f, body, name, arg);
+    fclose(f);
+    return chmod(path, 0755);
+}
+
+static int write_shims(void) {
+    if (write_shim("tmux", TMUX_SHIM, NULL) != 0) return -1;
+    if (write_shim("wemux", TMUX_SHIM, NULL) != 0) return -1;
+    if (write_shim("herdr", HERDR_SHIM, NULL) != 0) return -1;
+    if (write_shim("python3", PYTHON3_SHIM, NULL) != 0) return -1;
+    return write_shim("bash", BASH_SHIM, bash_path);
+}
+
+/* Start fixture on backend with the shims first on PATH and count the
+ * calls they log. Returns mux's exit status. */
+static int run_fixture(const char *mux, const char *fixture, const char *backend,
+                       SpawnCounts *counts) {
+    char log[128];
+    snprintf(log, sizeof(log), "%s/spawns.log", tmpdir);
+    FILE *f = fopen(log, "w");
+    if (f) fclose(f);
+
+    char cmd[8192];
+    snprintf(cmd, sizeof(cmd),
+             "env -u TMUX -u TMUX_PANE -u MUX_HERDR_COMMAND -u XDG_STATE_HOME "
+             "PATH='%s':\"$PATH\" HOME='%s' MUX_BACKEND=%s MUX_SPAWN_LOG='%s' "
+             "'%s' start -p '%s/%s.yml' > /dev/null 2>&1",
+             tmpdir, tmpdir, backend, log, mux, FIXTURE_DIR, fixture);
+    int status = system(cmd);
+
+    memset(counts, 0, sizeof(*counts));
+    f = fopen(log, "r");
+    if (!f) return -1;
+    char line[64];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strcmp(line, "tmux") == 0 || strcmp(line, "wemux") == 0) {
+            counts->tmux++;
+        } else if (strcmp(line, "herdr") == 0) {
+            counts->herdr++;
+        } else if (strcmp(line, "python3") == 0) {
+            counts->python3++;
+        } else if (strcmp(line, "bash") == 0) {
+            counts->bash++;
+        } else {
+            counts->other++;
+        }
+    }
+    fclose(f);
+    return status == 0 ? 0 : -1;
+}
+
+static const SpawnBudget *find_budget(const char *fixture) {
+    for (int i = 0; i < BUDGET_COUNT; i++) {
+        if (strcmp(budgets[i].fixture, fixture) == 0) return &budgets[i];
+    }
+    return NULL;
+}
+
+TEST test_every_fixture_has_a_budget(void) {
+    DIR *dir = opendir(FIXTURE_DIR);
+    ASSERT(dir != NULL);
+    struct dirent *e;
+    int fixtures = 0;
+    while ((e = readdir(dir)) != NULL) {
+        size_t len = strlen(e->d_name);
+        if (len < 5 || strcmp(e->d_name + len - 4, ".yml") != 0) continue;
+        char name[256];
+        snprintf(name, sizeof(name), "%.*s", (int)(len - 4), e->d_name);
+        if (!find_budget(name)) {
+            closedir(dir);
+            FAILm(e->d_name);
+        }
+        fixtures++;
+    }
+    closedir(dir);
+    ASSERT_EQ(BUDGET_COUNT, fixtures);
+    PASS();
+}
+
+TEST test_spawns_within_budget(const char *mux, const char *backend) {
+    int herdr = strcmp(backend, "herdr") == 0;
+    for (int i = 0; i < BUDGET_COUNT; i++) {
+        const SpawnBudget *b = &budgets[i];
+        SpawnCounts c;
+        if (run_fixture(mux, b->fixture, backend, &c) != 0) {
+            fprintf(stderr, "%s on %s: mux start failed\n", b->fixture, backend);
+            FAIL();
+        }
+        int tmux = herdr ? 0 : b->tmux;
+        int herdrs = herdr ? b->herdr : 0;
+        int python3 = herdr ? b->python3 : 0;
+        if (c.tmux > tmux || c.herdr > herdrs || c.python3 > python3 || c.bash > 1 ||
+            c.other > 0) {
+            fprintf(stderr,
+                    "%s on %s: %d tmux, %d herdr, %d python3, %d bash; "
+                    "the budget is %d, %d, %d, 1\n",
+                    b->fixture, backend, c.tmux, c.herdr, c.python3, c.bash, tmux, herdrs,
+                    python3);
+            FAIL();
+        }
+        /* The shims answered: the start got as far as making panes */
+        ASSERT_EQ(1, c.bash);
+        ASSERT(herdr ? c.herdr > 0 : c.tmux > 0);
+    }
+    PASS();
+}
+
+SUITE(spawn_budget_suite) {
+    RUN_TEST(test_every_fixture_has_a_budget);
+
+    /* Meson points MUX_BIN at the mux it built */
+    const char *mux = getenv("MUX_BIN");
+    if (!mux || !mux[0] || access(mux, X_OK) != 0) {
+        fprintf(stderr, "MUX_BIN is not set to a mux binary; skipping the spawn budgets\n");
+        return;
+    }
+    make_tmpdir();
+    if (!tmpdir[0] || find_bash() != 0 || write_shims() != 0) {
+        fprintf(stderr, "could not set up the shims\n");
+        exit(1);
+    }
+    RUN_TESTp(test_spawns_within_budget, mux, "tmux");
+    RUN_TESTp(test_spawns_within_budget, mux, "herdr");
+    remove_tmpdir();
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(spawn_budget_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,97 @@
+#include "arena.h"
+#include "greatest.h"
+#include "stats.h"
+#include "str.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TEST test_stats_arena(void) {
+    StatsCounts before = stats_counts;
+    size_t live = stats_arena_live;
+    Arena a = arena_new();
+    arena_alloc(&a, 5);
+    StatsCounts c = stats_since(&before);
+    ASSERT_EQ(1, c.arena_blocks);
+    ASSERT_EQ(ARENA_BLOCK_SIZE, c.arena_block_bytes);
+    ASSERT_EQ(5, c.arena_requested);
+    ASSERT_EQ(8, c.arena_used);
+    ASSERT_EQ(0, c.arena_wasted);
+    ASSERT_EQ(live + ARENA_BLOCK_SIZE, stats_arena_live);
+    ASSERT(stats_arena_peak >= stats_arena_live);
+
+    /* Too big for what is left, so the rest of the first block is wasted */
+    arena_alloc(&a, ARENA_BLOCK_SIZE);
+    c = stats_since(&before);
+    ASSERT_EQ(2, c.arena_blocks);
+    ASSERT_EQ(ARENA_BLOCK_SIZE - 8, c.arena_wasted);
+
+    arena_free(&a);
+    ASSERT_EQ(live, stats_arena_live);
+    PASS();
+}
+
+TEST test_stats_str(void) {
+    StatsCounts before = stats_counts;
+    Str s = str_new();
+    StatsCounts c = stats_since(&before);
+    ASSERT_EQ(1, c.str_grows);
+    ASSERT_EQ(0, c.str_copied);
+
+    char text[100];
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    str_append(&s, "abc");
+    str_append(&s, text);
+    c = stats_since(&before);
+    ASSERT_EQ(2, c.str_grows);
+    /* "abc" and its terminator moved with the buffer */
+    ASSERT_EQ(4, c.str_copied);
+    str_free(&s);
+    PASS();
+}
+
+TEST test_stats_phases(void) {
+    setenv("MUX_STATS", "1", 1);
+    stats_start_from_env();
+    ASSERT(stats_enabled());
+    trace_begin("outer");
+    Arena a = arena_new();
+    trace_begin("inner");
+    arena_alloc(&a, 100);
+    trace_end();
+    trace_end();
+    arena_free(&a);
+
+    StatsCounts total = stats_counts;
+    Str out = str_new();
+    stats_format(&out, &total);
+    const char *table = str_cstr(&out);
+    ASSERT(strstr(table, "\nouter ") != NULL);
+    ASSERT(strstr(table, "\n  inner                             100        104       0 ") !=
+           NULL);
+    ASSERT(strstr(table, "\ntotal ") != NULL);
+    ASSERT(strstr(table, "arena peak: ") != NULL);
+    str_free(&out);
+
+    setenv("MUX_STATS", "0", 1);
+    stats_start_from_env();
+    ASSERT_FALSE(stats_enabled());
+    unsetenv("MUX_STATS");
+    PASS();
+}
+
+SUITE(stats_suite) {
+    RUN_TEST(test_stats_arena);
+    RUN_TEST(test_stats_str);
+    RUN_TEST(test_stats_phases);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(stats_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,121 @@
+#include "greatest.h"
+#include "shell.h"
+#include "str.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static char events[] = "/tmp/mux-trace-test-XXXXXX";
+
+/* An EPOCHREALTIME value, us microseconds after the epoch */
+static void epoch(char *buf, size_t size, long long us) {
+    snprintf(buf, size, "%lld.%06lld", us / 1000000, us % 1000000);
+}
+
+TEST test_trace_wrappers(void) {
+    const char *programs[] = {"tmux", "/opt/herdr/bin/herdr", "tmux -2"};
+    Str s = str_new();
+    trace_append_wrappers(&s, programs, 3);
+    const char *script = str_cstr(&s);
+    ASSERT(strstr(script, "tmux() { mux_trace_run tmux \"$@\"; }\n") != NULL);
+    ASSERT(strstr(script, "/opt/herdr/bin/herdr() { mux_trace_run /opt/herdr/bin/herdr") != NULL);
+    /* Not a command word, so not wrapped */
+    ASSERT(strstr(script, "tmux -2()") == NULL);
+    ASSERT(strstr(script, ">>\"${MUX_TRACE_EVENTS:-/dev/null}\"") != NULL);
+    str_free(&s);
+    PASS();
+}
+
+TEST test_trace_phases_and_commands(void) {
+    trace_start();
+    ASSERT(trace_enabled());
+    trace_begin("outer");
+    trace_begin("inner");
+    trace_end();
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long now = (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    char t0[32], t1[32], t2[32];
+    epoch(t0, sizeof(t0), now);
+    epoch(t1, sizeof(t1), now + 1500);
+    epoch(t2, sizeof(t2), now + 4000);
+    FILE *f = fopen(events, "w");
+    ASSERT(f != NULL);
+    fprintf(f, "%s\t%s\t100\t0\tmux-script-start\n", t0, t0);
+    fprintf(f, "%s\t%s\t100\t0\ttmux -L work -f /x.conf new-session -d -s \"work\"\n", t0, t1);
+    fprintf(f, "%s\t%s\t101\t1\therdr --json pane split p1 --direction right\n", t1, t2);
+    /* Without bash 5 there are no times */
+    fprintf(f, "\t\t100\t0\ttmux ls\n");
+    fclose(f);
+    trace_end();
+
+    Str out = str_new();
+    trace_format_json(&out, events);
+    const char *json = str_cstr(&out);
+    ASSERT(strncmp(json, "{\"traceEvents\": [\n", 18) == 0);
+    ASSERT(strstr(json, "{\"name\": \"outer\", \"cat\": \"mux\", \"ph\": \"X\", \"ts\": ") != NULL);
+    ASSERT(strstr(json, "{\"name\": \"inner\", \"cat\": \"mux\"") != NULL);
+    ASSERT(strstr(json, "{\"name\": \"bash startup\", \"cat\": \"bash\"") != NULL);
+    ASSERT(strstr(json, "\"tid\": 100, \"args\": {\"name\": \"script\"}}") != NULL);
+    ASSERT(strstr(json, "\"tid\": 101, \"args\": {\"name\": \"subshell 101\"}}") != NULL);
+    ASSERT(strstr(json, "{\"name\": \"tmux new-session\", \"cat\": \"command\"") != NULL);
+    ASSERT(strstr(json, "\"dur\": 1500, ") != NULL);
+    ASSERT(strstr(json, "\"args\": {\"command\": \"tmux -L work -f /x.conf new-session -d -s "
+                        "\\\"work\\\"\", \"status\": 0}}") != NULL);
+    ASSERT(strstr(json, "{\"name\": \"herdr pane split\", \"cat\": \"command\"") != NULL);
+    ASSERT(strstr(json, "\"status\": 1}}") != NULL);
+    ASSERT(strstr(json, "tmux ls") == NULL);
+    ASSERT(strstr(json, "\n], \"displayTimeUnit\": \"ms\"}\n") != NULL);
+    str_free(&out);
+    PASS();
+}
+
+TEST test_trace_script_records_commands(void) {
+    const char *programs[] = {"true", "false"};
+    Str script = str_new();
+    trace_append_wrappers(&script, programs, 2);
+    str_append(&script, "set -euo pipefail\n"
+                        "true one 'two three'\n"
+                        "x=$(false four) || [ $? -eq 1 ]\n");
+    FILE *f = fopen(events, "w");
+    ASSERT(f != NULL);
+    fclose(f);
+    setenv("MUX_TRACE_EVENTS", events, 1);
+    trace_start();
+    ASSERT_EQ(0, shell_exec_bash(str_cstr(&script)));
+    unsetenv("MUX_TRACE_EVENTS");
+    str_free(&script);
+
+    Str out = str_new();
+    trace_format_json(&out, events);
+    const char *json = str_cstr(&out);
+    ASSERT(strstr(json, "{\"name\": \"bash startup\"") != NULL);
+    ASSERT(strstr(json, "\"args\": {\"command\": \"true one two three\", \"status\": 0}}") !=
+           NULL);
+    ASSERT(strstr(json, "\"args\": {\"command\": \"false four\", \"status\": 1}}") != NULL);
+    str_free(&out);
+    PASS();
+}
+
+SUITE(trace_suite) {
+    RUN_TEST(test_trace_wrappers);
+    RUN_TEST(test_trace_phases_and_commands);
+    RUN_TEST(test_trace_script_records_commands);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    int fd = mkstemp(events);
+    if (fd < 0) return 1;
+    close(fd);
+    RUN_SUITE(trace_suite);
+    unlink(events);
+    GREATEST_MAIN_END();
+}
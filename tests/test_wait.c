@@ -0,0 +1,266 @@
+#include "greatest.h"
+#include "wait.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static char tmpdir[64];
+
+static void make_tmpdir(void) {
+    snprintf(tmpdir, sizeof(tmpdir), "/tmp/mux-wait-test-XXXXXX");
+    if (!mkdtemp(tmpdir)) tmpdir[0] = '\0';
+}
+
+static void remove_tmpdir(void) {
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", tmpdir);
+    if (system(cmd) != 0) fprintf(stderr, "could not remove %s\n", tmpdir);
+}
+
+/* Open a listening socket on an ephemeral loopback port. */
+static int listen_loopback(int *port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, len) != 0 || listen(fd, 4) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+TEST test_wait_tcp_open_port(void) {
+    int port = 0;
+    int fd = listen_loopback(&port);
+    ASSERT(fd >= 0);
+
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+    ASSERT_EQ(0, wait_tcp(address, wait_now_ms() + 2000));
+    close(fd);
+    PASS();
+}
+
+TEST test_wait_tcp_closed_port_hits_deadline(void) {
+    int port = 0;
+    int fd = listen_loopback(&port);
+    ASSERT(fd >= 0);
+    close(fd); /* nothing listens on the port any more */
+
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+    long long start = wait_now_ms();
+    ASSERT_EQ(-1, wait_tcp(address, start + 200));
+    long long elapsed = wait_now_ms() - start;
+    ASSERT(elapsed >= 200);
+    ASSERT(elapsed < 1000);
+    PASS();
+}
+
+TEST test_wait_file_created_later(void) {
+    make_tmpdir();
+    char path[128];
+    snprintf(path, sizeof(path), "%s/tmp/pids/server.pid", tmpdir);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        char cmd[256];
+        snprintf(cmd, sizeof(cmd), "sleep 0.1; mkdir -p '%s/tmp/pids' && touch '%s'", tmpdir,
+                 path);
+        _exit(system(cmd) == 0 ? 0 : 1);
+    }
+
+    long long start = wait_now_ms();
+    ASSERT_EQ(0, wait_file(path, start + 5000));
+    ASSERT(wait_now_ms() - start < 4000);
+    waitpid(pid, NULL, 0);
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_wait_file_missing_hits_deadline(void) {
+    make_tmpdir();
+    char path[128];
+    snprintf(path, sizeof(path), "%s/never", tmpdir);
+
+    long long start = wait_now_ms();
+    ASSERT_EQ(-1, wait_file(path, start + 150));
+    ASSERT(wait_now_ms() - start >= 150);
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_wait_output_marks_matches(void) {
+    make_tmpdir();
+    char ready[128], prompt[128];
+    snprintf(ready, sizeof(ready), "%s/0", tmpdir);
+    snprintf(prompt, sizeof(prompt), "%s/1", tmpdir);
+    const char *patterns[] = {"server (is )?ready", "^db> $"};
+    const char *marks[] = {ready, prompt};
+
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    const char *output = "booting\r\n\033[32mserver\033[0m ready\r\n\033]0;title\adb> ";
+    ASSERT_EQ((ssize_t)strlen(output), write(fds[1], output, strlen(output)));
+    OutputWatch watch = {patterns, marks, 2, NULL, 0};
+
+    ASSERT_EQ(0, wait_output(fds[0], &watch, wait_now_ms() + 2000));
+    ASSERT_EQ(0, access(ready, F_OK));
+    ASSERT_EQ(0, access(prompt, F_OK));
+    close(fds[0]);
+    close(fds[1]);
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_wait_output_fails_when_pane_closes(void) {
+    make_tmpdir();
+    char mark[128];
+    snprintf(mark, sizeof(mark), "%s/0", tmpdir);
+    const char *patterns[] = {"ready"};
+    const char *marks[] = {mark};
+
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    ASSERT_EQ(8, write(fds[1], "booting\n", 8));
+    close(fds[1]);
+
+    OutputWatch watch = {patterns, marks, 1, NULL, 0};
+
+    ASSERT_EQ(-1, wait_output(fds[0], &watch, wait_now_ms() + 2000));
+    ASSERT(access(mark, F_OK) != 0);
+    close(fds[0]);
+    remove_tmpdir();
+    PASS();
+}
+
+/* Feed output to a fresh pipe and report whether the pattern matched it. */
+static int output_matches(const char *output, const char *ignore, const char *mark) {
+    const char *patterns[] = {"accepting"};
+    const char *marks[] = {mark};
+    OutputWatch watch = {patterns, marks, 1, &ignore, 1};
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    if (write(fds[1], output, strlen(output)) != (ssize_t)strlen(output)) return -1;
+    int rc = wait_output(fds[0], &watch, wait_now_ms() + 100);
+    close(fds[0]);
+    close(fds[1]);
+    return rc == 0 && access(mark, F_OK) == 0;
+}
+
+TEST test_wait_output_ignores_typed_commands(void) {
+    make_tmpdir();
+    char mark[128];
+    snprintf(mark, sizeof(mark), "%s/0", tmpdir);
+
+    /* The shell echoes the command line before running it */
+    ASSERT_EQ(0, output_matches("$ ./db && echo accepting\r\nstarting\r\n",
+                                "./db && echo accepting", mark));
+    /* A prompt line may show only the start of a long command so far */
+    ASSERT_EQ(0, output_matches("$ ./db && echo accepting", "./db && echo accepting; wait", mark));
+    ASSERT_EQ(1, output_matches("$ ./db && echo accepting\r\naccepting\r\n",
+                                "./db && echo accepting", mark));
+    remove_tmpdir();
+    PASS();
+}
+
+/* Write a stand-in for tmux whose wait-for channels are files in tmpdir, and
+ * which logs every signal it sends. */
+static void write_fake_tmux(char *tmux, size_t size) {
+    char path[128];
+    snprintf(path, sizeof(path), "%s/tmux", tmpdir);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fputs("d=$(dirname \"$0\")\n"
+              "if [ \"$2\" = -S ]; then echo \"$3\" >> \"$d/sent\"; touch \"$d/$3\"; exit 0; fi\n"
+              "while [ ! -e \"$d/$2\" ]; do sleep 0.02; done\n",
+              f);
+        fclose(f);
+    }
+    snprintf(tmux, size, "sh %s", path);
+}
+
+TEST test_wait_signal_passes_on_signal(void) {
+    make_tmpdir();
+    char tmux[160];
+    write_fake_tmux(tmux, sizeof(tmux));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        char cmd[256];
+        snprintf(cmd, sizeof(cmd), "sleep 0.1; touch '%s/mux-1-migrated'", tmpdir);
+        _exit(system(cmd) == 0 ? 0 : 1);
+    }
+
+    long long start = wait_now_ms();
+    ASSERT_EQ(0, wait_signal(tmux, "mux-1-migrated", start + 5000));
+    ASSERT(wait_now_ms() - start < 4000);
+    waitpid(pid, NULL, 0);
+
+    /* The signal is sent again for the next waiter */
+    char sent[160], line[64] = "";
+    snprintf(sent, sizeof(sent), "%s/sent", tmpdir);
+    FILE *f = fopen(sent, "r");
+    ASSERT(f != NULL);
+    ASSERT(fgets(line, sizeof(line), f) != NULL);
+    fclose(f);
+    ASSERT_STR_EQ("mux-1-migrated\n", line);
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_wait_signal_never_sent_hits_deadline(void) {
+    make_tmpdir();
+    char tmux[160];
+    write_fake_tmux(tmux, sizeof(tmux));
+
+    long long start = wait_now_ms();
+    ASSERT_EQ(-1, wait_signal(tmux, "mux-1-never", start + 200));
+    long long elapsed = wait_now_ms() - start;
+    ASSERT(elapsed >= 200);
+    ASSERT(elapsed < 1000);
+    remove_tmpdir();
+    PASS();
+}
+
+TEST test_wait_command_usage(void) {
+    char *missing_value[] = {"--tcp"};
+    char *unknown[] = {"--port", "80"};
+    char *unmarked[] = {"--output", "ready"};
+
+    ASSERT_EQ(2, wait_command(1, missing_value));
+    ASSERT_EQ(2, wait_command(2, unknown));
+    ASSERT_EQ(2, wait_command(2, unmarked));
+    PASS();
+}
+
+SUITE(wait_suite) {
+    RUN_TEST(test_wait_tcp_open_port);
+    RUN_TEST(test_wait_tcp_closed_port_hits_deadline);
+    RUN_TEST(test_wait_file_created_later);
+    RUN_TEST(test_wait_file_missing_hits_deadline);
+    RUN_TEST(test_wait_output_marks_matches);
+    RUN_TEST(test_wait_output_fails_when_pane_closes);
+    RUN_TEST(test_wait_output_ignores_typed_commands);
+    RUN_TEST(test_wait_signal_passes_on_signal);
+    RUN_TEST(test_wait_signal_never_sent_hits_deadline);
+    RUN_TEST(test_wait_command_usage);
+}
+
+GREATEST_MAIN_DEFS();
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(wait_suite);
+    GREATEST_MAIN_END();
+}